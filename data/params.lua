@@ -143,6 +143,11 @@ params = {
 	["objects"] = {
 		numObjectGridCells = {64, 1, 64},
 
+		-- number of threads that integrate the objects' physical
+		-- states each frame (0 = one per hardware thread); the
+		-- simulation does not depend on this
+		numUpdateThreads = 1,
+
 	},
 
 	["models"] = {
@@ -189,7 +194,58 @@ params = {
 			rho_max = 2.00,  -- if rho >= rho_max, f == f_flow
 
 			updateInt  = 5,  -- number of sim-frames between grid updates
-			updateMode = 0,  -- UPDATE_MODE_ALLATONCE
+			updateMode = 0,  -- UPDATE_MODE_ALLATONCE (0) or UPDATE_MODE_STAGGERED (1)
+
+			-- in staggered mode, the number of cells every solver
+			-- thread may settle on group fields per frame; longer
+			-- FMM solves are paused and resumed next frame (6144
+			-- cells took about 2 ms in offline measurements)
+			updateBudget = 6144,
+
+			-- potential-field solver: 0 = fast marching (FMM),
+			-- 1 = fast sweeping (FSM), which stops after at most
+			-- fsmMaxIterations rounds of four sweeps each
+			solver           =  0,
+			fsmMaxIterations = 16,
+
+			-- FMM candidate queue: 0 = exact heap, 1 = untidy
+			-- (bucketed) queue; a bucket-width of 0 derives the
+			-- width from the cheapest edge cost of each group
+			-- if fmmCheckError is 1, every untidy (or FSM) solve is
+			-- also done with the heap and the max. error is printed
+			fmmQueue       =   0,
+			fmmNumBuckets  = 256,
+			fmmBucketWidth = 0.0,
+			fmmCheckError  =   0,
+
+			-- if fmmEarlyExit is 1, an FMM solve stops once every
+			-- cell within fmmEarlyExitMargin cells of a member of
+			-- the group is settled (the cells beyond it have no
+			-- velocity, so the margin must cover the distance the
+			-- members move between two updates of the group)
+			fmmEarlyExit       = 0,
+			fmmEarlyExitMargin = 2,
+
+			-- if fmmHeuristic is 1 (requires fmmEarlyExit), early-
+			-- terminated solves settle cells in order of potential
+			-- plus a lower bound on the remaining potential to the
+			-- group, derived from fmmNumLandmarks precomputed tables
+			-- of static discomfort distances
+			fmmHeuristic    = 0,
+			fmmNumLandmarks = 8,
+
+			-- if lazyVelocities is 1, FMM solves only compute the
+			-- potentials and the velocity-field of a group is then
+			-- derived for the cells within lazyVelocityMargin cells
+			-- of its members (the margin must cover the distance the
+			-- members move between two updates of the group)
+			lazyVelocities     = 0,
+			lazyVelocityMargin = 2,
+
+			-- number of threads that solve the per-group fields
+			-- concurrently (0 = one per hardware thread); the
+			-- fields do not depend on this
+			numThreads = 1,
 		},
 
 		["dummy"] = {
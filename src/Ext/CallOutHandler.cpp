@@ -8,6 +8,7 @@
 #include "../Sim/SimObjectHandler.hpp"
 #include "../Sim/SimObjectDefHandler.hpp"
 #include "../Sim/SimObjectGrid.hpp"
+#include "../Sim/SimObjectFlatGrid.hpp"
 #include "../System/Debugger.hpp"
 #include "../System/EngineAux.hpp"
 #include "../System/LuaParser.hpp"
@@ -70,7 +71,7 @@ unsigned int CallOutHandler::GetNumSimObjects() const { return simObjectHandler-
 
 
 unsigned int CallOutHandler::GetObjectIDs(const vec3f& pos, const vec3f& radii, unsigned int* array, unsigned int size) const {
-	SimObjectGrid<const SimObject*>* grid = simObjectHandler->GetSimObjectGrid();
+	SimObjectHandler::ObjectGrid* grid = simObjectHandler->GetSimObjectGrid();
 
 	std::list<const SimObject*> objects;
 	grid->GetObjects(pos, radii, objects);
@@ -152,9 +153,9 @@ const mat44f& CallOutHandler::GetSimObjectMatrix(unsigned int objID) const {
 const vec3f& CallOutHandler::GetSimObjectPosition(unsigned int objID) const {
 	if (IsValidSimObjectID(objID)) {
 		const SimObject* o = simObjectHandler->GetSimObject(objID);
-		const mat44f& m = o->GetMat();
+		const vec3f& p = o->GetPos();
 
-		return (m.GetPos());
+		return p;
 	}
 
 	return NVECf;
@@ -163,9 +164,9 @@ const vec3f& CallOutHandler::GetSimObjectPosition(unsigned int objID) const {
 const vec3f& CallOutHandler::GetSimObjectDirection(unsigned int objID) const {
 	if (IsValidSimObjectID(objID)) {
 		const SimObject* o = simObjectHandler->GetSimObject(objID);
-		const mat44f& m = o->GetMat();
+		const vec3f& d = o->GetDir();
 
-		return (m.GetZDir());
+		return d;
 	}
 
 	return NVECf;
@@ -174,9 +175,9 @@ const vec3f& CallOutHandler::GetSimObjectDirection(unsigned int objID) const {
 float CallOutHandler::GetSimObjectSpeed(unsigned int objID) const {
 	if (IsValidSimObjectID(objID)) {
 		const SimObject* o = simObjectHandler->GetSimObject(objID);
-		const PhysicalState& ps = o->GetPhysicalState();
+		const float s = o->GetSpeed();
 
-		return ps.speed;
+		return s;
 	}
 
 	return 0.0f;
@@ -237,12 +238,7 @@ const WantedPhysicalState& CallOutHandler::GetSimObjectWantedPhysicalState(unsig
 void CallOutHandler::SetSimObjectPhysicsUpdates(unsigned int objID, bool state) const {
 	if (IsValidSimObjectID(objID)) {
 		SimObject* so = simObjectHandler->GetSimObject(objID);
-
-		const PhysicalState& ops = so->GetPhysicalState();
-		      PhysicalState  nps = ops;
-
-		nps.enabled = state;
-		so->SetPhysicalState(nps);
+		so->SetPhysicsUpdates(state);
 	}
 }
 
@@ -252,43 +248,23 @@ void CallOutHandler::SetSimObjectRawPosition(unsigned int objID, const vec3f& po
 	if (IsValidSimObjectID(objID)) {
 		SimObject* so = simObjectHandler->GetSimObject(objID);
 
-		// get the old state
-		const PhysicalState& ops = so->GetPhysicalState();
-		      PhysicalState  nps = ops;
-
 		// update position and adjust to the local terrain-slope
 		vec3f gpos = pos;
-		mat44f mat = ops.mat;
 
 		readMap->SetPosInBounds(gpos);
 		gpos.y = ground->GetHeight(pos.x, pos.z);
 
-		mat.SetPos(gpos);
-		mat.SetYDirXZ(ground->GetSmoothNormal(gpos.x, gpos.z));
-
-		// copy the new matrix
-		nps.mat = mat;
-
-		so->SetPhysicalState(nps);
+		so->SetPos(gpos);
+		so->SetDirs(so->GetDir(), ground->GetSmoothNormal(gpos.x, gpos.z));
 	}
 }
 
 void CallOutHandler::SetSimObjectRawDirection(unsigned int objID, const vec3f& dir) const {
 	if (IsValidSimObjectID(objID)) {
 		SimObject* so = simObjectHandler->GetSimObject(objID);
+		const vec3f& pos = so->GetPos();
 
-		const PhysicalState& ops = so->GetPhysicalState();
-		      PhysicalState  nps = ops;
-
-		mat44f mat = ops.mat;
-
-		mat.SetZDir(dir);
-		mat.SetYDirXZ(ground->GetSmoothNormal(mat.GetPos().x, mat.GetPos().z));
-
-		// copy the new matrix
-		nps.mat = mat;
-
-		so->SetPhysicalState(nps);
+		so->SetDirs(dir, ground->GetSmoothNormal(pos.x, pos.z));
 	}
 }
 
@@ -296,13 +272,8 @@ void CallOutHandler::SetSimObjectRawSpeed(unsigned int objID, float speed) const
 	if (IsValidSimObjectID(objID)) {
 		SimObject* so = simObjectHandler->GetSimObject(objID);
 
-		const PhysicalState& ops = so->GetPhysicalState();
-		      PhysicalState  nps = ops;
-
 		// directly set the new speed, no clamping
-		nps.speed = speed;
-
-		so->SetPhysicalState(nps);
+		so->SetSpeed(speed);
 	}
 }
 
@@ -310,22 +281,13 @@ void CallOutHandler::SetSimObjectRawPhysicalState(unsigned int objID, const vec3
 	if (IsValidSimObjectID(objID)) {
 		SimObject* so = simObjectHandler->GetSimObject(objID);
 
-		const PhysicalState& ops = so->GetPhysicalState();
-		      PhysicalState  nps = ops;
-
 		vec3f gpos = pos;
-		mat44f mat = ops.mat;
 
 		readMap->SetPosInBounds(gpos);
 		gpos.y = ground->GetHeight(pos.x, pos.z);
 
-		mat.SetPos(gpos);
-		mat.SetZDir(dir);
-		mat.SetYDirXZ(ground->GetSmoothNormal(gpos.x, gpos.z));
-
-		nps.mat = mat;
-		nps.speed = speed;
-
-		so->SetPhysicalState(nps);
+		so->SetPos(gpos);
+		so->SetDirs(dir, ground->GetSmoothNormal(gpos.x, gpos.z));
+		so->SetSpeed(speed);
 	}
 }
@@ -8,6 +8,11 @@ class SimObjectDef;
 struct WantedPhysicalState;
 
 // exposes simulation state to libraries
+//
+// the simulation does not change while a library's Update runs,
+// so the read-only (Get*, Is*) call-outs may be made concurrently
+// from any worker-thread of the library; the others (Push*, Pop*,
+// Set*) must only be made from the thread that called Update
 class ICallOutHandler {
 public:
 	virtual float GetFloatConfigParam(const char** tableNames, const char* key, float val) const = 0;
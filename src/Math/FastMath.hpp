@@ -24,6 +24,37 @@ namespace fastmath {
 
 	inline float sqrt1(float x) { return (isqrt1(x) * x); }
 	inline float sqrt2(float x) { return (isqrt2(x) * x); }
+
+	// IEEE 754 half-precision conversions (mantissas are truncated,
+	// values beyond the half range become infinite and denormals
+	// are flushed to zero)
+	inline unsigned short float_to_half(float x) {
+		union { float f; unsigned int i; } u; u.f = x;
+
+		const unsigned int sign = (u.i >> 16) & 0x8000U;
+		const int          expo = int((u.i >> 23) & 0xFFU) - 127 + 15;
+		const unsigned int mant = (u.i >> 13) & 0x3FFU;
+
+		if (((u.i >> 23) & 0xFFU) == 0xFFU) { return (sign | 0x7C00U | ((u.i & 0x7FFFFFU) != 0? 0x200U: 0U)); }
+		if (expo >= 0x1F) { return (sign | 0x7C00U); }
+		if (expo <= 0) { return sign; }
+
+		return (sign | (expo << 10) | mant);
+	}
+
+	inline float half_to_float(unsigned short h) {
+		union { float f; unsigned int i; } u;
+
+		const unsigned int sign = (h & 0x8000U) << 16;
+		const unsigned int expo = (h >> 10) & 0x1FU;
+		const unsigned int mant = (h & 0x3FFU);
+
+		if (expo == 0x00U) { u.i = sign; return u.f; }
+		if (expo == 0x1FU) { u.i = sign | 0x7F800000U | (mant << 13); return u.f; }
+
+		u.i = sign | ((expo - 15 + 127) << 23) | (mant << 13);
+		return u.f;
+	}
 }
 
 #endif
@@ -0,0 +1,197 @@
+#ifndef PFFG_CC_BUCKETQUEUE_HDR
+#define PFFG_CC_BUCKETQUEUE_HDR
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "../../System/Debugger.hpp"
+
+// "untidy" priority queue (Yatziv et al., 2006) for the FMM
+// candidate set: keys are quantized into buckets of a fixed
+// width and every bucket is a FIFO, so push() and pop() run
+// in (amortized) constant time
+//
+// elements are only ordered *between* buckets; within one
+// bucket they come out in insertion order, which bounds the
+// error per settled cell by the bucket width
+//
+// the buckets form a circular window of <numBuckets> slots
+// starting at the current (lowest) bucket; keys that fall
+// beyond the window go into an overflow list that is only
+// touched when the window slides over its lowest key
+template<typename T> class CCBucketQueue {
+public:
+	enum {
+		NO_KEY = 0xFFFFFFFFU,
+	};
+
+	CCBucketQueue(): mBucketWidth(1.0f), mInvBucketWidth(1.0f), mCurrKey(0), mMinOverflowKey(NO_KEY), mNumElems(0), mNumWindowElems(0) {
+		SetNumBuckets(256);
+	}
+
+	void SetNumBuckets(unsigned int n) {
+		PFFG_ASSERT(empty());
+		mBuckets.resize(std::max(n, 2U));
+	}
+	void SetBucketWidth(float w) {
+		PFFG_ASSERT(empty());
+		PFFG_ASSERT(w > 0.0f);
+		mBucketWidth = w;
+		mInvBucketWidth = 1.0f / w;
+		mCurrKey = 0;
+	}
+
+	float GetBucketWidth() const { return mBucketWidth; }
+	unsigned int GetNumBuckets() const { return mBuckets.size(); }
+
+	bool empty() const { return (mNumElems == 0); }
+	unsigned int size() const { return mNumElems; }
+
+	void push(T elem, float prio) {
+		if (mNumElems == 0) {
+			// nothing left to preserve, rewind the window (the
+			// first top() jumps ahead to the lowest pushed key)
+			mCurrKey = 0;
+		}
+
+		// keys lower than the current bucket can occur because
+		// the queue is not exact; such elements are simply put
+		// into the current bucket
+		const unsigned int key = std::max(GetKey(prio), mCurrKey);
+
+		if (key < (mCurrKey + mBuckets.size())) {
+			mBuckets[key % mBuckets.size()].push_back(elem);
+			mNumWindowElems += 1;
+		} else {
+			mOverflow.push_back(OverflowElem(elem, key));
+			mMinOverflowKey = std::min(mMinOverflowKey, key);
+		}
+
+		mNumElems += 1;
+	}
+
+	// NOTE: not const, advances the window to the first non-empty bucket
+	T top() {
+		PFFG_ASSERT(!empty());
+		return (NextBucket().front());
+	}
+
+	void pop() {
+		PFFG_ASSERT(!empty());
+
+		Bucket& bucket = NextBucket();
+		bucket.pop_front();
+
+		mNumElems -= 1;
+		mNumWindowElems -= 1;
+	}
+
+	void clear() {
+		for (unsigned int n = 0; n < mBuckets.size(); n++) {
+			mBuckets[n].clear();
+		}
+
+		mOverflow.clear();
+
+		mCurrKey = 0;
+		mMinOverflowKey = NO_KEY;
+		mNumElems = 0;
+		mNumWindowElems = 0;
+	}
+
+private:
+	// FIFO that keeps its storage between solves
+	struct Bucket {
+		Bucket(): head(0) {}
+
+		bool empty() const { return (head == elems.size()); }
+		T front() const { return elems[head]; }
+
+		void push_back(T elem) { elems.push_back(elem); }
+		void pop_front() {
+			if ((++head) == elems.size()) {
+				clear();
+			}
+		}
+		void clear() { elems.clear(); head = 0; }
+
+		std::vector<T> elems;
+		unsigned int head;
+	};
+
+	struct OverflowElem {
+		OverflowElem(T e, unsigned int k): elem(e), key(k) {}
+
+		T elem;
+		unsigned int key;
+	};
+
+	unsigned int GetKey(float prio) const {
+		// infinite (or otherwise huge) potentials
+		// all end up in the very last bucket-key
+		const float maxKey = float(std::numeric_limits<unsigned int>::max() >> 1);
+		const float key = prio * mInvBucketWidth;
+
+		if (!(key < maxKey)) { return (unsigned int) maxKey; }
+		if (!(key > 0.0f)) { return 0; }
+
+		return (unsigned int) key;
+	}
+
+	Bucket& NextBucket() {
+		while (true) {
+			if (mNumWindowElems == 0) {
+				// window ran dry, jump to the lowest overflowed key
+				mCurrKey = mMinOverflowKey;
+			}
+			if (mMinOverflowKey < (mCurrKey + mBuckets.size())) {
+				PullOverflow();
+			}
+
+			Bucket& bucket = mBuckets[mCurrKey % mBuckets.size()];
+
+			if (!bucket.empty()) {
+				return bucket;
+			}
+
+			mCurrKey += 1;
+		}
+	}
+
+	// move every overflowed element whose key now
+	// falls inside the window back into its bucket
+	void PullOverflow() {
+		unsigned int numKept = 0;
+
+		mMinOverflowKey = NO_KEY;
+
+		for (unsigned int n = 0; n < mOverflow.size(); n++) {
+			const OverflowElem& e = mOverflow[n];
+
+			if (e.key < (mCurrKey + mBuckets.size())) {
+				mBuckets[e.key % mBuckets.size()].push_back(e.elem);
+				mNumWindowElems += 1;
+			} else {
+				mMinOverflowKey = std::min(mMinOverflowKey, e.key);
+				mOverflow[numKept++] = e;
+			}
+		}
+
+		mOverflow.resize(numKept, OverflowElem(T(), 0));
+	}
+
+	std::vector<Bucket> mBuckets;
+	std::vector<OverflowElem> mOverflow;
+
+	float mBucketWidth;
+	float mInvBucketWidth;
+
+	// absolute key of the bucket at the start of the window
+	unsigned int mCurrKey;
+	unsigned int mMinOverflowKey;
+	unsigned int mNumElems;
+	unsigned int mNumWindowElems;
+};
+
+#endif
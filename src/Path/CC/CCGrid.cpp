@@ -1,6 +1,7 @@
 #include <cmath>
 #include <algorithm>
 #include <limits>
+#include <functional>
 #include <cstdio>
 
 #include "./CCGrid.hpp"
@@ -9,6 +10,7 @@
 #include "../../Sim/SimObjectDef.hpp"
 #include "../../Sim/SimObjectState.hpp"
 #include "../../System/Debugger.hpp"
+#include "../../System/WorkerPool.hpp"
 
 #define EPSILON 0.01f
 
@@ -25,6 +27,9 @@
 // the first unaffected cell along NSEW is located at (x, y) +/-
 // (n + 1, n + 1) where (x, y) is the disc's center-cell)
 #define CELLS_IN_RADIUS(r) ((r / (mSquareSize >> 1)) + 1)
+// largest <n> whose disc stencil is built by Init(), stencils
+// for larger discs are added on first use
+#define DISC_STENCIL_INIT_RADIUS 16
 
 #define POSITIVE_SLOPE(dir, slope)                            \
 	(((dir == DIR_N || dir == DIR_W) && (slope <  0.0f))  ||  \
@@ -44,39 +49,73 @@
 #define SPEED_COST_POTENTIAL_MERGED_COMPUTATION 1
 #define SPEED_COST_SINGLE_PASS_COMPUTATION      0
 #define SPEED_COST_DIRECTIONAL_DISCOMFORT       1
+// whether the speeds and costs sampled from empty cells are copied
+// from a per speed-class field that is computed once, rather than
+// being recomputed for every group on every update
+#define SPEED_COST_STATIC_FIELD_CACHE           1
 
 #define VELOCITY_FIELD_DIRECT_INTERPOLATION     0
 #define VELOCITY_FIELD_BILINEAR_INTERPOLATION   1
 
+// number of cells a paused FMM solve settles between
+// two checks of the (staggered update) work budget
+#define STAGGERED_UPDATE_CHECK_INTERVAL       256
 
+// whether ComputeAvgVelocity() visits the touched cells in
+// index order (rather than in order of first touch), which
+// keeps the traversal of the global fields cache-friendly
+#define TOUCHED_CELLS_SORTED                  1
 
-void CCGrid::AddGroup(unsigned int groupID) {
-	mSpeedVisData[groupID] = std::vector<float>();
-	mSpeedVisData[groupID].resize(numCellsX * numCellsZ * NUM_DIRS, 0.0f);
-	mCostVisData[groupID] = std::vector<float>();
-	mCostVisData[groupID].resize(numCellsX * numCellsZ * NUM_DIRS, 0.0f);
+// number of groups whose speed-, cost- and potential-delta
+// fields are captured for visualisation (one per overlay)
+#define GROUP_VIS_MAX_CAPTURES                2
+
+// largest cell-offset (CELLS_IN_RADIUS(r) + 1) at which a group's
+// costs sample the discomfort-field for the landmark bounds to
+// cover them; the bounds of groups with larger members ignore the
+// discomfort term of their costs
+#define LANDMARK_MAX_DISCOMFORT_OFFSET        8
+
+#if (FMM_TRACE_TOUCHED_BYTES == 1)
+	#define FMM_TRACE_TOUCH(ws, v) (ws).TraceTouch(&(v), sizeof(v))
+	#define FMM_TRACE_TOUCH_N(ws, v, n) (ws).TraceTouch(&(v), sizeof(v) * (n))
+#else
+	#define FMM_TRACE_TOUCH(ws, v)
+	#define FMM_TRACE_TOUCH_N(ws, v, n)
+#endif
+
+// advection: turns smaller than this are not made
+// unless the turning-rate itself is at most as small
+static const float MIN_TURNING_ANGLE_COS = cosf(DEG2RAD(2.0f));
 
-	mPotentialVisData[groupID] = std::vector<float>();
-	mPotentialVisData[groupID].resize(numCellsX * numCellsZ, 0.0f);
 
-	mVelocityVisData[groupID] = std::vector<vec3f>();
-	mVelocityVisData[groupID].resize(numCellsX * numCellsZ * NUM_DIRS, NVECf);
 
-	mPotentialDeltaVisData[groupID] = std::vector<vec3f>();
-	mPotentialDeltaVisData[groupID].resize(numCellsX * numCellsZ * NUM_DIRS, NVECf);
+void CCGrid::AddGroup(unsigned int groupID) {
+	mGroupPotentials[groupID] = std::vector<float>();
+	mGroupPotentials[groupID].resize(numCellsX * numCellsZ, std::numeric_limits<float>::infinity());
+
+	mGroupEdgeVelocities[groupID] = std::vector<EdgeVelocity>();
+	mGroupEdgeVelocities[groupID].resize(mHeightDeltas.size());
 
-	mGroupGridStates[groupID] = Buffer(numCellsX, numCellsZ);
+	mGroupSettledCells[groupID] = std::vector<unsigned int>();
+	mGroupSchedules[groupID] = GroupSchedule();
 }
 
 void CCGrid::DelGroup(unsigned int groupID) {
-	mSpeedVisData[groupID].clear(); mSpeedVisData.erase(groupID);
-	mCostVisData[groupID].clear(); mCostVisData.erase(groupID);
-	mPotentialVisData[groupID].clear(); mPotentialVisData.erase(groupID);
+	// a paused solve writes into this group's arrays
+	for (unsigned int n = 0; n < mWorkspaces.size(); n++) {
+		if (mWorkspaces[n].solveGroupID == groupID) {
+			AbortGroupPotentialField(mWorkspaces[n]);
+		}
+	}
 
-	mVelocityVisData[groupID].clear(); mVelocityVisData.erase(groupID);
-	mPotentialDeltaVisData[groupID].clear(); mPotentialDeltaVisData.erase(groupID);
+	mGroupSchedules.erase(groupID);
+	mGroupSettledCells.erase(groupID);
 
-	mGroupGridStates.erase(groupID);
+	mGroupVisCaptures.erase(groupID);
+
+	mGroupPotentials[groupID].clear(); mGroupPotentials.erase(groupID);
+	mGroupEdgeVelocities[groupID].clear(); mGroupEdgeVelocities.erase(groupID);
 }
 
 
@@ -86,66 +125,345 @@ const float* CCGrid::GetDensityVisDataArray() const {
 	return (mDensityVisData.empty())? NULL: &mDensityVisData[0];
 }
 
-const float* CCGrid::GetSpeedVisDataArray(unsigned int groupID) const {
-	std::map<unsigned int, std::vector<float> >::const_iterator it = mSpeedVisData.find(groupID);
+const float* CCGrid::GetHeightVisDataArray() const {
+	return (mHeightVisData.empty())? NULL: &mHeightVisData[0];
+}
+
+const vec3f* CCGrid::GetDiscomfortVisDataArray() const {
+	return (mDiscomfortVisData.empty())? NULL: &mDiscomfortVisData[0];
+}
+
+const vec3f* CCGrid::GetVelocityAvgVisDataArray() const {
+	return (mAvgVelocityVisData.empty())? NULL: &mAvgVelocityVisData[0];
+}
+
+const vec3f* CCGrid::GetHeightDeltaVisDataArray() const {
+	return (mHeightDeltaVisData.empty())? NULL: &mHeightDeltaVisData[0];
+}
+
+
 
-	if (it == mSpeedVisData.end()) { return NULL; }
-	if ((it->second).empty()) { return NULL; }
+// visualisation data accessors for per-group fields; the potential-
+// and velocity-fields are kept for every group, so these build a
+// snapshot of the requested group's field on every call, whereas
+// speeds, costs and potential deltas only exist in the workspaces
+// and are captured by the solves of the groups that were recently
+// requested here (the first requests for a group return NULL until
+// the next solve phase has created its capture)
+const float* CCGrid::GetSpeedVisDataArray(unsigned int groupID) {
+	const GroupVisCapture* capture = GetGroupVisCapture(groupID);
 
-	return &(it->second)[0];
+	if (capture == NULL) { return NULL; }
+
+	return &capture->speeds[0];
 }
 
-const float* CCGrid::GetCostVisDataArray(unsigned int groupID) const {
-	std::map<unsigned int, std::vector<float> >::const_iterator it = mCostVisData.find(groupID);
+const float* CCGrid::GetCostVisDataArray(unsigned int groupID) {
+	const GroupVisCapture* capture = GetGroupVisCapture(groupID);
 
-	if (it == mCostVisData.end()) { return NULL; }
-	if ((it->second).empty()) { return NULL; }
+	if (capture == NULL) { return NULL; }
 
-	return &(it->second)[0];
+	return &capture->costs[0];
 }
 
-const float* CCGrid::GetHeightVisDataArray() const {
-	return (mHeightVisData.empty())? NULL: &mHeightVisData[0];
+const float* CCGrid::GetPotentialVisDataArray(unsigned int groupID) {
+	std::map<unsigned int, std::vector<float> >::const_iterator it = mGroupPotentials.find(groupID);
+
+	if (it == mGroupPotentials.end()) { return NULL; }
+
+	const std::vector<float>& potentials = it->second;
+
+	mPotentialVisData.resize(potentials.size());
+
+	// unreached cells are shown as -1
+	for (unsigned int cellIdx = 0; cellIdx < potentials.size(); cellIdx++) {
+		mPotentialVisData[cellIdx] = (potentials[cellIdx] == std::numeric_limits<float>::infinity())? -1.0f: potentials[cellIdx];
+	}
+
+	return &mPotentialVisData[0];
 }
 
-const float* CCGrid::GetPotentialVisDataArray(unsigned int groupID) const {
-	std::map<unsigned int, std::vector<float> >::const_iterator it = mPotentialVisData.find(groupID);
+const vec3f* CCGrid::GetVelocityVisDataArray(unsigned int groupID) {
+	std::map<unsigned int, std::vector<EdgeVelocity> >::const_iterator it = mGroupEdgeVelocities.find(groupID);
+
+	if (it == mGroupEdgeVelocities.end()) { return NULL; }
+
+	const std::vector<EdgeVelocity>& edgeVelocities = it->second;
+
+	unsigned int cellEdges[NUM_DIRS] = {0};
 
-	if (it == mPotentialVisData.end()) { return NULL; }
-	if ((it->second).empty()) { return NULL; }
+	mVelocityVisData.resize(numCellsX * numCellsZ * NUM_DIRS);
 
-	return &(it->second)[0];
+	for (unsigned int cellIdx = 0; cellIdx < (numCellsX * numCellsZ); cellIdx++) {
+		GetCellEdgeIndices(cellIdx, cellEdges);
+
+		for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+			mVelocityVisData[cellIdx * NUM_DIRS + dir] = edgeVelocities[ cellEdges[dir] ].Get() * (mSquareSize >> 1);
+		}
+	}
+
+	return &mVelocityVisData[0];
 }
 
-// visualisation data accessors for vector fields
-const vec3f* CCGrid::GetDiscomfortVisDataArray() const {
-	return (mDiscomfortVisData.empty())? NULL: &mDiscomfortVisData[0];
+const vec3f* CCGrid::GetPotentialDeltaVisDataArray(unsigned int groupID) {
+	const GroupVisCapture* capture = GetGroupVisCapture(groupID);
+
+	if (capture == NULL) { return NULL; }
+
+	return &capture->potentialDeltas[0];
 }
 
-const vec3f* CCGrid::GetVelocityVisDataArray(unsigned int groupID) const {
-	std::map<unsigned int, std::vector<vec3f> >::const_iterator it = mVelocityVisData.find(groupID);
+// called by the accessors (from the UI, between sim-frames): records
+// the request for <groupID> and returns its capture if one exists;
+// captures are not created here since paused solves keep pointers
+// to them across frames (see UpdateGroupVisCaptures)
+const CCGrid::GroupVisCapture* CCGrid::GetGroupVisCapture(unsigned int groupID) {
+	mVisCaptureRequests[groupID] = ++mNumVisCaptureRequests;
+
+	std::map<unsigned int, GroupVisCapture>::const_iterator it = mGroupVisCaptures.find(groupID);
 
-	if (it == mVelocityVisData.end()) { return NULL; }
-	if ((it->second).empty()) { return NULL; }
+	if (it == mGroupVisCaptures.end()) {
+		return NULL;
+	}
 
-	return &(it->second)[0];
+	return &(it->second);
 }
 
-const vec3f* CCGrid::GetVelocityAvgVisDataArray() const {
-	return (mAvgVelocityVisData.empty())? NULL: &mAvgVelocityVisData[0];
+// creates the captures of the groups requested since the previous
+// solve phase, then evicts the least recently requested groups if
+// more than GROUP_VIS_MAX_CAPTURES are kept; runs before the solves
+// of this phase are handed to the workers, and re-resolves the
+// captures of paused solves, so no solve ever writes into an
+// evicted capture
+void CCGrid::UpdateGroupVisCaptures() {
+	for (std::map<unsigned int, unsigned int>::const_iterator it = mVisCaptureRequests.begin(); it != mVisCaptureRequests.end(); ++it) {
+		if (mGroupEdgeVelocities.find(it->first) == mGroupEdgeVelocities.end()) {
+			continue;
+		}
+
+		GroupVisCapture& capture = mGroupVisCaptures[it->first];
+
+		if (capture.speeds.empty()) {
+			capture.speeds.resize(numCellsX * numCellsZ * NUM_DIRS, 0.0f);
+			capture.costs.resize(numCellsX * numCellsZ * NUM_DIRS, 0.0f);
+			capture.potentialDeltas.resize(numCellsX * numCellsZ * NUM_DIRS, NVECf);
+		}
+
+		capture.lastRequest = it->second;
+	}
+
+	mVisCaptureRequests.clear();
+
+	while (mGroupVisCaptures.size() > GROUP_VIS_MAX_CAPTURES) {
+		std::map<unsigned int, GroupVisCapture>::iterator lruIt = mGroupVisCaptures.begin();
+
+		for (std::map<unsigned int, GroupVisCapture>::iterator it = mGroupVisCaptures.begin(); it != mGroupVisCaptures.end(); ++it) {
+			if (it->second.lastRequest < lruIt->second.lastRequest) {
+				lruIt = it;
+			}
+		}
+
+		mGroupVisCaptures.erase(lruIt);
+	}
+
+	// paused solves capture into whatever their group has now
+	for (unsigned int n = 0; n < mWorkspaces.size(); n++) {
+		Workspace& ws = mWorkspaces[n];
+
+		if (ws.solveGroupID == NO_GROUP) {
+			continue;
+		}
+
+		std::map<unsigned int, GroupVisCapture>::iterator it = mGroupVisCaptures.find(ws.solveGroupID);
+
+		ws.visCapture = (it != mGroupVisCaptures.end())? &(it->second): NULL;
+	}
 }
 
-const vec3f* CCGrid::GetPotentialDeltaVisDataArray(unsigned int groupID) const {
-	std::map<unsigned int, std::vector<vec3f> >::const_iterator it = mPotentialDeltaVisData.find(groupID);
+// zeroes the velocities around every cell that the previous solve of
+// <groupID> settled but the one that just finished in <ws> did not (a
+// solve that ran out of candidates overwrote every reachable cell, so
+// there is nothing to clear unless the previous one stopped early)
+void CCGrid::ClearUnsettledVelocities(Workspace& ws) {
+	const Buffer& buffer = ws.buffer;
+
+	std::vector<unsigned int>& prevSettledCells = *ws.groupSettledCells;
+	std::vector<EdgeVelocity>& edgeVelocities = *ws.edgeVelocities;
+
+	if (!ws.earlyExit) {
+		prevSettledCells.clear();
+		return;
+	}
+
+	unsigned int cellEdges[NUM_DIRS] = {0};
+
+	for (unsigned int n = 0; n < prevSettledCells.size(); n++) {
+		const unsigned int cellIdx = prevSettledCells[n];
+		const unsigned int cellX = cellIdx % numCellsX;
+		const unsigned int cellZ = cellIdx / numCellsX;
 
-	if (it == mPotentialDeltaVisData.end()) { return NULL; }
-	if ((it->second).empty()) { return NULL; }
+		if (buffer.IsCurrentCell(cellIdx) && (buffer.states[cellIdx] & CELL_KNOWN) != 0) {
+			continue;
+		}
+
+		GetCellEdgeIndices(cellIdx, cellEdges);
+
+		for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+			// an edge shared with a settled cell was written by it
+			const int ngbX = int(cellX) + mDirDeltas[dir].x;
+			const int ngbZ = int(cellZ) + mDirDeltas[dir].z;
+
+			if (ngbX >= 0 && ngbX < int(numCellsX) && ngbZ >= 0 && ngbZ < int(numCellsZ)) {
+				const unsigned int ngbIdx = GRID_INDEX_UNSAFE(ngbX, ngbZ);
+
+				if (buffer.IsCurrentCell(ngbIdx) && (buffer.states[ngbIdx] & CELL_KNOWN) != 0) {
+					continue;
+				}
+			}
+
+			edgeVelocities[ cellEdges[dir] ].Set(NVECf);
+		}
+	}
 
-	return &(it->second)[0];
+	prevSettledCells.swap(ws.settledCells);
+	ws.settledCells.clear();
 }
 
-const vec3f* CCGrid::GetHeightDeltaVisDataArray() const {
-	return (mHeightDeltaVisData.empty())? NULL: &mHeightDeltaVisData[0];
+// lazy velocity-fields: derives the velocities of the cells within
+// mLazyVelocityMargin cells of every member of the group whose solve
+// just finished in <ws>, after zeroing those of the cells derived for
+// its previous solve (so the field is zero everywhere else)
+//
+// an edge gets the velocity that the FMM would have written, ie. that
+// of the later-settled of its two cells (see <settleOrders>); edges
+// that no settled cell shares stay zero like those around sources
+void CCGrid::StoreMemberVelocities(Workspace& ws) {
+	Buffer& buffer = ws.buffer;
+
+	std::vector<unsigned int>& velocityCells = *ws.groupSettledCells;
+	std::vector<EdgeVelocity>& edgeVelocities = *ws.edgeVelocities;
+
+	const int margin = mLazyVelocityMargin;
+
+	unsigned int cellEdges[NUM_DIRS] = {0};
+
+	for (unsigned int n = 0; n < velocityCells.size(); n++) {
+		GetCellEdgeIndices(velocityCells[n], cellEdges);
+
+		for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+			edgeVelocities[ cellEdges[dir] ].Set(NVECf);
+		}
+	}
+
+	velocityCells.clear();
+
+	for (std::set<unsigned int>::const_iterator it = ws.objectIDs->begin(); it != ws.objectIDs->end(); ++it) {
+		const vec3i& objectCell = GetCellIndex2D(mCOH->GetSimObjectPosition(*it));
+
+		const unsigned int x0 = std::max(objectCell.x - margin, int(ws.window.x0));
+		const unsigned int x1 = std::min(objectCell.x + margin, int(ws.window.x1));
+		const unsigned int z0 = std::max(objectCell.z - margin, int(ws.window.z0));
+		const unsigned int z1 = std::min(objectCell.z + margin, int(ws.window.z1));
+
+		for (unsigned int z = z0; z <= z1; z++) {
+			for (unsigned int x = x0; x <= x1; x++) {
+				const unsigned int cellIdx = GRID_INDEX_UNSAFE(x, z);
+
+				if (!buffer.IsCurrentCell(cellIdx)) { continue; }
+				if ((buffer.states[cellIdx] & (CELL_KNOWN | CELL_VELOCITY)) != CELL_KNOWN) { continue; }
+
+				buffer.states[cellIdx] |= CELL_VELOCITY;
+				velocityCells.push_back(cellIdx);
+			}
+		}
+	}
+
+	for (unsigned int n = 0; n < velocityCells.size(); n++) {
+		const unsigned int cellIdx = velocityCells[n];
+		const unsigned int cellX = cellIdx % numCellsX;
+		const unsigned int cellZ = cellIdx / numCellsX;
+
+		GetCellEdgeIndices(cellIdx, cellEdges);
+
+		for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+			const int ngbX = int(cellX) + mDirDeltas[dir].x;
+			const int ngbZ = int(cellZ) + mDirDeltas[dir].z;
+
+			unsigned int ownerIdx = cellIdx;
+			unsigned int ownerDir = dir;
+
+			if (ngbX >= 0 && ngbX < int(numCellsX) && ngbZ >= 0 && ngbZ < int(numCellsZ)) {
+				const unsigned int ngbIdx = GRID_INDEX_UNSAFE(ngbX, ngbZ);
+
+				const bool cellSettled = ((buffer.states[cellIdx] & CELL_SOURCE) == 0);
+				const bool ngbSettled =
+					buffer.IsCurrentCell(ngbIdx) &&
+					((buffer.states[ngbIdx] & (CELL_KNOWN | CELL_SOURCE)) == CELL_KNOWN);
+
+				if (ngbSettled && (!cellSettled || ws.settleOrders[ngbIdx] > ws.settleOrders[cellIdx])) {
+					// the directions are paired (N/S, E/W)
+					ownerIdx = ngbIdx;
+					ownerDir = dir ^ 1;
+				}
+			}
+
+			if ((buffer.states[ownerIdx] & CELL_SOURCE) != 0) {
+				continue;
+			}
+
+			const unsigned int edgeIdx = cellEdges[dir];
+
+			edgeVelocities[edgeIdx].Set(GetNormalisedPotentialGradient(buffer, edgeIdx) * -buffer.speeds[ownerIdx * NUM_DIRS + ownerDir]);
+		}
+	}
+
+	ws.settledCells.clear();
+}
+
+// copies the outcome of the solve that just finished in <ws> into
+// the persistent arrays of its group (the cells outside the solve's
+// window keep the values of earlier solves)
+void CCGrid::StoreGroupFields(Workspace& ws) {
+	const Buffer& buffer = ws.buffer;
+	const Window& w = ws.window;
+
+	if (mLazyVelocities) {
+		StoreMemberVelocities(ws);
+	} else {
+		ClearUnsettledVelocities(ws);
+	}
+
+	std::vector<float>& potentials = *ws.potentials;
+
+	for (unsigned int z = w.z0; z <= w.z1; z++) {
+		for (unsigned int x = w.x0; x <= w.x1; x++) {
+			potentials[GRID_INDEX_UNSAFE(x, z)] = buffer.GetPotential(GRID_INDEX_UNSAFE(x, z));
+		}
+	}
+
+	if (ws.visCapture == NULL) {
+		return;
+	}
+
+	GroupVisCapture& capture = *ws.visCapture;
+
+	unsigned int cellEdges[NUM_DIRS] = {0};
+
+	for (unsigned int z = w.z0; z <= w.z1; z++) {
+		for (unsigned int x = w.x0; x <= w.x1; x++) {
+			const unsigned int cellIdx = GRID_INDEX_UNSAFE(x, z);
+
+			const bool visited = buffer.IsCurrentCell(cellIdx);
+
+			GetCellEdgeIndices(cellIdx, cellEdges);
+
+			for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+				capture.speeds[cellIdx * NUM_DIRS + dir] = visited? buffer.speeds[cellIdx * NUM_DIRS + dir]: 0.0f;
+				capture.costs[cellIdx * NUM_DIRS + dir] = visited? buffer.costs[cellIdx * NUM_DIRS + dir]: 0.0f;
+				capture.potentialDeltas[cellIdx * NUM_DIRS + dir] = buffer.GetPotentialDelta(cellEdges[dir]) * (mSquareSize >> 1);
+			}
+		}
+	}
 }
 
 
@@ -159,10 +477,31 @@ void CCGrid::Kill() {
 	mAvgVelocityVisData.clear();
 	mHeightDeltaVisData.clear();
 
-	mTouchedCells.clear();
+	// clear the per-group snapshots and captures
+	mPotentialVisData.clear();
+	mVelocityVisData.clear();
+	mGroupVisCaptures.clear();
+	mVisCaptureRequests.clear();
 
-	mGridStates[mCurrBufferIdx].cells.clear(); mGridStates[mCurrBufferIdx].edges.clear();
-	mGridStates[mPrevBufferIdx].cells.clear(); mGridStates[mPrevBufferIdx].edges.clear();
+	mTouchedCellFlags.clear();
+	mTouchedCells.clear();
+	mDiscSpans.clear();
+	mSplatBands.clear();
+
+	mDensities.clear();
+	mHeights.clear();
+	mAvgVelocities.clear();
+	mStaticDiscomforts.clear();
+	mMobileDiscomforts.clear();
+	mTmpIDs.clear();
+	mHeightDeltas.clear();
+	mLandmarkDistances.clear();
+	mStaticSpeedCostFields.clear();
+	mWorkspaces.clear();
+	mGroupSchedules.clear();
+
+	delete mWorkerPool;
+	mWorkerPool = NULL;
 }
 
 void CCGrid::Init(unsigned int downScaleFactor, ICallOutHandler* coh) {
@@ -187,6 +526,42 @@ void CCGrid::Init(unsigned int downScaleFactor, ICallOutHandler* coh) {
 	mUpdateInt   = mCOH->GetFloatConfigParam(tableNames, "updateInt",   1.0f);
 	mUpdateMode  = mCOH->GetFloatConfigParam(tableNames, "updateMode",  1.0f);
 
+	mUpdateBudget = mCOH->GetFloatConfigParam(tableNames, "updateBudget", 6144.0f);
+
+	mSolver           = mCOH->GetFloatConfigParam(tableNames, "solver",           SOLVER_FMM);
+	mFSMMaxIterations = mCOH->GetFloatConfigParam(tableNames, "fsmMaxIterations", 16.0f);
+
+	mFMMQueueMode   = mCOH->GetFloatConfigParam(tableNames, "fmmQueue",       FMM_QUEUE_HEAP);
+	mFMMBucketWidth = mCOH->GetFloatConfigParam(tableNames, "fmmBucketWidth", 0.0f);
+	mFMMCheckError  = mCOH->GetFloatConfigParam(tableNames, "fmmCheckError",  0.0f) != 0.0f;
+
+	mFMMEarlyExit       = mCOH->GetFloatConfigParam(tableNames, "fmmEarlyExit",       0.0f) != 0.0f;
+	mFMMEarlyExitMargin = mCOH->GetFloatConfigParam(tableNames, "fmmEarlyExitMargin", 2.0f);
+	mFMMHeuristic       = mCOH->GetFloatConfigParam(tableNames, "fmmHeuristic",       0.0f) != 0.0f;
+	mNumLandmarks       = mCOH->GetFloatConfigParam(tableNames, "fmmNumLandmarks",    8.0f);
+
+	mLazyVelocities     = mCOH->GetFloatConfigParam(tableNames, "lazyVelocities",     0.0f) != 0.0f;
+	mLazyVelocityMargin = mCOH->GetFloatConfigParam(tableNames, "lazyVelocityMargin", 2.0f);
+
+	// the heuristic only pays off when a solve can stop early
+	mFMMHeuristic = (mFMMHeuristic && mFMMEarlyExit && mSolver == SOLVER_FMM);
+	// the FSM derives its velocities in a separate pass already
+	mLazyVelocities = (mLazyVelocities && mSolver == SOLVER_FMM);
+	mNumLandmarks = mFMMHeuristic? std::max(mNumLandmarks, 1U): 0;
+
+	const unsigned int fmmNumBuckets = mCOH->GetFloatConfigParam(tableNames, "fmmNumBuckets", 256.0f);
+
+	// number of groups whose fields are solved concurrently; 0
+	// means one per hardware thread (the results are identical
+	// for every value)
+	unsigned int numThreads = mCOH->GetFloatConfigParam(tableNames, "numThreads", 1.0f);
+
+	if (numThreads == 0) {
+		numThreads = WorkerPool::GetNumHardwareThreads();
+	}
+
+	mWorkerPool = new WorkerPool(numThreads);
+
 	// NOTE:
 	//   the slope (height difference) from A to B is equal to the inverse
 	//   slope from B to A, therefore we take the absolute value at every
@@ -204,13 +579,37 @@ void CCGrid::Init(unsigned int downScaleFactor, ICallOutHandler* coh) {
 	printf("\tSPEED_COST_POTENTIAL_MERGED_COMPUTATION: %d\n", SPEED_COST_POTENTIAL_MERGED_COMPUTATION);
 	printf("\tSPEED_COST_SINGLE_PASS_COMPUTATION:      %d\n", SPEED_COST_SINGLE_PASS_COMPUTATION);
 	printf("\tSPEED_COST_DIRECTIONAL_DISCOMFORT:       %d\n", SPEED_COST_DIRECTIONAL_DISCOMFORT);
+	printf("\tSPEED_COST_STATIC_FIELD_CACHE:           %d\n", SPEED_COST_STATIC_FIELD_CACHE);
 	printf("\n");
 	printf("\tVELOCITY_FIELD_DIRECT_INTERPOLATION:     %d\n", VELOCITY_FIELD_DIRECT_INTERPOLATION);
 	printf("\tVELOCITY_FIELD_BILINEAR_INTERPOLATION:   %d\n", VELOCITY_FIELD_BILINEAR_INTERPOLATION);
+	printf("\n");
+	printf("\tSTAGGERED_UPDATE_CHECK_INTERVAL:         %d\n", STAGGERED_UPDATE_CHECK_INTERVAL);
+	printf("\tTOUCHED_CELLS_SORTED:                    %d\n", TOUCHED_CELLS_SORTED);
+	printf("\tGROUP_VIS_MAX_CAPTURES:                  %d\n", GROUP_VIS_MAX_CAPTURES);
+	printf("\tGROUP_VELOCITY_FIELD_HALF_PRECISION:     %d\n", GROUP_VELOCITY_FIELD_HALF_PRECISION);
+	printf("\tFMM_TRACE_TOUCHED_BYTES:                 %d\n", FMM_TRACE_TOUCHED_BYTES);
+	printf("\tLANDMARK_MAX_DISCOMFORT_OFFSET:          %d\n", LANDMARK_MAX_DISCOMFORT_OFFSET);
+	printf("\n");
+	printf("\tupdate mode: %s (budget: %u cells)\n", (mUpdateMode == UPDATE_MODE_STAGGERED)? "staggered": "all-at-once", mUpdateBudget);
+	printf("\tsolver: %s (max. FSM iterations: %u)\n", (mSolver == SOLVER_FSM)? "FSM": "FMM", mFSMMaxIterations);
+	printf("\tFMM queue: %s (buckets: %u, width: %f, error-check: %d)\n",
+		(mFMMQueueMode == FMM_QUEUE_UNTIDY)? "untidy": "heap",
+		fmmNumBuckets, mFMMBucketWidth, mFMMCheckError);
+	printf("\tFMM early exit: %d (margin: %u cells)\n", mFMMEarlyExit, mFMMEarlyExitMargin);
+	printf("\tFMM heuristic: %d (landmarks: %u)\n", mFMMHeuristic, mNumLandmarks);
+	printf("\tlazy velocity-fields: %d (margin: %u cells)\n", mLazyVelocities, mLazyVelocityMargin);
+	printf("\tsolver threads: %u\n", numThreads);
+	printf("\tworkspace state: %u bytes per cell, %u bytes per edge\n", Buffer::GetCellSize(), Buffer::GetEdgeSize());
 
 	const unsigned int numCells = numCellsX * numCellsZ;
 	const unsigned int numEdges = (numCellsX + 1) * numCellsZ + (numCellsZ + 1) * numCellsX;
 
+	// every group keeps its potential- and velocity-field
+	printf("\tper-group fields: %u bytes (%u bytes per cell, %u bytes per edge)\n",
+		numCells * unsigned(sizeof(float)) + numEdges * unsigned(sizeof(EdgeVelocity)),
+		unsigned(sizeof(float)), unsigned(sizeof(EdgeVelocity)));
+
 	// visualisation data for global scalar fields
 	mDensityVisData.resize(numCells, 0.0f);
 	mHeightVisData.resize(numCells, 0.0f);
@@ -220,92 +619,34 @@ void CCGrid::Init(unsigned int downScaleFactor, ICallOutHandler* coh) {
 	mAvgVelocityVisData.resize(numCells, NVECf);
 	mHeightDeltaVisData.resize(numCells * NUM_DIRS);
 
-
-	Buffer& currGridBuffer = mGridStates[mCurrBufferIdx];
-	Buffer& prevGridBuffer = mGridStates[mPrevBufferIdx];
-
-	std::vector<Cell      >& currCells = currGridBuffer.cells; currCells.reserve(numCells);
-	std::vector<Cell      >& prevCells = prevGridBuffer.cells; prevCells.reserve(numCells);
-	std::vector<Cell::Edge>& currEdges = currGridBuffer.edges; currEdges.reserve(numEdges);
-	std::vector<Cell::Edge>& prevEdges = prevGridBuffer.edges; prevEdges.reserve(numEdges);
-
-	for (unsigned int y = 0; y < numCellsZ; y++) {
-		for (unsigned int x = 0; x < numCellsX; x++) {
-			currCells.push_back(Cell(x, y));
-			prevCells.push_back(Cell(x, y));
-			currEdges.push_back(CCGrid::Cell::Edge()); // Wf
-			currEdges.push_back(CCGrid::Cell::Edge()); // Nf
-			prevEdges.push_back(CCGrid::Cell::Edge()); // Wb
-			prevEdges.push_back(CCGrid::Cell::Edge()); // Nb
-
-			Cell* currCell = &currCells.back();
-			Cell* prevCell = &prevCells.back();
-
-			unsigned int cellIdx = 0;
-			unsigned int edgeIdxW = currEdges.size() - 2;
-			unsigned int edgeIdxN = currEdges.size() - 1;
-
-			currCell->edges[DIR_N] = edgeIdxN;
-			currCell->edges[DIR_W] = edgeIdxW;
-			prevCell->edges[DIR_N] = edgeIdxN;
-			prevCell->edges[DIR_W] = edgeIdxW;
-
-			// bind the east face of the cell west of the current cell
-			if (x > 0) {
-				cellIdx = GRID_INDEX_UNSAFE(x - 1, y);
-				PFFG_ASSERT(cellIdx < currCells.size());
-
-				Cell* currWestCell = &currCells[cellIdx];
-				Cell* prevWestCell = &prevCells[cellIdx];
-				currWestCell->edges[DIR_E] = edgeIdxW;
-				prevWestCell->edges[DIR_E] = edgeIdxW;
-			}
-
-			// bind the south face of the cell north of the current cell
-			if (y > 0) {
-				cellIdx = GRID_INDEX_UNSAFE(x, y - 1);
-				PFFG_ASSERT(cellIdx < currCells.size());
-
-				Cell* currNorthCell = &currCells[cellIdx];
-				Cell* prevNorthCell = &prevCells[cellIdx];
-				currNorthCell->edges[DIR_S] = edgeIdxN;
-				prevNorthCell->edges[DIR_S] = edgeIdxN;
-			}
-
-			// bind a new face to the southern face of the border cell
-			if (y == numCellsZ - 1) {
-				currEdges.push_back(CCGrid::Cell::Edge());
-				prevEdges.push_back(CCGrid::Cell::Edge());
-				currCell->edges[DIR_S] = currEdges.size() - 1;
-				prevCell->edges[DIR_S] = prevEdges.size() - 1;
-			}
-
-			// bind a new face to the eastern face of the border cell
-			if (x == numCellsX - 1) {
-				currEdges.push_back(CCGrid::Cell::Edge());
-				prevEdges.push_back(CCGrid::Cell::Edge());
-				currCell->edges[DIR_E] = currEdges.size() - 1;
-				prevCell->edges[DIR_E] = prevEdges.size() - 1;
-			}
-		}
+	mDensities.resize(numCells, 0.0f);
+	mHeights.resize(numCells, 0.0f);
+	mAvgVelocities.resize(numCells, NVECf);
+	mStaticDiscomforts.resize(numCells, NVECf);
+	mMobileDiscomforts.resize(numCells, NVECf);
+	mTmpIDs.resize(numCells, 0);
+	mTouchedCellFlags.resize(numCells, 0);
+	mTouchedCells.reserve(numCells);
+	BuildDiscSpans(DISC_STENCIL_INIT_RADIUS);
+	mSplatBands.resize(mWorkerPool->GetNumWorkers());
+	mDiscomfortTmpID = -1;
+	mNumVisCaptureRequests = 0;
+
+	for (unsigned int n = 0; n < mSplatBands.size(); n++) {
+		SplatBand& band = mSplatBands[n];
+
+		band.minZ = (numCellsZ * (n    )) / mSplatBands.size();
+		band.maxZ = (numCellsZ * (n + 1)) / mSplatBands.size() - 1;
+		band.discomfortStamp.Init(numCellsZ);
 	}
+	mHeightDeltas.resize(numEdges, NVECf);
 
-	PFFG_ASSERT(currCells.size() == numCells);
-	PFFG_ASSERT(prevEdges.size() == numEdges);
-
-	// perform a full reset of the cells and compute their heights
+	// compute the cell heights, assuming the heightmap is static
 	for (unsigned int y = 0; y < numCellsZ; y++) {
 		for (unsigned int x = 0; x < numCellsX; x++) {
-			Cell* currCell = &currCells[GRID_INDEX_UNSAFE(x, y)];
-			Cell* prevCell = &prevCells[GRID_INDEX_UNSAFE(x, y)];
-
-			// set potential to +inf, etc.
-			currCell->ResetFull();
-			prevCell->ResetFull();
+			const unsigned int idx = GRID_INDEX_UNSAFE(x, y);
 
-			// set the height, assuming the heightmap is static
-			currCell->height = ELEVATION(x, y);
-			prevCell->height = ELEVATION(x, y);
+			mHeights[idx] = ELEVATION(x, y);
 
 			// set the baseline static discomfort values
 			// NOTE:
@@ -317,134 +658,224 @@ void CCGrid::Init(unsigned int downScaleFactor, ICallOutHandler* coh) {
 			//
 			//    for now, avoid higher areas (problem: discomfort is a much larger
 			//    term than speed, but needs to be around same order of magnitude)
-			currCell->staticDiscomfort.y = mFlatTerrain? 0.0f: ((currCell->height - mCOH->GetMinMapHeight()) / (mCOH->GetMaxMapHeight() - mCOH->GetMinMapHeight()));
-			prevCell->staticDiscomfort.y = mFlatTerrain? 0.0f: ((currCell->height - mCOH->GetMinMapHeight()) / (mCOH->GetMaxMapHeight() - mCOH->GetMinMapHeight()));
+			mStaticDiscomforts[idx].y = mFlatTerrain? 0.0f: ((mHeights[idx] - mCOH->GetMinMapHeight()) / (mCOH->GetMaxMapHeight() - mCOH->GetMinMapHeight()));
 
-			mHeightVisData[GRID_INDEX_UNSAFE(x, y)] = currCell->height;
-			mDiscomfortVisData[GRID_INDEX_UNSAFE(x, y)] = currCell->staticDiscomfort;
+			mHeightVisData[idx] = mHeights[idx];
+			mDiscomfortVisData[idx] = mStaticDiscomforts[idx];
 		}
 	}
 
-	// compute gradient-heights and neighbors
+	// compute the gradient-heights
 	for (unsigned int y = 0; y < numCellsZ; y++) {
 		for (unsigned int x = 0; x < numCellsX; x++) {
-			unsigned int idx = GRID_INDEX_UNSAFE(x, y);
-			unsigned int dir = 0;
+			const unsigned int idx = GRID_INDEX_UNSAFE(x, y);
 
-			Cell* currCell = &currCells[idx];
-			Cell* prevCell = &prevCells[idx];
-
-			Cell* currNgb = NULL;
-			Cell* prevNgb = NULL;
-			Cell::Edge* currEdge = NULL;
-			Cell::Edge* prevEdge = NULL;
+			vec3f* heightDelta = NULL;
 
 			if (y > 0) {
-				dir = DIR_N;
-
-				currEdge = &currEdges[currCell->edges[dir]];
-				prevEdge = &prevEdges[prevCell->edges[dir]];
-				currNgb = &currCells[GRID_INDEX_UNSAFE(x, y - 1)];
-				prevNgb = &prevCells[GRID_INDEX_UNSAFE(x, y - 1)];
-
-				currEdge->heightDelta = vec3f(0.0f, 0.0f, (currNgb->height - currCell->height));
-				prevEdge->heightDelta = vec3f(0.0f, 0.0f, (prevNgb->height - prevCell->height));
-
-				currCell->neighbors[currCell->numNeighbors++] = GRID_INDEX_UNSAFE(x, y - 1);
-				prevCell->neighbors[prevCell->numNeighbors++] = GRID_INDEX_UNSAFE(x, y - 1);
+				heightDelta = &mHeightDeltas[GetEdgeIndex(x, y, DIR_N)];
+				*heightDelta = vec3f(0.0f, 0.0f, (mHeights[GRID_INDEX_UNSAFE(x, y - 1)] - mHeights[idx]));
 
-				mMinTerrainSlope = std::min(mMinTerrainSlope, std::fabs(currEdge->heightDelta.z));
-				mMaxTerrainSlope = std::max(mMaxTerrainSlope, std::fabs(currEdge->heightDelta.z));
+				mMinTerrainSlope = std::min(mMinTerrainSlope, std::fabs(heightDelta->z));
+				mMaxTerrainSlope = std::max(mMaxTerrainSlope, std::fabs(heightDelta->z));
 
 				// NOTE:
 				//  heightDelta is not actually a gradient vector-field!
 				//  (vectors do not represent directions in world-space)
-				mHeightDeltaVisData[idx * NUM_DIRS + dir] = currEdge->heightDelta * ((mSquareSize / mDownScale) >> 1);
+				mHeightDeltaVisData[idx * NUM_DIRS + DIR_N] = (*heightDelta) * ((mSquareSize / mDownScale) >> 1);
 			}
 
 			if (y < numCellsZ - 1) {
-				dir = DIR_S;
+				heightDelta = &mHeightDeltas[GetEdgeIndex(x, y, DIR_S)];
+				*heightDelta = vec3f(0.0f, 0.0f, (mHeights[GRID_INDEX_UNSAFE(x, y + 1)] - mHeights[idx]));
 
-				currEdge = &currEdges[currCell->edges[dir]];
-				prevEdge = &prevEdges[prevCell->edges[dir]];
-				currNgb = &currCells[GRID_INDEX_UNSAFE(x, y + 1)];
-				prevNgb = &prevCells[GRID_INDEX_UNSAFE(x, y + 1)];
+				mMinTerrainSlope = std::min(mMinTerrainSlope, std::fabs(heightDelta->z));
+				mMaxTerrainSlope = std::max(mMaxTerrainSlope, std::fabs(heightDelta->z));
 
-				currEdge->heightDelta = vec3f(0.0f, 0.0f, (currNgb->height - currCell->height));
-				prevEdge->heightDelta = vec3f(0.0f, 0.0f, (prevNgb->height - prevCell->height));
+				mHeightDeltaVisData[idx * NUM_DIRS + DIR_S] = (*heightDelta) * ((mSquareSize / mDownScale) >> 1);
+			}
 
-				currCell->neighbors[currCell->numNeighbors++] = GRID_INDEX_UNSAFE(x, y + 1);
-				prevCell->neighbors[prevCell->numNeighbors++] = GRID_INDEX_UNSAFE(x, y + 1);
+			if (x > 0) {
+				heightDelta = &mHeightDeltas[GetEdgeIndex(x, y, DIR_W)];
+				*heightDelta = vec3f((mHeights[GRID_INDEX_UNSAFE(x - 1, y)] - mHeights[idx]), 0.0f, 0.0f);
 
-				mMinTerrainSlope = std::min(mMinTerrainSlope, std::fabs(currEdge->heightDelta.z));
-				mMaxTerrainSlope = std::max(mMaxTerrainSlope, std::fabs(currEdge->heightDelta.z));
+				mMinTerrainSlope = std::min(mMinTerrainSlope, std::fabs(heightDelta->x));
+				mMaxTerrainSlope = std::max(mMaxTerrainSlope, std::fabs(heightDelta->x));
 
-				mHeightDeltaVisData[idx * NUM_DIRS + dir] = currEdge->heightDelta * ((mSquareSize / mDownScale) >> 1);
+				mHeightDeltaVisData[idx * NUM_DIRS + DIR_W] = (*heightDelta) * ((mSquareSize / mDownScale) >> 1);
 			}
 
-			if (x > 0) {
-				dir = DIR_W;
+			if (x < numCellsX - 1) {
+				heightDelta = &mHeightDeltas[GetEdgeIndex(x, y, DIR_E)];
+				*heightDelta = vec3f((mHeights[GRID_INDEX_UNSAFE(x + 1, y)] - mHeights[idx]), 0.0f, 0.0f);
 
-				currEdge = &currEdges[currCell->edges[dir]];
-				prevEdge = &prevEdges[prevCell->edges[dir]];
-				currNgb = &currCells[GRID_INDEX_UNSAFE(x - 1, y)];
-				prevNgb = &prevCells[GRID_INDEX_UNSAFE(x - 1, y)];
+				mMinTerrainSlope = std::min(mMinTerrainSlope, std::fabs(heightDelta->x));
+				mMaxTerrainSlope = std::max(mMaxTerrainSlope, std::fabs(heightDelta->x));
 
-				currEdge->heightDelta = vec3f((currNgb->height - currCell->height), 0.0f, 0.0f);
-				prevEdge->heightDelta = vec3f((prevNgb->height - prevCell->height), 0.0f, 0.0f);
+				mHeightDeltaVisData[idx * NUM_DIRS + DIR_E] = (*heightDelta) * ((mSquareSize / mDownScale) >> 1);
+			}
+		}
+	}
 
-				currCell->neighbors[currCell->numNeighbors++] = GRID_INDEX_UNSAFE(x - 1, y);
-				prevCell->neighbors[prevCell->numNeighbors++] = GRID_INDEX_UNSAFE(x - 1, y);
+	mWorkspaces.resize(numThreads);
 
-				mMinTerrainSlope = std::min(mMinTerrainSlope, std::fabs(currEdge->heightDelta.x));
-				mMaxTerrainSlope = std::max(mMaxTerrainSlope, std::fabs(currEdge->heightDelta.x));
+	for (unsigned int n = 0; n < mWorkspaces.size(); n++) {
+		Workspace& ws = mWorkspaces[n];
 
-				mHeightDeltaVisData[idx * NUM_DIRS + dir] = currEdge->heightDelta * ((mSquareSize / mDownScale) >> 1);
-			}
+		ws.buffer.Resize(numCells, numEdges);
+		ws.window = GetFullWindow();
+		ws.candidates.reserve(numCells);
+		ws.bucketCandidates.SetNumBuckets(fmmNumBuckets);
 
-			if (x < numCellsX - 1) {
-				dir = DIR_E;
+		if (IsCheckingPotentialError()) {
+			ws.exactPotentials.resize(numCells, 0.0f);
+		}
+		if (mFMMEarlyExit) {
+			ws.settledCells.reserve(numCells);
+		}
+		if (mLazyVelocities) {
+			ws.settleOrders.resize(numCells, 0);
+		}
+		if (mFMMHeuristic) {
+			ws.landmarkBounds.resize(mNumLandmarks * 2, 0.0f);
+			ws.candidateKeys.resize(numCells, 0.0f);
+		}
+		if (mSolver == SOLVER_FSM) {
+			ws.sweepPotentialsY.resize(numCellsX, 0.0f);
+			ws.sweepCostsY.resize(numCellsX, 0.0f);
+		}
+	}
+
+	if (mFMMHeuristic) {
+		ComputeLandmarkDistances();
+	}
 
-				currEdge = &currEdges[currCell->edges[dir]];
-				prevEdge = &prevEdges[prevCell->edges[dir]];
-				currNgb = &currCells[GRID_INDEX_UNSAFE(x + 1, y)];
-				prevNgb = &prevCells[GRID_INDEX_UNSAFE(x + 1, y)];
+	if (mFlatTerrain) {
+		PFFG_ASSERT((mMaxTerrainSlope - mMinTerrainSlope) < EPSILON);
+	}
+}
 
-				currEdge->heightDelta = vec3f((currNgb->height - currCell->height), 0.0f, 0.0f);
-				prevEdge->heightDelta = vec3f((prevNgb->height - prevCell->height), 0.0f, 0.0f);
+// precomputes the landmark tables of the FMM heuristic: for every
+// landmark, the shortest 4-connected path to each cell when every
+// step costs the smallest static discomfort term either of its two
+// cells can contribute to a cost (this is symmetric and ignores the
+// mobile discomfort, so it bounds the discomfort summed by the costs
+// along any path from below no matter where groups move)
+//
+// NOTE:
+//    speed and slope do not need tables: slopes are negative along
+//    one of the two directions of every edge, so the only bound they
+//    admit is the minimal step cost that GetHeuristicBound() applies
+//    per hop; the landmarks themselves are picked greedily, each one
+//    farthest (in hops) from those picked before it
+void CCGrid::ComputeLandmarkDistances() {
+	const unsigned int numCells = numCellsX * numCellsZ;
 
-				currCell->neighbors[currCell->numNeighbors++] = GRID_INDEX_UNSAFE(x + 1, y);
-				prevCell->neighbors[prevCell->numNeighbors++] = GRID_INDEX_UNSAFE(x + 1, y);
+	typedef std::pair<float, unsigned int> QueueElem;
 
-				mMinTerrainSlope = std::min(mMinTerrainSlope, std::fabs(currEdge->heightDelta.x));
-				mMaxTerrainSlope = std::max(mMaxTerrainSlope, std::fabs(currEdge->heightDelta.x));
+	std::vector<float> cellDiscomforts(numCells, 0.0f);
+	std::vector<unsigned int> landmarkHops(numCells, std::numeric_limits<unsigned int>::max());
+	std::vector<QueueElem> queue;
 
-				mHeightDeltaVisData[idx * NUM_DIRS + dir] = currEdge->heightDelta * ((mSquareSize / mDownScale) >> 1);
+	for (unsigned int z = 0; z < numCellsZ; z++) {
+		for (unsigned int x = 0; x < numCellsX; x++) {
+			float minDiscomfort = std::numeric_limits<float>::infinity();
+
+			// the costs of a cell sample the discomfort of the cell
+			// at CELLS_IN_RADIUS(r) + 1 cells along their direction
+			for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+				for (int offset = 1; offset <= LANDMARK_MAX_DISCOMFORT_OFFSET; offset++) {
+					const unsigned int ngbX = CLAMP(int(x) + mDirDeltas[dir].x * offset, 0, int(numCellsX) - 1);
+					const unsigned int ngbZ = CLAMP(int(z) + mDirDeltas[dir].z * offset, 0, int(numCellsZ) - 1);
+
+					const vec3f& discomfort = mStaticDiscomforts[GRID_INDEX_UNSAFE(ngbX, ngbZ)];
+
+					#if (SPEED_COST_DIRECTIONAL_DISCOMFORT == 1)
+					minDiscomfort = std::min(minDiscomfort, discomfort.y * ((discomfort.dot2D(mDirVectors[dir]) * -1.0f) + 1.0f) * 0.5f);
+					#else
+					minDiscomfort = std::min(minDiscomfort, discomfort.y);
+					#endif
+				}
 			}
+
+			cellDiscomforts[GRID_INDEX_UNSAFE(x, z)] = std::max(minDiscomfort, 0.0f);
 		}
 	}
 
-	if (mFlatTerrain) {
-		PFFG_ASSERT((mMaxTerrainSlope - mMinTerrainSlope) < EPSILON);
+	mLandmarkDistances.clear();
+	mLandmarkDistances.resize(mNumLandmarks * numCells, std::numeric_limits<float>::infinity());
+
+	for (unsigned int n = 0, landmarkIdx = 0; n < mNumLandmarks; n++) {
+		float* distances = &mLandmarkDistances[n * numCells];
+
+		// Dijkstra from <landmarkIdx>
+		distances[landmarkIdx] = 0.0f;
+		queue.push_back(QueueElem(0.0f, landmarkIdx));
+
+		while (!queue.empty()) {
+			std::pop_heap(queue.begin(), queue.end(), std::greater<QueueElem>());
+
+			const QueueElem elem = queue.back();
+			const unsigned int cellX = elem.second % numCellsX;
+			const unsigned int cellZ = elem.second / numCellsX;
+
+			queue.pop_back();
+
+			if (elem.first > distances[elem.second]) {
+				continue;
+			}
+
+			for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+				const int ngbX = int(cellX) + mDirDeltas[dir].x;
+				const int ngbZ = int(cellZ) + mDirDeltas[dir].z;
+
+				if (ngbX < 0 || ngbX >= int(numCellsX)) { continue; }
+				if (ngbZ < 0 || ngbZ >= int(numCellsZ)) { continue; }
+
+				const unsigned int ngbIdx = GRID_INDEX_UNSAFE(ngbX, ngbZ);
+				const float ngbDistance = elem.first + std::min(cellDiscomforts[elem.second], cellDiscomforts[ngbIdx]);
+
+				if (ngbDistance < distances[ngbIdx]) {
+					distances[ngbIdx] = ngbDistance;
+					queue.push_back(QueueElem(ngbDistance, ngbIdx));
+					std::push_heap(queue.begin(), queue.end(), std::greater<QueueElem>());
+				}
+			}
+		}
+
+		// the next landmark is the cell farthest from the current ones
+		const unsigned int landmarkX = landmarkIdx % numCellsX;
+		const unsigned int landmarkZ = landmarkIdx / numCellsX;
+
+		for (unsigned int idx = 0, maxHops = 0; idx < numCells; idx++) {
+			const unsigned int x = idx % numCellsX;
+			const unsigned int z = idx / numCellsX;
+			const unsigned int hops =
+				std::max(x, landmarkX) - std::min(x, landmarkX) +
+				std::max(z, landmarkZ) - std::min(z, landmarkZ);
+
+			landmarkHops[idx] = std::min(landmarkHops[idx], hops);
+
+			if (landmarkHops[idx] > maxHops) {
+				maxHops = landmarkHops[idx];
+				landmarkIdx = idx;
+			}
+		}
 	}
 }
 
 void CCGrid::Reset() {
-	std::vector<Cell>& currCells = mGridStates[mCurrBufferIdx].cells;
-	std::vector<Cell>& prevCells = mGridStates[mPrevBufferIdx].cells;
-
 	// undo last frame's dynamic-global data writes
-	for (std::set<unsigned int>::const_iterator it = mTouchedCells.begin(); it != mTouchedCells.end(); ++it) {
-		const unsigned int idx = *it;
-
-		Cell* currCell = &currCells[idx];
-		Cell* prevCell = &prevCells[idx];
+	for (unsigned int n = 0; n < mTouchedCells.size(); n++) {
+		const unsigned int idx = mTouchedCells[n];
 
-		currCell->ResetGlobalDynamicVars();
-		prevCell->ResetGlobalDynamicVars();
+		mTouchedCellFlags[idx]  = 0;
+		mAvgVelocities[idx]     = NVECf;
+		mMobileDiscomforts[idx] = NVECf;
+		mDensities[idx]         = 0.0f;
 
 		mDensityVisData[idx]     = 0.0f;
-		mDiscomfortVisData[idx]  = currCell->staticDiscomfort;
+		mDiscomfortVisData[idx]  = mStaticDiscomforts[idx];
 		mAvgVelocityVisData[idx] = NVECf;
 	}
 
@@ -457,14 +888,12 @@ void CCGrid::Reset() {
 
 
 void CCGrid::AddGlobalDynamicCellData(
-	std::vector<Cell>& currCells,
-	std::vector<Cell>& prevCells,
-	const Cell* cell,
+	SplatBand& band,
+	unsigned int cellIdx,
 	int minCellsInRadius,
 	int maxCellsInRadius,
 	const vec3f& vel,
-	unsigned int cellDataType,
-	unsigned int cellTmpID
+	unsigned int cellDataType
 ) {
 	// if objects are tightly clustered, they project one
 	// large density blob and inter-weaving lanes are much
@@ -478,119 +907,195 @@ void CCGrid::AddGlobalDynamicCellData(
 	// minCellsInRadius = 0;
 	// maxCellsInRadius = 0;
 
-	for (int x = -maxCellsInRadius; x <= maxCellsInRadius; x++) {
-		for (int z = -maxCellsInRadius; z <= maxCellsInRadius; z++) {
-			const int cx = int(cell->x) + x;
-			const int cz = int(cell->y) + z;
-			const int rr = (x * x) + (z * z);
+	const int cellX = cellIdx % numCellsX;
+	const int cellZ = cellIdx / numCellsX;
+
+	// every cell within the disc is visited exactly once, so
+	// the order of the rows and spans does not influence the
+	// accumulated values (only rows inside <band> are written)
+	const int* outerSpans = GetDiscSpans(maxCellsInRadius);
+	const int* innerSpans = GetDiscSpans(minCellsInRadius);
+
+	const int minZ = MMAX(-maxCellsInRadius, band.minZ - cellZ);
+	const int maxZ = MMIN( maxCellsInRadius, band.maxZ - cellZ);
+
+	for (int z = minZ; z <= maxZ; z++) {
+		const int cz = cellZ + z;
+
+		// clip the row's span [cellX - w, cellX + w] to the grid
+		const int w = outerSpans[z + maxCellsInRadius];
+		const int x0 = MMAX(cellX - w, 0);
+		const int x1 = MMIN(cellX + w, int(numCellsX) - 1);
+		const unsigned int rowIdx = GRID_INDEX_UNSAFE(0, cz);
+
+		if (x0 > x1) { continue; }
+
+		switch (cellDataType) {
+			case DATATYPE_DENSITY: {
+				// a unit's density contribution must be *at least* equal
+				// to the threshold value rho_bar within (the cells of) a
+				// bounding disc of radius r, but *at most* rho_min or the
+				// result will be self-obstruction
+				// NOTE: now we require cells that are much larger than
+				// units in order for local density to exceed rho_max or
+				// even rho_min
+				// NOTE: this produces the "sharp density discontinuities"
+				// because cells can go from rho=0 to rho>=rho_max in one
+				// frame due to unit movement ==> need some way to "shift" 
+				// density based on unit's position within the center cell
+				// NOTE: when rho_bar is always <= rho_min, how can we get
+				// avoidance behavior around a *single* non-moving object?
+				//
+				// two contradictory requirements, regardless of cell-size:
+				//     1) units must contribute a minimum amount of density so other units avoid them
+				//     2) units must contribute a maximum amount of density so they do not self-impede
+				// const float scale = 1.0f - ((std::abs(x) + std::abs(z)) / float(cellsInRadius << 1));
+				// const float rho = mRhoBar + ((mRhoMin - mRhoBar - EPSILON) * scale);
+
+				// cells within the inner disc receive rho_bar, those in
+				// the outer ring half of that, and the center cell gets
+				// rho_max
+				const int wi = (std::abs(z) <= minCellsInRadius)? innerSpans[z + minCellsInRadius]: -1;
+				const int xi0 = MMAX(cellX - wi, x0);
+				const int xi1 = MMIN(cellX + wi, x1);
+
+				if (wi < 0 || xi0 > xi1) {
+					AddDensitySpan(band, rowIdx, x0, x1, mRhoBar * 0.5f, vel);
+				} else {
+					AddDensitySpan(band, rowIdx, x0, xi0 - 1, mRhoBar * 0.5f, vel);
+					AddDensitySpan(band, rowIdx, xi1 + 1, x1, mRhoBar * 0.5f, vel);
+
+					if (z == 0 && cellX >= xi0 && cellX <= xi1) {
+						AddDensitySpan(band, rowIdx, xi0, cellX - 1, mRhoBar, vel);
+						AddDensitySpan(band, rowIdx, cellX, cellX, mRhoMax, vel);
+						AddDensitySpan(band, rowIdx, cellX + 1, xi1, mRhoBar, vel);
+					} else {
+						AddDensitySpan(band, rowIdx, xi0, xi1, mRhoBar, vel);
+					}
+				}
+			} break;
+			default: {
+			} break;
+		}
+	}
+}
+
+void CCGrid::AddDensitySpan(SplatBand& band, unsigned int rowIdx, int x0, int x1, float rho, const vec3f& vel) {
+	const vec3f rhoVel = vel * rho;
 
-			bool cellTouched = false;
+	// keep the accumulation free of branches (so it
+	// can be vectorized), touched cells are marked
+	// in a separate pass
+	for (int x = x0; x <= x1; x++) {
+		mDensities[rowIdx + x] += rho;
+		mAvgVelocities[rowIdx + x] += rhoVel;
+	}
+	for (int x = x0; x <= x1; x++) {
+		MarkTouchedCell(band, rowIdx + x);
+	}
+}
 
-			if (cx < 0 || cx >= int(numCellsX)) { continue; }
-			if (cz < 0 || cz >= int(numCellsZ)) { continue; }
+void CCGrid::BuildDiscSpans(int maxRadius) {
+	// the stencil for radius <r> holds one half-width per row
+	// z = -r, ..., r at offset r * r (the stencils for radii
+	// 0, ..., r - 1 take up sum(2k + 1) = r * r entries)
+	while (int(mDiscSpans.size()) < ((maxRadius + 1) * (maxRadius + 1))) {
+		const int r = int(std::sqrt(float(mDiscSpans.size())));
 
-			if (rr > (maxCellsInRadius * maxCellsInRadius)) {
-				continue;
-			}
+		for (int z = -r; z <= r; z++) {
+			int w = 0;
 
-			Cell* cf = &currCells[ GRID_INDEX_UNSAFE(cx, cz) ];
-			Cell* cb = &prevCells[ GRID_INDEX_UNSAFE(cx, cz) ];
-
-			switch (cellDataType) {
-				case DATATYPE_DENSITY: {
-					// a unit's density contribution must be *at least* equal
-					// to the threshold value rho_bar within (the cells of) a
-					// bounding disc of radius r, but *at most* rho_min or the
-					// result will be self-obstruction
-					// NOTE: now we require cells that are much larger than
-					// units in order for local density to exceed rho_max or
-					// even rho_min
-					// NOTE: this produces the "sharp density discontinuities"
-					// because cells can go from rho=0 to rho>=rho_max in one
-					// frame due to unit movement ==> need some way to "shift" 
-					// density based on unit's position within the center cell
-					// NOTE: when rho_bar is always <= rho_min, how can we get
-					// avoidance behavior around a *single* non-moving object?
-					//
-					// two contradictory requirements, regardless of cell-size:
-					//     1) units must contribute a minimum amount of density so other units avoid them
-					//     2) units must contribute a maximum amount of density so they do not self-impede
-					// const float scale = 1.0f - ((std::abs(x) + std::abs(z)) / float(cellsInRadius << 1));
-					// const float rho = mRhoBar + ((mRhoMin - mRhoBar - EPSILON) * scale);
-
-					float rho = mRhoBar;
-
-					if (x == 0 && z == 0) { rho = mRhoMax; }
-					if (rr > (minCellsInRadius * minCellsInRadius)) { rho = mRhoBar * 0.5f; }
-
-					cf->density += rho;
-					cb->density += rho;
-					cf->avgVelocity += (vel * rho);
-					cb->avgVelocity += (vel * rho);
-
-					cellTouched = true;
-				} break;
-				case DATATYPE_DISCOMFORT: {
-					if (cf->tmpID != cellTmpID) {
-						cf->tmpID = cellTmpID;
-						cb->tmpID = cellTmpID;
-
-						// scale the discomfort vector
-						//
-						// NOTE; this causes opposing velocity vectors
-						// projected onto the same cell to cancel out,
-						// so we store the total discomfort value in y
-						// cf->mobileDiscomfort += (vel * mRhoBar);
-						// cb->mobileDiscomfort += (vel * mRhoBar);
-
-						// we require only the direction along xz
-						// cf->mobileDiscomfort.x += (vel.x * mRhoBar);
-						// cf->mobileDiscomfort.z += (vel.z * mRhoBar);
-						// cf->mobileDiscomfort.y += (vel.len2D() * mRhoBar);
-
-						// x and z are normalised later
-						cf->mobileDiscomfort.x += vel.x;
-						cf->mobileDiscomfort.z += vel.z;
-						cf->mobileDiscomfort.y += mRhoBar;
-
-						cb->mobileDiscomfort = cf->mobileDiscomfort;
-
-						cellTouched = true;
-					}
-				} break;
-				default: {
-				} break;
+			// widest x such that (x * x) + (z * z) <= (r * r)
+			while (((w + 1) * (w + 1) + (z * z)) <= (r * r)) {
+				w += 1;
 			}
 
-			if (cellTouched) {
-				mTouchedCells.insert(GRID_INDEX_UNSAFE(cx, cz));
-			}
+			mDiscSpans.push_back(w);
 		}
 	}
 }
 
-void CCGrid::AddDensity(const vec3f& pos, const vec3f& vel, float minRadius, float maxRadius) {
-	std::vector<Cell>& currCells = mGridStates[mCurrBufferIdx].cells;
-	std::vector<Cell>& prevCells = mGridStates[mPrevBufferIdx].cells;
+struct SplatJob: public IWorkerJob {
+	SplatJob(CCGrid* g, const std::vector<CCGrid::ObjectData>* o, const std::vector<unsigned int>* t): grid(g), objects(o), tmpIDs(t) {}
 
-	const Cell* cell = &currCells[ GetCellIndex1D(pos) ];
+	void Execute(unsigned int itemIdx, unsigned int) {
+		grid->AddObjectsToBand(grid->mSplatBands[itemIdx], *objects, *tmpIDs);
+	}
+
+	CCGrid* grid;
+	const std::vector<CCGrid::ObjectData>* objects;
+	const std::vector<unsigned int>* tmpIDs;
+};
+
+void CCGrid::AddObjects(const std::vector<ObjectData>& objects) {
+	std::vector<unsigned int> tmpIDs(objects.size(), 0);
+
+	int maxDiscCells = 0;
+
+	// everything that depends on the object order or grows
+	// shared state is done up-front: every moving object gets
+	// its discomfort tmp-ID and the disc stencils are built for
+	// the largest radius
+	for (unsigned int n = 0; n < objects.size(); n++) {
+		const ObjectData& obj = objects[n];
+
+		const int minCells = CELLS_IN_RADIUS(obj.minRadius);
+		const int maxCells = CELLS_IN_RADIUS(obj.maxRadius);
+
+		maxDiscCells = MMAX(maxDiscCells, MMAX(minCells, maxCells));
+
+		if (obj.addDiscomfort && obj.vel.sqLen2D() > EPSILON) {
+			tmpIDs[n] = mDiscomfortTmpID++;
+		}
+	}
+
+	BuildDiscSpans(maxDiscCells);
+
+	// NOTE:
+	//    the bands partition the rows of the grid, so no cell is
+	//    written by more than one worker and every cell receives
+	//    its contributions in object order (the float sums are the
+	//    same as when splatting serially, for any number of bands)
+	SplatJob job(this, &objects, &tmpIDs);
+	mWorkerPool->Run(&job, mSplatBands.size());
+
+	for (unsigned int n = 0; n < mSplatBands.size(); n++) {
+		SplatBand& band = mSplatBands[n];
+
+		mTouchedCells.insert(mTouchedCells.end(), band.touchedCells.begin(), band.touchedCells.end());
+		band.touchedCells.clear();
+	}
+}
+
+void CCGrid::AddObjectsToBand(SplatBand& band, const std::vector<ObjectData>& objects, const std::vector<unsigned int>& tmpIDs) {
+	for (unsigned int n = 0; n < objects.size(); n++) {
+		const ObjectData& obj = objects[n];
+
+		if (obj.addDensity) {
+			AddDensity(band, obj.pos, obj.vel, obj.minRadius, obj.maxRadius);
+		}
+		if (obj.addDiscomfort) {
+			AddDiscomfort(band, obj.pos, obj.vel, obj.maxRadius, obj.numDiscomfortSteps, obj.discomfortStepSize, tmpIDs[n]);
+		}
+	}
+}
+
+void CCGrid::AddDensity(SplatBand& band, const vec3f& pos, const vec3f& vel, float minRadius, float maxRadius) {
+	const unsigned int cellIdx = GetCellIndex1D(pos);
 
 	const int minCells = CELLS_IN_RADIUS(minRadius);
 	const int maxCells = CELLS_IN_RADIUS(maxRadius);
 
-	AddGlobalDynamicCellData(currCells, prevCells, cell, minCells, maxCells, vel, DATATYPE_DENSITY, -1);
+	AddGlobalDynamicCellData(band, cellIdx, minCells, maxCells, vel, DATATYPE_DENSITY);
 }
 
-void CCGrid::AddDiscomfort(const vec3f& pos, const vec3f& vel, float minRadius, float maxRadius, unsigned int numSteps, float stepSize) {
+void CCGrid::AddDiscomfort(SplatBand& band, const vec3f& pos, const vec3f& vel, float maxRadius, unsigned int numSteps, float stepSize, unsigned int tmpID) {
 	if (vel.sqLen2D() <= EPSILON) {
 		// no predictive discomfort for stationary objects
 		// (density alone should cause those to be avoided)
 		return;
 	}
 
-	std::vector<Cell>& currCells = mGridStates[mCurrBufferIdx].cells;
-	std::vector<Cell>& prevCells = mGridStates[mPrevBufferIdx].cells;
-
 	// NOTE:
 	//    stepSize seems to be crucial for 4-way vortex formation
 	//    but its use here is incorrect (discomfort from a single
@@ -601,55 +1106,169 @@ void CCGrid::AddDiscomfort(const vec3f& pos, const vec3f& vel, float minRadius,
 	// const unsigned int posCellIdx = GetCellIndex1D(pos);
 	// stepSize = 1.0f;
 
-	const int minCells = CELLS_IN_RADIUS(minRadius);
 	const int maxCells = CELLS_IN_RADIUS(maxRadius);
 
-	static unsigned int tmpID = -1;
+	{
+		// the path is a straight line, so the rows of all its
+		// cells lie between those of its first and last cell
+		const int z0 = GetCellIndex1D(pos                            ) / numCellsX;
+		const int z1 = GetCellIndex1D(pos + vel * numSteps * stepSize) / numCellsX;
+
+		if ((MMAX(z0, z1) + maxCells) < band.minZ) { return; }
+		if ((MMIN(z0, z1) - maxCells) > band.maxZ) { return; }
+	}
+
+	int prevCellX = -1;
+	int prevCellZ = -1;
 
+	// the predicted path is stamped as the union of the discs
+	// around the cells of its steps; since the steps lie on a
+	// straight line, the discs of two successive distinct cells
+	// that are at most one cell apart overlap or abut in every
+	// row they share, so the union covers a single span per row
 	for (unsigned int n = 0; n <= numSteps; n++) {
 		const vec3f        stepPos = pos + vel * n * stepSize;
 		const unsigned int cellIdx = GetCellIndex1D(stepPos);
-		const Cell*        cell    = &currCells[cellIdx];
+
+		const int cellX = cellIdx % numCellsX;
+		const int cellZ = cellIdx / numCellsX;
+
+		// successive steps mostly fall into the same cell
+		if (cellX == prevCellX && cellZ == prevCellZ) {
+			continue;
+		}
 
 		// skip our own cell
 		// if (cellIdx == posCellIdx) { continue; }
-		AddGlobalDynamicCellData(currCells, prevCells, cell, minCells, maxCells, vel, DATATYPE_DISCOMFORT, tmpID);
+
+		if (prevCellX >= 0 && (std::abs(cellX - prevCellX) > 1 || std::abs(cellZ - prevCellZ) > 1)) {
+			// the step jumped over a cell, so the spans could
+			// have gaps; flush what we have and start over (the
+			// tmp-ID prevents cells from being stamped twice)
+			FlushDiscomfortStamp(band, vel, tmpID);
+		}
+
+		AddDiscToStamp(band, cellX, cellZ, maxCells);
+
+		prevCellX = cellX;
+		prevCellZ = cellZ;
+	}
+
+	FlushDiscomfortStamp(band, vel, tmpID);
+}
+
+void CCGrid::AddDiscToStamp(SplatBand& band, int cellX, int cellZ, int radius) {
+	DiscomfortStamp& stamp = band.discomfortStamp;
+
+	const int* spans = GetDiscSpans(radius);
+	const int z0 = MMAX(cellZ - radius, band.minZ);
+	const int z1 = MMIN(cellZ + radius, band.maxZ);
+
+	if (z0 > z1) {
+		return;
+	}
+
+	for (int z = z0; z <= z1; z++) {
+		const int w = spans[z - cellZ + radius];
+
+		stamp.minX[z] = MMIN(stamp.minX[z], cellX - w);
+		stamp.maxX[z] = MMAX(stamp.maxX[z], cellX + w);
+	}
+
+	stamp.minZ = MMIN(stamp.minZ, z0);
+	stamp.maxZ = MMAX(stamp.maxZ, z1);
+}
+
+void CCGrid::FlushDiscomfortStamp(SplatBand& band, const vec3f& vel, unsigned int tmpID) {
+	DiscomfortStamp& stamp = band.discomfortStamp;
+
+	for (int z = stamp.minZ; z <= stamp.maxZ; z++) {
+		const int x0 = MMAX(stamp.minX[z], 0);
+		const int x1 = MMIN(stamp.maxX[z], int(numCellsX) - 1);
+		const unsigned int rowIdx = GRID_INDEX_UNSAFE(0, z);
+
+		for (int x = x0; x <= x1; x++) {
+			const unsigned int idx = rowIdx + x;
+
+			if (mTmpIDs[idx] == tmpID) {
+				continue;
+			}
+
+			mTmpIDs[idx] = tmpID;
+
+			// scale the discomfort vector
+			//
+			// NOTE; this causes opposing velocity vectors
+			// projected onto the same cell to cancel out,
+			// so we store the total discomfort value in y
+			// mMobileDiscomforts[idx] += (vel * mRhoBar);
+
+			// we require only the direction along xz
+			// mMobileDiscomforts[idx].x += (vel.x * mRhoBar);
+			// mMobileDiscomforts[idx].z += (vel.z * mRhoBar);
+			// mMobileDiscomforts[idx].y += (vel.len2D() * mRhoBar);
+
+			// x and z are normalised later
+			mMobileDiscomforts[idx].x += vel.x;
+			mMobileDiscomforts[idx].z += vel.z;
+			mMobileDiscomforts[idx].y += mRhoBar;
+
+			MarkTouchedCell(band, idx);
+		}
+
+		stamp.minX[z] = std::numeric_limits<int>::max();
+		stamp.maxX[z] = std::numeric_limits<int>::min();
 	}
 
-	tmpID += 1;
+	stamp.minZ = std::numeric_limits<int>::max();
+	stamp.maxZ = std::numeric_limits<int>::min();
 }
 
 
 
+struct AvgVelocityJob: public IWorkerJob {
+	AvgVelocityJob(CCGrid* g, unsigned int n): grid(g), numItems(n) {}
+
+	void Execute(unsigned int itemIdx, unsigned int) {
+		const unsigned int numCells = grid->mTouchedCells.size();
+
+		grid->ComputeAvgVelocity((numCells * itemIdx) / numItems, (numCells * (itemIdx + 1)) / numItems);
+	}
+
+	CCGrid* grid;
+	unsigned int numItems;
+};
+
 void CCGrid::ComputeAvgVelocity() {
-	std::vector<Cell>& currCells = mGridStates[mCurrBufferIdx].cells;
-	std::vector<Cell>& prevCells = mGridStates[mPrevBufferIdx].cells;
+	#if (TOUCHED_CELLS_SORTED == 1)
+	std::sort(mTouchedCells.begin(), mTouchedCells.end());
+	#endif
 
-	for (std::set<unsigned int>::const_iterator it = mTouchedCells.begin(); it != mTouchedCells.end(); ++it) {
-		const unsigned int idx = *it;
+	// every touched cell is normalised independently
+	AvgVelocityJob job(this, mWorkerPool->GetNumWorkers());
+	mWorkerPool->Run(&job, job.numItems);
+}
 
-		Cell* cf = &currCells[idx];
-		Cell* cb = &prevCells[idx];
+void CCGrid::ComputeAvgVelocity(unsigned int minTouchedIdx, unsigned int maxTouchedIdx) {
+	for (unsigned int n = minTouchedIdx; n < maxTouchedIdx; n++) {
+		const unsigned int idx = mTouchedCells[n];
 
 		// v(i) is multiplied by rho(i) when summing v-bar,
 		// so we need to divide by the non-normalised rho
 		// to get the final per-cell average velocity
-		if (cf->density > EPSILON) {
-			cf->avgVelocity /= cf->density;
-			cb->avgVelocity  = cf->avgVelocity;
+		if (mDensities[idx] > EPSILON) {
+			mAvgVelocities[idx] /= mDensities[idx];
 		}
 		// normalise xz to get the mobile discomfort direction
 		// (should be more or less equal to avgVelocity, static
 		// discomfort is assumed to already be normalised)
-		if (cf->mobileDiscomfort.sqLen2D() > EPSILON) {
-			cf->mobileDiscomfort = cf->mobileDiscomfort.norm2D();
-			cb->mobileDiscomfort = cf->mobileDiscomfort;
+		if (mMobileDiscomforts[idx].sqLen2D() > EPSILON) {
+			mMobileDiscomforts[idx] = mMobileDiscomforts[idx].norm2D();
 		}
 
 		// note: unnecessary? (density is only used to
 		// decide between topological and flow speed)
-		cf->density = CLAMP(cf->density, 0.0f, mRhoMax + EPSILON);
-		cb->density = CLAMP(cb->density, 0.0f, mRhoMax + EPSILON);
+		mDensities[idx] = CLAMP(mDensities[idx], 0.0f, mRhoMax + EPSILON);
 
 		// normalise the cell densities, so that comparisons with
 		// mRhoMin and mRhoMax are well-defined when constructing
@@ -663,8 +1282,7 @@ void CCGrid::ComputeAvgVelocity() {
 		//     density circle ==> if there is only one unit present,
 		//     the normalised density would become 1 which exceeds
 		//     rho_max (since the rho_* values still lie in [0, 1])
-		// cf->density /= mMaxDensity;
-		// cb->density  = cf->density;
+		// mDensities[idx] /= mMaxDensity;
 
 		// NOTE: this is probably not what we want, since
 		// more crowded cells now automatically receive a
@@ -673,12 +1291,11 @@ void CCGrid::ComputeAvgVelocity() {
 		// (it also does not make much sense, given that
 		// v-bar is a summation of v(i) * rho(i) terms)
 		//
-		// cf->avgVelocity *= (1.0f - cf->density);
-		// cb->avgVelocity  = cf->avgVelocity;
+		// mAvgVelocities[idx] *= (1.0f - mDensities[idx]);
 
-		mDensityVisData[idx]     = cf->density;
-		mDiscomfortVisData[idx]  = cf->staticDiscomfort + cf->mobileDiscomfort;
-		mAvgVelocityVisData[idx] = cf->avgVelocity;
+		mDensityVisData[idx]     = mDensities[idx];
+		mDiscomfortVisData[idx]  = mStaticDiscomforts[idx] + mMobileDiscomforts[idx];
+		mAvgVelocityVisData[idx] = mAvgVelocities[idx];
 	}
 }
 
@@ -794,48 +1411,88 @@ void CCGrid::ComputeAvgVelocity() {
 //    asserts; this happens for cells with density <= mRhoMin
 //    whenever topoSpeed is less than or equal to zero as well
 //
-void CCGrid::ComputeCellSpeedAndCost(unsigned int groupID, unsigned int cellIdx, std::vector<Cell>& currCells, std::vector<Cell::Edge>& currEdges) {
-	Cell* currCell = &currCells[cellIdx];
+//    if <emptyCells> is true, every sampled cell is treated as if
+//    it had no density, avg. velocity or mobile discomfort (this
+//    is how the static per speed-class fields are computed)
+//
+void CCGrid::ComputeCellSpeedAndCost(Workspace& ws, unsigned int cellIdx, Buffer& buffer, bool emptyCells) {
+	const unsigned int cellX = cellIdx % numCellsX;
+	const unsigned int cellY = cellIdx / numCellsX;
 
 	// this assumes a unit's contribution to the density field
 	// is no greater than rho-bar outside a disc of radius <r>
 	// (such that f == f_topological when rho_min >= rho_bar)
 	//
-	// however, when mMaxGroupRadius < (mSquareSize >> 1) this
+	// however, when ws.maxGroupRadius < (mSquareSize >> 1) this
 	// just maps to <currCell>, hence the CELLS_IN_RADIUS macro
 	// (which ensures a minimum offset of 1 cell) is used here
 	// instead
 	//
 	// const vec3f& cellPos = GetCellMidPos(currCell);
-	// const vec3f densityDirOffset = mDirVectors[dir] * (mMaxGroupRadius + EPSILON);
+	// const vec3f densityDirOffset = mDirVectors[dir] * (ws.maxGroupRadius + EPSILON);
 	// const Cell* currCellDirNgbR = &currCells[ GetCellIndex1D(cellPos + densityDirOffset) ];
 	//
 	// add one cell so we always sample outside a unit's disc
-	const unsigned int densityDirOffset = CELLS_IN_RADIUS(mMaxGroupRadius) + 1;
+	const unsigned int densityDirOffset = CELLS_IN_RADIUS(ws.maxGroupRadius) + 1;
 
 	for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
-		const unsigned int densityDirIndex = GRID_INDEX_CLAMPED(
-			currCell->x + mDirDeltas[dir].x * densityDirOffset,
-			currCell->y + mDirDeltas[dir].z * densityDirOffset);
+		const unsigned int ngbIdxR = GRID_INDEX_CLAMPED(
+			cellX + mDirDeltas[dir].x * densityDirOffset,
+			cellY + mDirDeltas[dir].z * densityDirOffset);
+		unsigned int ngbIdxC = cellIdx;
+
+		const vec3f& currCellDirEdge = mHeightDeltas[GetEdgeIndex(cellX, cellY, dir)];
 
-		const Cell*       currCellDirNgbR = &currCells[densityDirIndex];
-		const Cell*       currCellDirNgbC = NULL;
-		const Cell::Edge* currCellDirEdge = &currEdges[currCell->edges[dir]];
+		FMM_TRACE_TOUCH(ws, currCellDirEdge);
+		FMM_TRACE_TOUCH(ws, buffer.speeds[cellIdx * NUM_DIRS + dir]);
+		FMM_TRACE_TOUCH(ws, buffer.costs[cellIdx * NUM_DIRS + dir]);
 
 		#if (SPEED_COST_SHARED_NEIGHBOR_CELL == 0)
 			switch (dir) {
-				case DIR_N: { currCellDirNgbC = (currCell->y >             0)? &currCells[GRID_INDEX_UNSAFE(currCell->x,     currCell->y - 1)]: currCell; } break;
-				case DIR_S: { currCellDirNgbC = (currCell->y < numCellsZ - 1)? &currCells[GRID_INDEX_UNSAFE(currCell->x,     currCell->y + 1)]: currCell; } break;
-				case DIR_E: { currCellDirNgbC = (currCell->x < numCellsX - 1)? &currCells[GRID_INDEX_UNSAFE(currCell->x + 1, currCell->y    )]: currCell; } break;
-				case DIR_W: { currCellDirNgbC = (currCell->x >             0)? &currCells[GRID_INDEX_UNSAFE(currCell->x - 1, currCell->y    )]: currCell; } break;
+				case DIR_N: { ngbIdxC = (cellY >             0)? GRID_INDEX_UNSAFE(cellX,     cellY - 1): cellIdx; } break;
+				case DIR_S: { ngbIdxC = (cellY < numCellsZ - 1)? GRID_INDEX_UNSAFE(cellX,     cellY + 1): cellIdx; } break;
+				case DIR_E: { ngbIdxC = (cellX < numCellsX - 1)? GRID_INDEX_UNSAFE(cellX + 1, cellY    ): cellIdx; } break;
+				case DIR_W: { ngbIdxC = (cellX >             0)? GRID_INDEX_UNSAFE(cellX - 1, cellY    ): cellIdx; } break;
 			}
 		#else
 			// use the same neighbor (to sample density,
 			// discomfort, and vAvg from) for C as for f
-			currCellDirNgbC = currCellDirNgbR;
+			ngbIdxC = ngbIdxR;
+		#endif
+
+		#if (SPEED_COST_STATIC_FIELD_CACHE == 1)
+		FMM_TRACE_TOUCH(ws, mTouchedCellFlags[ngbIdxR]);
+		FMM_TRACE_TOUCH(ws, mTouchedCellFlags[ngbIdxC]);
+
+		if (ws.staticCosts != NULL && (mTouchedCellFlags[ngbIdxR] | mTouchedCellFlags[ngbIdxC]) == 0) {
+			// untouched cells are empty, so nothing but the terrain
+			// distinguishes this cost from that of the speed-class
+			FMM_TRACE_TOUCH(ws, ws.staticCosts->speeds[cellIdx * NUM_DIRS + dir]);
+			FMM_TRACE_TOUCH(ws, ws.staticCosts->costs[cellIdx * NUM_DIRS + dir]);
+
+			buffer.speeds[cellIdx * NUM_DIRS + dir] = ws.staticCosts->speeds[cellIdx * NUM_DIRS + dir];
+			buffer.costs[cellIdx * NUM_DIRS + dir] = ws.staticCosts->costs[cellIdx * NUM_DIRS + dir];
+			continue;
+		}
 		#endif
 
-		const float cellDirSlope      = currCellDirEdge->heightDelta.dot2D(mDirVectors[dir]);
+		const float densityR = emptyCells? 0.0f: mDensities[ngbIdxR];
+		const float densityC = emptyCells? 0.0f: mDensities[ngbIdxC];
+		const vec3f avgVelocityR = emptyCells? NVECf: mAvgVelocities[ngbIdxR];
+		const vec3f avgVelocityC = emptyCells? NVECf: mAvgVelocities[ngbIdxC];
+		const vec3f mobileDiscomfortC = emptyCells? NVECf: mMobileDiscomforts[ngbIdxC];
+
+		if (!emptyCells) {
+			FMM_TRACE_TOUCH(ws, mDensities[ngbIdxR]);
+			FMM_TRACE_TOUCH(ws, mDensities[ngbIdxC]);
+			FMM_TRACE_TOUCH(ws, mAvgVelocities[ngbIdxR]);
+			FMM_TRACE_TOUCH(ws, mAvgVelocities[ngbIdxC]);
+			FMM_TRACE_TOUCH(ws, mMobileDiscomforts[ngbIdxC]);
+		}
+
+		FMM_TRACE_TOUCH(ws, mStaticDiscomforts[ngbIdxC]);
+
+		const float cellDirSlope      = currCellDirEdge.dot2D(mDirVectors[dir]);
 		      float cellDirSlopeMod   = 0.0f;
 		      float cellDirDiscomfort = 0.0f;
 
@@ -844,8 +1501,8 @@ void CCGrid::ComputeCellSpeedAndCost(unsigned int groupID, unsigned int cellIdx,
 			//   dot  1.0 (parallel) ==> minimal discomfort contribution to cost ==> scale ((( 1.0 * -1.0) + 1.0) * 0.5) = 0.0
 			//   dot  0.0 (orthogon) ==> medium  discomfort contribution to cost ==> scale ((( 0.0 * -1.0) + 1.0) * 0.5) = 0.5
 			//   dot -1.0 (opposite) ==> maximum discomfort contribution to cost ==> scale (((-1.0 * -1.0) + 1.0) * 0.5) = 1.0
-			const float staticDiscomfortScale = ((currCellDirNgbC->staticDiscomfort.dot2D(mDirVectors[dir]) * -1.0f) + 1.0f) * 0.5f;
-			const float mobileDiscomfortScale = ((currCellDirNgbC->mobileDiscomfort.dot2D(mDirVectors[dir]) * -1.0f) + 1.0f) * 0.5f;
+			const float staticDiscomfortScale = ((mStaticDiscomforts[ngbIdxC].dot2D(mDirVectors[dir]) * -1.0f) + 1.0f) * 0.5f;
+			const float mobileDiscomfortScale = ((mobileDiscomfortC.dot2D(mDirVectors[dir]) * -1.0f) + 1.0f) * 0.5f;
 
 			// for a unit moving in a direction parallel to a discomfort zone,
 			// the discomfort inside the zone should still be slightly higher
@@ -856,286 +1513,913 @@ void CCGrid::ComputeCellSpeedAndCost(unsigned int groupID, unsigned int cellIdx,
 			// with their own (thus both experience minimal discomfort value)
 			// can be partially offset with more (hundreds) prediction frames
 			cellDirDiscomfort =
-				currCellDirNgbC->staticDiscomfort.y * staticDiscomfortScale +
-				currCellDirNgbC->mobileDiscomfort.y * mobileDiscomfortScale;
+				mStaticDiscomforts[ngbIdxC].y * staticDiscomfortScale +
+				mobileDiscomfortC.y * mobileDiscomfortScale;
 		#else
 			cellDirDiscomfort =
-				currCellDirNgbC->staticDiscomfort.y +
-				currCellDirNgbC->mobileDiscomfort.y;
+				mStaticDiscomforts[ngbIdxC].y +
+				mobileDiscomfortC.y;
+		#endif
+
+		float cellDirSpeedR = 0.0f; // f_{M --> dir} for computing f, based on offset density (R=RHO)
+		float cellDirSpeedC = 0.0f; // f_{M --> dir} for computing C, based on direct neighbor density (C=COST)
+		float cellDirCost   = 0.0f; // C_{M --> dir}
+
+		{
+			// if the slope is positive along <dir>, we want a positive slopeSpeedScale
+			// if the slope is negative along <dir>, we want a negative slopeSpeedScale
+			//
+			// since (s_max - s_min) is always positive and (f_min - f_max) is always
+			// negative, the numerator (s - s_min) must be greater than 0 to achieve a
+			// speed-decrease on positive slopes and smaller than 0 to achieve a speed-
+			// increase on negative slopes
+			if (POSITIVE_SLOPE(dir, cellDirSlope)) { cellDirSlopeMod =  std::fabs(cellDirSlope); }
+			if (NEGATIVE_SLOPE(dir, cellDirSlope)) { cellDirSlopeMod = -std::fabs(cellDirSlope); }
+
+			const float densityDirSpeedScaleR = (densityR - mRhoMin) / (mRhoMax - mRhoMin);
+			const float densityDirSpeedScaleC = (densityC - mRhoMin) / (mRhoMax - mRhoMin);
+
+			const float slopeDirSpeedScale   = mFlatTerrain? 0.0f: ((cellDirSlopeMod - mMinTerrainSlope) / (mMaxTerrainSlope - mMinTerrainSlope));
+			const float cellDirTopoSpeed     = ws.maxGroupSpeed + CLAMP(slopeDirSpeedScale, -1.0f, 1.0f) * (ws.minGroupSpeed - ws.maxGroupSpeed);
+
+			const float cellDirFlowSpeedR = std::max(0.0f, avgVelocityR.dot2D(mDirVectors[dir]));
+			const float cellDirFlowSpeedC = std::max(0.0f, avgVelocityC.dot2D(mDirVectors[dir]));
+
+			const float cellDirTopoFlowSpeedR = cellDirTopoSpeed + densityDirSpeedScaleR * (cellDirTopoSpeed - cellDirFlowSpeedR);
+			const float cellDirTopoFlowSpeedC = cellDirTopoSpeed + densityDirSpeedScaleC * (cellDirTopoSpeed - cellDirFlowSpeedC);
+
+			// default to linear interpolation of topological and flow speed
+			cellDirSpeedR = cellDirTopoFlowSpeedR;
+			cellDirSpeedC = cellDirTopoFlowSpeedC;
+
+			if (densityR >= mRhoMax) { cellDirSpeedR = cellDirFlowSpeedR; }
+			if (densityR <= mRhoMin) { cellDirSpeedR = cellDirTopoSpeed;  }
+
+			if (densityC >= mRhoMax) { cellDirSpeedC = cellDirFlowSpeedC; }
+			if (densityC <= mRhoMin) { cellDirSpeedC = cellDirTopoSpeed;  }
+
+			if (cellDirSpeedC > EPSILON) {
+				cellDirCost = ((mAlphaWeight * cellDirSpeedC) + mBetaWeight + (mGammaWeight * cellDirDiscomfort)) / (cellDirSpeedC * cellDirSpeedC);
+			} else {
+				// should this case be allowed to happen?
+				// (infinite costs very heavily influence
+				// behavior of potential-field generation)
+				//
+				// cost = std::numeric_limits<float>::infinity();
+				// cost = std::numeric_limits<float>::max();
+				cellDirSpeedC = EPSILON;
+				cellDirCost = ((mAlphaWeight * cellDirSpeedC) + mBetaWeight + (mGammaWeight * cellDirDiscomfort)) / (cellDirSpeedC * cellDirSpeedC);
+			}
+		}
+
+		buffer.speeds[cellIdx * NUM_DIRS + dir] = cellDirSpeedR;
+		buffer.costs[cellIdx * NUM_DIRS + dir] = cellDirCost;
+	}
+}
+
+
+
+// looks up the static field of the speed-class of every update
+// (the fields are created here rather than by the workers, which
+// must not modify the shared map)
+void CCGrid::SetStaticSpeedCostFields(std::vector<GroupUpdate>& updates) {
+	for (unsigned int n = 0; n < updates.size(); n++) {
+		#if (SPEED_COST_STATIC_FIELD_CACHE == 1)
+		updates[n].staticCosts = GetStaticSpeedCostField(*updates[n].objectIDs);
+		#else
+		updates[n].staticCosts = NULL;
+		#endif
+	}
+}
+
+// looks up the persistent arrays of every group to be solved,
+// so the workers never need to search the (shared) std::map's
+void CCGrid::SetGroupOutputArrays(std::vector<GroupUpdate>& updates) {
+	UpdateGroupVisCaptures();
+
+	for (unsigned int n = 0; n < updates.size(); n++) {
+		GroupUpdate& update = updates[n];
+
+		PFFG_ASSERT(mGroupEdgeVelocities.find(update.groupID) != mGroupEdgeVelocities.end());
+
+		update.potentials     = &mGroupPotentials.find(update.groupID)->second;
+		update.edgeVelocities = &mGroupEdgeVelocities.find(update.groupID)->second;
+		update.settledCells   = &mGroupSettledCells.find(update.groupID)->second;
+
+		std::map<unsigned int, GroupVisCapture>::iterator it = mGroupVisCaptures.find(update.groupID);
+
+		update.visCapture = (it != mGroupVisCaptures.end())? &(it->second): NULL;
+	}
+}
+
+// returns the static field of the speed-class of the group made up
+// of <objectIDs>, computing it first if the class is new; NULL when
+// empty cells do not have topological speed (rho_min < 0)
+const CCGrid::StaticSpeedCostField* CCGrid::GetStaticSpeedCostField(const std::set<unsigned int>& objectIDs) {
+	if (mRhoMin < 0.0f || objectIDs.empty()) {
+		return NULL;
+	}
+
+	// same limits as SetGroupWorkspace() derives
+	Workspace ws;
+	ws.minGroupSpeed  = 0.0f;
+	ws.maxGroupSpeed  = -std::numeric_limits<float>::max();
+	ws.maxGroupRadius = -std::numeric_limits<float>::max();
+
+	for (std::set<unsigned int>::const_iterator it = objectIDs.begin(); it != objectIDs.end(); ++it) {
+		const SimObjectDef* simObjectDef = mCOH->GetSimObjectDef(*it);
+
+		ws.maxGroupSpeed  = std::max<float>(ws.maxGroupSpeed,  simObjectDef->GetMaxForwardSpeed());
+		ws.maxGroupRadius = std::max<float>(ws.maxGroupRadius, simObjectDef->GetObjectRadius());
+	}
+
+	SpeedClass speedClass;
+	speedClass.minSpeed = ws.minGroupSpeed;
+	speedClass.maxSpeed = ws.maxGroupSpeed;
+	speedClass.sampleOffset = CELLS_IN_RADIUS(ws.maxGroupRadius) + 1;
+
+	std::map<SpeedClass, StaticSpeedCostField>::iterator fieldIt = mStaticSpeedCostFields.find(speedClass);
+
+	if (fieldIt != mStaticSpeedCostFields.end()) {
+		return &fieldIt->second;
+	}
+
+	// the field is computed by the regular code-path on a scratch
+	// buffer, with every sampled cell taken to be empty
+	const unsigned int numCells = numCellsX * numCellsZ;
+
+	ws.buffer.speeds.resize(numCells * NUM_DIRS, 0.0f);
+	ws.buffer.costs.resize(numCells * NUM_DIRS, 0.0f);
+
+	for (unsigned int cellIdx = 0; cellIdx < numCells; cellIdx++) {
+		ComputeCellSpeedAndCost(ws, cellIdx, ws.buffer, true);
+	}
+
+	StaticSpeedCostField& field = mStaticSpeedCostFields[speedClass];
+	field.speeds.swap(ws.buffer.speeds);
+	field.costs.swap(ws.buffer.costs);
+
+	return &field;
+}
+
+
+
+#if (SPEED_COST_POTENTIAL_MERGED_COMPUTATION == 1)
+	void CCGrid::ComputeCellSpeedAndCostMERGED(Workspace& ws, unsigned int cellIdx, Buffer& buffer) {
+		// recycled from (MERGED == 0 && SINGLE_PASS == 1)
+		ComputeCellSpeedAndCost(ws, cellIdx, buffer, false);
+	}
+#else
+	/*
+	void CCGrid::ComputeSpeedAndCost(Workspace& ws) {
+		Buffer& buffer = ws.buffer;
+
+		#if (SPEED_COST_SINGLE_PASS_COMPUTATION == 1)
+			for (unsigned int cellIdx = 0; cellIdx < (numCellsX * numCellsZ); cellIdx++) {
+				ComputeCellSpeedAndCost(ws, cellIdx, buffer, false);
+			}
+		#else
+			for (unsigned int cellIdx = 0; cellIdx < (numCellsX * numCellsZ); cellIdx++) { ComputeCellSpeed(ws, cellIdx, buffer); }
+			for (unsigned int cellIdx = 0; cellIdx < (numCellsX * numCellsZ); cellIdx++) { ComputeCellCost(ws, cellIdx, buffer); }
+		#endif
+	}
+	*/
+#endif
+
+
+
+
+
+
+// solves the fields of one GroupUpdate per item, on
+// the workspace belonging to the worker that runs it
+struct GroupSolveJob: public IWorkerJob {
+	GroupSolveJob(CCGrid* g, std::vector<CCGrid::GroupUpdate>* u): grid(g), updates(u) {}
+
+	void Execute(unsigned int itemIdx, unsigned int workerIdx) {
+		grid->UpdateGroupPotentialField(grid->mWorkspaces[workerIdx], (*updates)[itemIdx]);
+	}
+
+	CCGrid* grid;
+	std::vector<CCGrid::GroupUpdate>* updates;
+};
+
+unsigned int CCGrid::GetNumWorkers() const {
+	return ((mWorkerPool != NULL)? mWorkerPool->GetNumWorkers(): 0);
+}
+
+void CCGrid::UpdateGroupPotentialFields(std::vector<GroupUpdate>& updates) {
+	// NOTE:
+	//    every group is solved on a workspace that was left clean
+	//    by its previous solve and only reads the global cell data
+	//    (which is not written during this phase), so the fields do
+	//    not depend on the number of workers or on which worker gets
+	//    which group
+	SetStaticSpeedCostFields(updates);
+	SetGroupOutputArrays(updates);
+
+	GroupSolveJob job(this, &updates);
+	mWorkerPool->Run(&job, updates.size());
+
+	if (IsCheckingPotentialError()) {
+		mMaxPotentialError = 0.0f;
+
+		// NOTE:
+		//    the potential of a candidate is fixed when it is first
+		//    discovered, so the order in which cells are settled is
+		//    not only visible in the cells themselves but also in the
+		//    choice of upwind neighbor made by every cell downstream
+		//    of them; next to (very) high-cost cells this can cause
+		//    large local deviations, hence the mean is printed too
+		for (unsigned int n = 0; n < updates.size(); n++) {
+			mMaxPotentialError = std::max(mMaxPotentialError, updates[n].maxPotentialError);
+
+			printf(
+				"[CCGrid::UpdateGroupPotentialFields] group %u: max. potential error %f, mean %f\n",
+				updates[n].groupID, updates[n].maxPotentialError, updates[n].meanPotentialError
+			);
+		}
+	}
+}
+
+// solves the groups scheduled on one workspace per item (the
+// workspace is tied to the item rather than to the worker that
+// runs it, since it may hold a paused solve)
+struct StaggeredSolveJob: public IWorkerJob {
+	StaggeredSolveJob(CCGrid* g): grid(g) {}
+
+	void Execute(unsigned int itemIdx, unsigned int) {
+		grid->RunScheduledSolves(grid->mWorkspaces[itemIdx]);
+	}
+
+	CCGrid* grid;
+};
+
+// ordering of the groups that wait for a staggered solve: groups
+// without any field first, then by decreasing urgency (and by ID
+// so that the schedule does not depend on anything else)
+struct GroupUrgencyCmp {
+	bool operator() (const std::pair<float, unsigned int>& a, const std::pair<float, unsigned int>& b) const {
+		if (a.first != b.first) { return (a.first > b.first); }
+		return (a.second < b.second);
+	}
+};
+
+// UPDATE_MODE_STAGGERED: instead of solving every group on the same
+// frame, every worker settles about mUpdateBudget cells per frame and
+// FMM solves that do not fit are paused (in the workspace that started
+// them) and continued on the next frame; the budget counts work rather
+// than time, so which groups are solved on which frame (and therefore
+// the simulation) does not depend on the speed of the machine
+//
+// a group needs a new field once the global fields were rebuilt after
+// its previous solve started; such groups are started in order of the
+// number of frames since their last field was finished, weighted by
+// the crowd density around their members (fields become outdated the
+// fastest where the crowd is dense)
+//
+// NOTE:
+//    a solve that is paused when the global fields are rebuilt (see
+//    <gridChanged>) continues on the new data, so the part of its
+//    field settled before that uses the old densities; the group is
+//    then left stale and gets another solve
+//
+//    FSM and error-checked solves can not be paused, they are always
+//    run to completion once started
+void CCGrid::UpdateGroupPotentialFieldsStaggered(std::vector<GroupUpdate>& updates, bool gridChanged) {
+	std::vector< std::pair<float, unsigned int> > waitingGroups;
+	std::map<unsigned int, const GroupUpdate*> waitingUpdates;
+
+	waitingGroups.reserve(updates.size());
+
+	SetStaticSpeedCostFields(updates);
+	SetGroupOutputArrays(updates);
+
+	for (unsigned int n = 0; n < updates.size(); n++) {
+		const GroupUpdate& update = updates[n];
+
+		PFFG_ASSERT(mGroupSchedules.find(update.groupID) != mGroupSchedules.end());
+
+		GroupSchedule& schedule = mGroupSchedules[update.groupID];
+
+		schedule.age += 1;
+		schedule.stale = (schedule.stale || gridChanged);
+
+		if (!schedule.stale) {
+			continue;
+		}
+
+		bool paused = false;
+
+		for (unsigned int w = 0; w < mWorkspaces.size(); w++) {
+			paused = (paused || mWorkspaces[w].solveGroupID == update.groupID);
+		}
+
+		if (paused) {
+			continue;
+		}
+
+		float density = 0.0f;
+
+		for (std::set<unsigned int>::const_iterator it = update.objectIDs->begin(); it != update.objectIDs->end(); ++it) {
+			density += mDensities[ GetCellIndex1D(mCOH->GetSimObjectPosition(*it)) ];
+		}
+
+		density /= std::max(update.objectIDs->size(), size_t(1));
+		density /= std::max(mRhoMax, EPSILON);
+
+		const float urgency = schedule.solved?
+			(schedule.age * (1.0f + density)):
+			std::numeric_limits<float>::infinity();
+
+		waitingGroups.push_back(std::make_pair(urgency, update.groupID));
+		waitingUpdates[update.groupID] = &update;
+	}
+
+	std::sort(waitingGroups.begin(), waitingGroups.end(), GroupUrgencyCmp());
+
+	// deal the waiting groups out over the workspaces (round-robin,
+	// so every worker gets a share of the most urgent ones); those
+	// that do not fit in this frame's budget are dealt out again on
+	// the next
+	for (unsigned int w = 0; w < mWorkspaces.size(); w++) {
+		mWorkspaces[w].scheduledUpdates.clear();
+		mWorkspaces[w].finishedGroupIDs.clear();
+		mWorkspaces[w].numStartedUpdates = 0;
+	}
+
+	for (unsigned int n = 0; n < waitingGroups.size(); n++) {
+		Workspace& ws = mWorkspaces[n % mWorkspaces.size()];
+		ws.scheduledUpdates.push_back(*waitingUpdates[waitingGroups[n].second]);
+	}
+
+	StaggeredSolveJob job(this);
+	mWorkerPool->Run(&job, mWorkspaces.size());
+
+	for (unsigned int w = 0; w < mWorkspaces.size(); w++) {
+		const Workspace& ws = mWorkspaces[w];
+
+		for (unsigned int n = 0; n < ws.numStartedUpdates; n++) {
+			mGroupSchedules[ws.scheduledUpdates[n].groupID].stale = false;
+		}
+
+		for (unsigned int n = 0; n < ws.finishedGroupIDs.size(); n++) {
+			GroupSchedule& schedule = mGroupSchedules[ws.finishedGroupIDs[n]];
+
+			schedule.age = 0;
+			schedule.solved = true;
+		}
+	}
+}
+
+// continues the paused solve of <ws> (if any), then starts its
+// scheduled groups in order until the work budget has run out;
+// the budget is checked every STAGGERED_UPDATE_CHECK_INTERVAL
+// cells, and solves that can not be paused are charged a cell
+// per cell of their window
+void CCGrid::RunScheduledSolves(Workspace& ws) {
+	unsigned int numCells = 0;
+
+	while (true) {
+		if (ws.solveGroupID == NO_GROUP) {
+			if (ws.numStartedUpdates >= ws.scheduledUpdates.size()) {
+				break;
+			}
+
+			GroupUpdate& update = ws.scheduledUpdates[ws.numStartedUpdates++];
+
+			if (mSolver == SOLVER_FSM || IsCheckingPotentialError()) {
+				UpdateGroupPotentialField(ws, update);
+				ws.finishedGroupIDs.push_back(update.groupID);
+
+				numCells += ws.window.GetNumCells();
+			} else {
+				SetGroupWorkspace(ws, update);
+				BeginGroupPotentialField(ws, *update.goalIDs, mFMMQueueMode);
+				ws.solveGroupID = update.groupID;
+			}
+		}
+
+		if (ws.solveGroupID != NO_GROUP) {
+			const unsigned int numSettledCells = ws.numSettledCells;
+
+			if (ContinueGroupPotentialField(ws, STAGGERED_UPDATE_CHECK_INTERVAL)) {
+				StoreGroupFields(ws);
+				ws.finishedGroupIDs.push_back(ws.solveGroupID);
+				ws.solveGroupID = NO_GROUP;
+			}
+
+			numCells += (ws.numSettledCells - numSettledCells);
+		}
+
+		if (numCells >= mUpdateBudget) {
+			break;
+		}
+	}
+}
+
+void CCGrid::SetGroupWorkspace(Workspace& ws, const GroupUpdate& update) {
+	const std::set<unsigned int>& objectIDs = *update.objectIDs;
+
+	{
+		ws.minGroupSlope  =  std::numeric_limits<float>::max();
+		ws.maxGroupSlope  = -std::numeric_limits<float>::max();
+		ws.minGroupSpeed  =                               0.0f;
+		ws.maxGroupSpeed  = -std::numeric_limits<float>::max();
+		ws.maxGroupRadius = -std::numeric_limits<float>::max();
+
+		for (std::set<unsigned int>::const_iterator i = objectIDs.begin(); i != objectIDs.end(); i++) {
+			const SimObjectDef* simObjectDef = mCOH->GetSimObjectDef(*i);
+
+			ws.minGroupSlope  = std::min<float>(ws.minGroupSlope,  simObjectDef->GetMinSlopeAngleCosine());
+			ws.maxGroupSlope  = std::max<float>(ws.maxGroupSlope,  simObjectDef->GetMaxSlopeAngleCosine());
+			ws.maxGroupSpeed  = std::max<float>(ws.maxGroupSpeed,  simObjectDef->GetMaxForwardSpeed());
+			ws.maxGroupRadius = std::max<float>(ws.maxGroupRadius, simObjectDef->GetObjectRadius());
+		}
+	}
+
+	ws.staticCosts = update.staticCosts;
+	ws.potentials = update.potentials;
+	ws.edgeVelocities = update.edgeVelocities;
+	ws.groupSettledCells = update.settledCells;
+	ws.visCapture = update.visCapture;
+
+	ws.window    = (update.window != NULL)? *update.window: GetFullWindow();
+	ws.seeds     = update.seeds;
+	ws.objectIDs = update.objectIDs;
+}
+
+void CCGrid::UpdateGroupPotentialField(Workspace& ws, GroupUpdate& update) {
+	const std::set<unsigned int>& goalIDs = *update.goalIDs;
+
+	PFFG_ASSERT(!goalIDs.empty() || (update.seeds != NULL && !update.seeds->empty()));
+
+	SetGroupWorkspace(ws, update);
+
+	if (update.window != NULL) {
+		// windowed solves are always done with the exact FMM
+		SolveGroupPotentialField(ws, goalIDs, FMM_QUEUE_HEAP);
+		StoreGroupFields(ws);
+		return;
+	}
+
+	if (!IsCheckingPotentialError()) {
+		if (mSolver == SOLVER_FSM) {
+			SolveGroupPotentialFieldFSM(ws, goalIDs);
+		} else {
+			SolveGroupPotentialField(ws, goalIDs, mFMMQueueMode);
+		}
+
+		StoreGroupFields(ws);
+		return;
+	}
+
+	// solve the field twice, first with the exact heap and then
+	// with the untidy queue or the FSM (whose result is the one
+	// kept), and compare the potentials cell by cell
+	SolveGroupPotentialField(ws, goalIDs, FMM_QUEUE_HEAP);
+
+	{
+		for (unsigned int idx = 0; idx < (numCellsX * numCellsZ); idx++) {
+			ws.exactPotentials[idx] = ws.buffer.GetPotential(idx);
+		}
+	}
+
+	if (mSolver == SOLVER_FSM) {
+		SolveGroupPotentialFieldFSM(ws, goalIDs);
+	} else {
+		SolveGroupPotentialField(ws, goalIDs, FMM_QUEUE_UNTIDY);
+	}
+
+	{
+		float sumPotentialError = 0.0f;
+		unsigned int numSolvedCells = 0;
+
+		update.maxPotentialError = 0.0f;
+
+		for (unsigned int idx = 0; idx < (numCellsX * numCellsZ); idx++) {
+			const float p0 = ws.exactPotentials[idx];
+			const float p1 = ws.buffer.GetPotential(idx);
+
+			if (p0 == std::numeric_limits<float>::infinity()) { continue; }
+			if (p1 == std::numeric_limits<float>::infinity()) { continue; }
+
+			update.maxPotentialError = std::max(update.maxPotentialError, std::fabs(p1 - p0));
+			sumPotentialError += std::fabs(p1 - p0);
+			numSolvedCells += 1;
+		}
+
+		update.meanPotentialError = sumPotentialError / std::max(numSolvedCells, 1U);
+	}
+
+	StoreGroupFields(ws);
+}
+
+void CCGrid::SolveGroupPotentialField(Workspace& ws, const std::set<unsigned int>& goalIDs, unsigned int queueMode) {
+	BeginGroupPotentialField(ws, goalIDs, queueMode);
+	ContinueGroupPotentialField(ws, std::numeric_limits<unsigned int>::max());
+}
+
+// adds the goal-cells of a new solve to the known set and
+// their neighbors to the candidate set; the remaining cells
+// are settled by ContinueGroupPotentialField
+void CCGrid::BeginGroupPotentialField(Workspace& ws, const std::set<unsigned int>& goalIDs, unsigned int queueMode) {
+	PFFG_ASSERT(!HaveCandidates(ws));
+
+	// start a new epoch so the per-group variables of the
+	// previously processed group do not influence this one
+	ws.buffer.NextEpoch();
+	ws.queueMode = queueMode;
+
+	#if (FMM_TRACE_TOUCHED_BYTES == 1)
+	ws.tracedLines.clear();
+	#endif
+
+	// windowed solves have to cover their whole window
+	ws.earlyExit = (mFMMEarlyExit && ws.window == GetFullWindow());
+	ws.numTargetCells = 0;
+	ws.numSettledCells = 0;
+	ws.settledCells.clear();
+
+	// the bounds must be known before the first candidate is pushed
+	ws.heuristic = (mFMMHeuristic && ws.earlyExit);
+
+	if (ws.heuristic) {
+		SetHeuristicBounds(ws);
+	}
+
+	if (ws.queueMode == FMM_QUEUE_UNTIDY) {
+		// by default the buckets are as wide as the cheapest
+		// possible edge cost (at twice the group's max. speed,
+		// which bounds the topological speed on down-slopes)
+		const float maxSpeed = std::max(ws.maxGroupSpeed * 2.0f, EPSILON);
+		const float minCost = ((mAlphaWeight * maxSpeed) + mBetaWeight) / (maxSpeed * maxSpeed);
+
+		if (mFMMBucketWidth > 0.0f) {
+			ws.bucketCandidates.SetBucketWidth(mFMMBucketWidth);
+		} else {
+			ws.bucketCandidates.SetBucketWidth(std::max(minCost, EPSILON));
+		}
+	}
+
+	#if (SPEED_COST_POTENTIAL_MERGED_COMPUTATION == 0)
+	ComputeSpeedAndCost(ws);
+	#endif
+
+	ws.numInfinitePotentialCases = 0;
+	ws.numIllegalDirectionCases = 0;
+
+	// seed-cells are known from the start like goal-cells, but
+	// their neighbors only become candidates after every seed has
+	// its potential (otherwise the first neighbors would see only
+	// part of the seeds)
+	if (ws.seeds != NULL) {
+		for (unsigned int n = 0; n < ws.seeds->size(); n++) {
+			PFFG_ASSERT(goalIDs.find((*ws.seeds)[n].first) == goalIDs.end());
+			AddSourceCell(ws, (*ws.seeds)[n].first, (*ws.seeds)[n].second);
+		}
+	}
+
+	// add goal-cells to the known set and their neighbors to the candidate-set
+	for (std::set<unsigned int>::const_iterator it = goalIDs.begin(); it != goalIDs.end(); ++it) {
+		#if (SPEED_COST_POTENTIAL_MERGED_COMPUTATION == 1)
+		// <*it> is a goal-cell, so this is not necessary?
+		// ComputeCellSpeedAndCostMERGED(ws, *it, ws.buffer);
 		#endif
+		AddSourceCell(ws, *it, 0.0f);
+		UpdateCandidates(ws, *it);
+	}
 
-		float cellDirSpeedR = 0.0f; // f_{M --> dir} for computing f, based on offset density (R=RHO)
-		float cellDirSpeedC = 0.0f; // f_{M --> dir} for computing C, based on direct neighbor density (C=COST)
-		float cellDirCost   = 0.0f; // C_{M --> dir}
+	if (ws.seeds != NULL) {
+		for (unsigned int n = 0; n < ws.seeds->size(); n++) {
+			UpdateCandidates(ws, (*ws.seeds)[n].first);
+		}
+	}
 
-		{
-			// if the slope is positive along <dir>, we want a positive slopeSpeedScale
-			// if the slope is negative along <dir>, we want a negative slopeSpeedScale
-			//
-			// since (s_max - s_min) is always positive and (f_min - f_max) is always
-			// negative, the numerator (s - s_min) must be greater than 0 to achieve a
-			// speed-decrease on positive slopes and smaller than 0 to achieve a speed-
-			// increase on negative slopes
-			if (POSITIVE_SLOPE(dir, cellDirSlope)) { cellDirSlopeMod =  std::fabs(cellDirSlope); }
-			if (NEGATIVE_SLOPE(dir, cellDirSlope)) { cellDirSlopeMod = -std::fabs(cellDirSlope); }
+	if (ws.earlyExit) {
+		MarkTargetCells(ws);
+	}
+}
 
-			const float densityDirSpeedScaleR = (currCellDirNgbR->density - mRhoMin) / (mRhoMax - mRhoMin);
-			const float densityDirSpeedScaleC = (currCellDirNgbC->density - mRhoMin) / (mRhoMax - mRhoMin);
+// marks the cells that an early-terminated solve has to settle: those
+// within mFMMEarlyExitMargin cells of any member of the group (source
+// cells are known already, so they are not counted)
+void CCGrid::MarkTargetCells(Workspace& ws) {
+	Buffer& buffer = ws.buffer;
 
-			const float slopeDirSpeedScale   = mFlatTerrain? 0.0f: ((cellDirSlopeMod - mMinTerrainSlope) / (mMaxTerrainSlope - mMinTerrainSlope));
-			const float cellDirTopoSpeed     = mMaxGroupSpeed + CLAMP(slopeDirSpeedScale, -1.0f, 1.0f) * (mMinGroupSpeed - mMaxGroupSpeed);
+	const int margin = mFMMEarlyExitMargin;
 
-			const float cellDirFlowSpeedR = std::max(0.0f, currCellDirNgbR->avgVelocity.dot2D(mDirVectors[dir]));
-			const float cellDirFlowSpeedC = std::max(0.0f, currCellDirNgbC->avgVelocity.dot2D(mDirVectors[dir]));
+	for (std::set<unsigned int>::const_iterator it = ws.objectIDs->begin(); it != ws.objectIDs->end(); ++it) {
+		const vec3i& objectCell = GetCellIndex2D(mCOH->GetSimObjectPosition(*it));
 
-			const float cellDirTopoFlowSpeedR = cellDirTopoSpeed + densityDirSpeedScaleR * (cellDirTopoSpeed - cellDirFlowSpeedR);
-			const float cellDirTopoFlowSpeedC = cellDirTopoSpeed + densityDirSpeedScaleC * (cellDirTopoSpeed - cellDirFlowSpeedC);
+		const unsigned int x0 = std::max(objectCell.x - margin, int(ws.window.x0));
+		const unsigned int x1 = std::min(objectCell.x + margin, int(ws.window.x1));
+		const unsigned int z0 = std::max(objectCell.z - margin, int(ws.window.z0));
+		const unsigned int z1 = std::min(objectCell.z + margin, int(ws.window.z1));
 
-			// default to linear interpolation of topological and flow speed
-			cellDirSpeedR = cellDirTopoFlowSpeedR;
-			cellDirSpeedC = cellDirTopoFlowSpeedC;
+		for (unsigned int z = z0; z <= z1; z++) {
+			for (unsigned int x = x0; x <= x1; x++) {
+				const unsigned int cellIdx = GRID_INDEX_UNSAFE(x, z);
 
-			if (currCellDirNgbR->density >= mRhoMax) { cellDirSpeedR = cellDirFlowSpeedR; }
-			if (currCellDirNgbR->density <= mRhoMin) { cellDirSpeedR = cellDirTopoSpeed;  }
+				buffer.TouchCell(cellIdx);
 
-			if (currCellDirNgbC->density >= mRhoMax) { cellDirSpeedC = cellDirFlowSpeedC; }
-			if (currCellDirNgbC->density <= mRhoMin) { cellDirSpeedC = cellDirTopoSpeed;  }
+				if ((buffer.states[cellIdx] & (CELL_KNOWN | CELL_TARGET)) != 0) {
+					continue;
+				}
 
-			if (cellDirSpeedC > EPSILON) {
-				cellDirCost = ((mAlphaWeight * cellDirSpeedC) + mBetaWeight + (mGammaWeight * cellDirDiscomfort)) / (cellDirSpeedC * cellDirSpeedC);
-			} else {
-				// should this case be allowed to happen?
-				// (infinite costs very heavily influence
-				// behavior of potential-field generation)
-				//
-				// cost = std::numeric_limits<float>::infinity();
-				// cost = std::numeric_limits<float>::max();
-				cellDirSpeedC = EPSILON;
-				cellDirCost = ((mAlphaWeight * cellDirSpeedC) + mBetaWeight + (mGammaWeight * cellDirDiscomfort)) / (cellDirSpeedC * cellDirSpeedC);
+				buffer.states[cellIdx] |= CELL_TARGET;
+				ws.numTargetCells += 1;
 			}
 		}
-
-		currCell->speed[dir] = cellDirSpeedR;
-		currCell->cost[dir] = cellDirCost;
-
-		mSpeedVisData[groupID][cellIdx * NUM_DIRS + dir] = cellDirSpeedR;
-		mCostVisData[groupID][cellIdx * NUM_DIRS + dir] = cellDirCost;
 	}
 }
 
+// derives the per-solve terms of GetHeuristicBound() from the
+// group's speeds and radius and from its members' current cells
+void CCGrid::SetHeuristicBounds(Workspace& ws) {
+	const unsigned int numCells = numCellsX * numCellsZ;
 
+	// cheapest possible step as for the bucket-width, ie. at twice
+	// the group's max. speed; the discomfort term only counts if the
+	// landmark tables cover the cells this group's costs sample
+	const float maxSpeed = std::max(ws.maxGroupSpeed * 2.0f, EPSILON);
 
-#if (SPEED_COST_POTENTIAL_MERGED_COMPUTATION == 1)
-	void CCGrid::ComputeCellSpeedAndCostMERGED(unsigned int groupID, Cell* currCell, std::vector<Cell>& currCells, std::vector<Cell::Edge>& currEdges) {
-		// recycled from (MERGED == 0 && SINGLE_PASS == 1)
-		ComputeCellSpeedAndCost(groupID, GRID_INDEX_UNSAFE(currCell->x, currCell->y), currCells, currEdges);
+	#if (SPEED_COST_SHARED_NEIGHBOR_CELL == 1)
+	const unsigned int discomfortOffset = (unsigned int) CELLS_IN_RADIUS(ws.maxGroupRadius) + 1;
+	#else
+	const unsigned int discomfortOffset = 1;
+	#endif
+
+	ws.heuristicHopCost = std::max(((mAlphaWeight * maxSpeed) + mBetaWeight) / (maxSpeed * maxSpeed), 0.0f);
+	ws.heuristicDiscomfortCost = 0.0f;
+
+	if (discomfortOffset <= LANDMARK_MAX_DISCOMFORT_OFFSET) {
+		ws.heuristicDiscomfortCost = std::max(mGammaWeight / (maxSpeed * maxSpeed), 0.0f);
 	}
-#else
-	/*
-	void CCGrid::ComputeSpeedAndCost(unsigned int groupID) {
-		std::vector<Cell      >& currCells = mGridStates[mCurrBufferIdx].cells;
-		std::vector<Cell::Edge>& currEdges = mGridStates[mCurrBufferIdx].edges;
 
-		#if (SPEED_COST_SINGLE_PASS_COMPUTATION == 1)
-			for (unsigned int cellIdx = 0; cellIdx < (numCellsX * numCellsZ); cellIdx++) {
-				ComputeCellSpeedAndCost(groupID, cellIdx, currCells, currEdges);
-			}
-		#else
-			for (unsigned int cellIdx = 0; cellIdx < (numCellsX * numCellsZ); cellIdx++) { ComputeCellSpeed(groupID, cellIdx, currCells, currEdges); }
-			for (unsigned int cellIdx = 0; cellIdx < (numCellsX * numCellsZ); cellIdx++) { ComputeCellCost(groupID, cellIdx, currCells, currEdges); }
-		#endif
+	ws.memberWindow = Window(numCellsX - 1, numCellsZ - 1, 0, 0);
+
+	for (unsigned int n = 0; n < mNumLandmarks; n++) {
+		ws.landmarkBounds[n * 2 + 0] =  std::numeric_limits<float>::infinity();
+		ws.landmarkBounds[n * 2 + 1] = -std::numeric_limits<float>::infinity();
 	}
-	*/
-#endif
 
+	for (std::set<unsigned int>::const_iterator it = ws.objectIDs->begin(); it != ws.objectIDs->end(); ++it) {
+		const vec3i& objectCell = GetCellIndex2D(mCOH->GetSimObjectPosition(*it));
 
+		const unsigned int cellX = CLAMP(objectCell.x, 0, int(numCellsX - 1));
+		const unsigned int cellZ = CLAMP(objectCell.z, 0, int(numCellsZ - 1));
+		const unsigned int cellIdx = GRID_INDEX_UNSAFE(cellX, cellZ);
 
+		ws.memberWindow.x0 = std::min(ws.memberWindow.x0, cellX);
+		ws.memberWindow.x1 = std::max(ws.memberWindow.x1, cellX);
+		ws.memberWindow.z0 = std::min(ws.memberWindow.z0, cellZ);
+		ws.memberWindow.z1 = std::max(ws.memberWindow.z1, cellZ);
 
+		for (unsigned int n = 0; n < mNumLandmarks; n++) {
+			const float distance = mLandmarkDistances[n * numCells + cellIdx];
 
+			ws.landmarkBounds[n * 2 + 0] = std::min(ws.landmarkBounds[n * 2 + 0], distance);
+			ws.landmarkBounds[n * 2 + 1] = std::max(ws.landmarkBounds[n * 2 + 1], distance);
+		}
+	}
+}
 
-void CCGrid::UpdateGroupPotentialField(unsigned int groupID, const std::set<unsigned int>& goalIDs, const std::set<unsigned int>& objectIDs) {
-	PFFG_ASSERT(!goalIDs.empty());
-	PFFG_ASSERT(mCandidates.empty());
+// lower bound on the potential the solve in <ws> still has to add
+// between <cellIdx> and the nearest member of its group: the distance
+// (in cells) to the members' bounding box times the cheapest step plus
+// the ALT bound (Goldberg & Harrelson, 2005) on the static discomfort
+// summed along the way; the latter is a bound on 4-connected paths,
+// so it is scaled by 1/sqrt(2) to cover diagonal eikonal fronts
+float CCGrid::GetHeuristicBound(const Workspace& ws, unsigned int cellIdx) const {
+	const unsigned int numCells = numCellsX * numCellsZ;
+	const unsigned int cellX = cellIdx % numCellsX;
+	const unsigned int cellZ = cellIdx / numCellsX;
 
-	// cycle the buffers so the per-group variables of the
-	// previously processed group do not influence this one
-	//
-	// NOTE: this must be done here rather than at the end
-	// of the update so that each sim-object location update
-	// still reads from the correct buffer
-	mCurrBufferIdx = (mCurrBufferIdx + 1) & 1;
-	mPrevBufferIdx = (mPrevBufferIdx + 1) & 1;
+	const Window& mw = ws.memberWindow;
 
-	{
-		mMinGroupSlope  =  std::numeric_limits<float>::max();
-		mMaxGroupSlope  = -std::numeric_limits<float>::max();
-		mMinGroupSpeed  =                               0.0f;
-		mMaxGroupSpeed  = -std::numeric_limits<float>::max();
-		mMaxGroupRadius = -std::numeric_limits<float>::max();
+	const unsigned int hopsX = (cellX < mw.x0)? (mw.x0 - cellX): ((cellX > mw.x1)? (cellX - mw.x1): 0);
+	const unsigned int hopsZ = (cellZ < mw.z0)? (mw.z0 - cellZ): ((cellZ > mw.z1)? (cellZ - mw.z1): 0);
 
-		for (std::set<unsigned int>::iterator i = objectIDs.begin(); i != objectIDs.end(); i++) {
-			const SimObjectDef* simObjectDef = mCOH->GetSimObjectDef(*i);
+	float discomfort = 0.0f;
 
-			mMinGroupSlope  = std::min<float>(mMinGroupSlope,  simObjectDef->GetMinSlopeAngleCosine());
-			mMaxGroupSlope  = std::max<float>(mMaxGroupSlope,  simObjectDef->GetMaxSlopeAngleCosine());
-			mMaxGroupSpeed  = std::max<float>(mMaxGroupSpeed,  simObjectDef->GetMaxForwardSpeed());
-			mMaxGroupRadius = std::max<float>(mMaxGroupRadius, simObjectDef->GetObjectRadius());
+	if (ws.heuristicDiscomfortCost > 0.0f) {
+		for (unsigned int n = 0; n < mNumLandmarks; n++) {
+			const float distance = mLandmarkDistances[n * numCells + cellIdx];
+
+			discomfort = std::max(discomfort, ws.landmarkBounds[n * 2 + 0] - distance);
+			discomfort = std::max(discomfort, distance - ws.landmarkBounds[n * 2 + 1]);
 		}
 	}
 
-	#if (SPEED_COST_POTENTIAL_MERGED_COMPUTATION == 0)
-	ComputeSpeedAndCost(groupID);
-	#endif
+	const float hops = std::sqrt(float(hopsX * hopsX + hopsZ * hopsZ));
+
+	return ((hops * ws.heuristicHopCost) + (discomfort * ws.heuristicDiscomfortCost * M_SQRT1_2));
+}
+
+// makes <cellIdx> a known cell with potential <potential> from
+// which the solve starts (a goal- or seed-cell); sources do not
+// have a velocity
+void CCGrid::AddSourceCell(Workspace& ws, unsigned int cellIdx, float potential) {
+	Buffer& buffer = ws.buffer;
 
-	Buffer& currGridBuffer = mGridStates[mCurrBufferIdx];
-	Buffer& prevGridBuffer = mGridStates[mPrevBufferIdx];
-	Buffer& groupGridState = mGroupGridStates[groupID];
+	std::vector<EdgeVelocity>& edgeVelocities = *ws.edgeVelocities;
 
-	std::vector<float>& potVisData      = mPotentialVisData[groupID];
-	std::vector<vec3f>& velVisData      = mVelocityVisData[groupID];
-	std::vector<vec3f>& potDeltaVisData = mPotentialDeltaVisData[groupID];
+	unsigned int cellEdges[NUM_DIRS] = {0};
 
-	std::vector<Cell      >& currCells = currGridBuffer.cells;
-	std::vector<Cell      >& prevCells = prevGridBuffer.cells;
-	std::vector<Cell::Edge>& currEdges = currGridBuffer.edges;
-	std::vector<Cell::Edge>& prevEdges = prevGridBuffer.edges;
+	PFFG_ASSERT(ws.window.Contains(cellIdx % numCellsX, cellIdx / numCellsX));
+
+	buffer.TouchCell(cellIdx);
+	buffer.states[cellIdx] = CELL_KNOWN | CELL_CANDIDATE | CELL_SOURCE;
+	buffer.potentials[cellIdx] = potential;
+
+	if (mLazyVelocities) {
+		return;
+	}
+
+	GetCellEdgeIndices(cellIdx, cellEdges);
+
+	for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+		edgeVelocities[ cellEdges[dir] ].Set(NVECf);
+	}
+}
 
-	Cell* currCell = NULL;
-	Cell* prevCell = NULL;
+// settles at most <maxCells> more cells of the solve that was begun
+// in <ws>; returns true once the field is complete (the state of an
+// unfinished solve lives entirely in the workspace, so it can be
+// continued on a later frame)
+bool CCGrid::ContinueGroupPotentialField(Workspace& ws, unsigned int maxCells) {
+	Buffer& buffer = ws.buffer;
 
-	numInfinitePotentialCases = 0;
-	numIllegalDirectionCases = 0;
+	std::vector<EdgeVelocity>& edgeVelocities = *ws.edgeVelocities;
 
 	unsigned int cellIdx = 0;
+	unsigned int cellEdges[NUM_DIRS] = {0};
+
+	for (unsigned int numCells = 0; HaveCandidates(ws) && numCells < maxCells; numCells++) {
+		if (ws.earlyExit && ws.numTargetCells == 0) {
+			// every target is settled; the remaining candidates
+			// become unreachable again (as does everything behind
+			// them, which was never visited)
+			while (HaveCandidates(ws)) {
+				buffer.ResetCell(TopCandidate(ws));
+				PopCandidate(ws);
+			}
 
-	// add goal-cells to the known set and their neighbors to the candidate-set
-	for (std::set<unsigned int>::const_iterator it = goalIDs.begin(); it != goalIDs.end(); ++it) {
-		cellIdx = *it;
+			break;
+		}
 
-		currCell = &currCells[cellIdx];
-		prevCell = &prevCells[cellIdx];
+		cellIdx = TopCandidate(ws);
 
-		currCell->known = true;
-		currCell->candidate = true;
-		currCell->potential = 0.0f;
-		prevCell->ResetGroupVars();
+		buffer.states[cellIdx] |= CELL_KNOWN;
 
-		#if (SPEED_COST_POTENTIAL_MERGED_COMPUTATION == 1)
-		// <currCell> is a goal-cell, so this is not necessary?
-		// ComputeCellSpeedAndCostMERGED(groupID, currCell, currCells, currEdges);
-		#endif
-		UpdateCandidates(groupID, currCell);
+		FMM_TRACE_TOUCH(ws, buffer.states[cellIdx]);
 
-		potVisData[cellIdx] = (currCell->potential == std::numeric_limits<float>::infinity())? -1.0f: currCell->potential;
-		velVisData[cellIdx * NUM_DIRS + DIR_N] = NVECf;
-		velVisData[cellIdx * NUM_DIRS + DIR_S] = NVECf;
-		velVisData[cellIdx * NUM_DIRS + DIR_E] = NVECf;
-		velVisData[cellIdx * NUM_DIRS + DIR_W] = NVECf;
-		potDeltaVisData[cellIdx * NUM_DIRS + DIR_N] = NVECf;
-		potDeltaVisData[cellIdx * NUM_DIRS + DIR_S] = NVECf;
-		potDeltaVisData[cellIdx * NUM_DIRS + DIR_E] = NVECf;
-		potDeltaVisData[cellIdx * NUM_DIRS + DIR_W] = NVECf;
-	}
+		if (ws.earlyExit) {
+			ws.settledCells.push_back(cellIdx);
+			ws.numTargetCells -= ((buffer.states[cellIdx] & CELL_TARGET) != 0);
 
-	while (!mCandidates.empty()) {
-		currCell = mCandidates.top();
-		currCell->known = true;
+			FMM_TRACE_TOUCH(ws, ws.settledCells.back());
+		}
+
+		UpdateCandidates(ws, cellIdx);
 
-		cellIdx = GRID_INDEX_UNSAFE(currCell->x, currCell->y);
+		if (mLazyVelocities) {
+			ws.settleOrders[cellIdx] = ws.numSettledCells++;
 
-		prevCell = &prevCells[cellIdx];
-		prevCell->ResetGroupVars();
+			FMM_TRACE_TOUCH(ws, ws.settleOrders[cellIdx]);
 
-		UpdateCandidates(groupID, currCell);
+			PopCandidate(ws);
+			continue;
+		}
 
-		currEdges[ currCell->edges[DIR_N] ].velocity = (currCell->GetNormalisedPotentialGradient(currEdges, DIR_N) * -currCell->speed[DIR_N]);
-		currEdges[ currCell->edges[DIR_S] ].velocity = (currCell->GetNormalisedPotentialGradient(currEdges, DIR_S) * -currCell->speed[DIR_S]);
-		currEdges[ currCell->edges[DIR_E] ].velocity = (currCell->GetNormalisedPotentialGradient(currEdges, DIR_E) * -currCell->speed[DIR_E]);
-		currEdges[ currCell->edges[DIR_W] ].velocity = (currCell->GetNormalisedPotentialGradient(currEdges, DIR_W) * -currCell->speed[DIR_W]);
-		prevEdges[ currCell->edges[DIR_N] ].velocity = NVECf;
-		prevEdges[ currCell->edges[DIR_S] ].velocity = NVECf;
-		prevEdges[ currCell->edges[DIR_E] ].velocity = NVECf;
-		prevEdges[ currCell->edges[DIR_W] ].velocity = NVECf;
+		GetCellEdgeIndices(cellIdx, cellEdges);
 
-		if (mUpdateInt > 1) {
-			// the grid-state gets recycled for the next group,
-			// so when mUpdateInt is not 1 we need to keep the
-			// values cached during the non-update frames
-			groupGridState.cells[cellIdx] = *currCell;
-			groupGridState.edges[ currCell->edges[DIR_N] ] = currEdges[ currCell->edges[DIR_N]];
-			groupGridState.edges[ currCell->edges[DIR_S] ] = currEdges[ currCell->edges[DIR_S]];
-			groupGridState.edges[ currCell->edges[DIR_E] ] = currEdges[ currCell->edges[DIR_E]];
-			groupGridState.edges[ currCell->edges[DIR_W] ] = currEdges[ currCell->edges[DIR_W]];
+		for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+			const unsigned int edgeIdx = cellEdges[dir];
+
+			// velocities outlive the workspace, so they go straight
+			// into the group's own field (read by the advection); the
+			// edges UpdateCandidates did not write in this solve read
+			// as zero deltas
+			edgeVelocities[edgeIdx].Set(GetNormalisedPotentialGradient(buffer, edgeIdx) * -buffer.speeds[cellIdx * NUM_DIRS + dir]);
+
+			FMM_TRACE_TOUCH(ws, edgeVelocities[edgeIdx]);
+			FMM_TRACE_TOUCH(ws, buffer.edgeEpochs[edgeIdx]);
+			FMM_TRACE_TOUCH(ws, buffer.potentialDeltas[edgeIdx]);
+			FMM_TRACE_TOUCH(ws, buffer.speeds[cellIdx * NUM_DIRS + dir]);
 		}
 
-		potVisData[cellIdx] = (currCell->potential == std::numeric_limits<float>::infinity())? -1.0f: currCell->potential;
-		velVisData[cellIdx * NUM_DIRS + DIR_N] = currEdges[ currCell->edges[DIR_N] ].velocity * (mSquareSize >> 1);
-		velVisData[cellIdx * NUM_DIRS + DIR_S] = currEdges[ currCell->edges[DIR_S] ].velocity * (mSquareSize >> 1);
-		velVisData[cellIdx * NUM_DIRS + DIR_E] = currEdges[ currCell->edges[DIR_E] ].velocity * (mSquareSize >> 1);
-		velVisData[cellIdx * NUM_DIRS + DIR_W] = currEdges[ currCell->edges[DIR_W] ].velocity * (mSquareSize >> 1);
-		potDeltaVisData[cellIdx * NUM_DIRS + DIR_N] = currEdges[ currCell->edges[DIR_N] ].potentialDelta * (mSquareSize >> 1);
-		potDeltaVisData[cellIdx * NUM_DIRS + DIR_S] = currEdges[ currCell->edges[DIR_S] ].potentialDelta * (mSquareSize >> 1);
-		potDeltaVisData[cellIdx * NUM_DIRS + DIR_E] = currEdges[ currCell->edges[DIR_E] ].potentialDelta * (mSquareSize >> 1);
-		potDeltaVisData[cellIdx * NUM_DIRS + DIR_W] = currEdges[ currCell->edges[DIR_W] ].potentialDelta * (mSquareSize >> 1);
+		ws.numSettledCells += 1;
 
-		mCandidates.pop();
+		PopCandidate(ws);
 	}
 
-	PFFG_ASSERT(numInfinitePotentialCases == 0 && numIllegalDirectionCases == 0);
-}
-
-void CCGrid::UpdateCandidates(unsigned int groupID, const Cell* parent) {
-	Buffer& currGridBuffer = mGridStates[mCurrBufferIdx];
-	Buffer& prevGridBuffer = mGridStates[mPrevBufferIdx];
+	if (HaveCandidates(ws)) {
+		return false;
+	}
 
-	std::vector<Cell      >& currCells = currGridBuffer.cells;
-	std::vector<Cell      >& prevCells = prevGridBuffer.cells;
-	std::vector<Cell::Edge>& currEdges = currGridBuffer.edges;
-	std::vector<Cell::Edge>& prevEdges = prevGridBuffer.edges;
+	#if (FMM_TRACE_TOUCHED_BYTES == 1)
+	printf(
+		"[CCGrid::ContinueGroupPotentialField] %u cells settled, %u bytes touched per settled cell\n",
+		ws.numSettledCells, (unsigned int) ((ws.tracedLines.size() << 6) / std::max(ws.numSettledCells, 1U))
+	);
+	#endif
 
-	static float       dirCosts[NUM_DIRS] = {0.0f};
-	static bool        dirValid[NUM_DIRS] = {false};
-	static const Cell* dirCells[NUM_DIRS] = {NULL};
+	PFFG_ASSERT(ws.numInfinitePotentialCases == 0 && ws.numIllegalDirectionCases == 0);
+	return true;
+}
 
-	const Cell* minPotCellPtrX = NULL;
-	const Cell* minPotCellPtrY = NULL;
-	int         minPotCellDirX = -1;
-	int         minPotCellDirY = -1;
+// drops the paused solve of <ws> (eg. because its group was deleted);
+// the cells it visited become stale when the next solve begins
+void CCGrid::AbortGroupPotentialField(Workspace& ws) {
+	ws.candidates.clear();
+	ws.bucketCandidates.clear();
 
-	Cell::Edge* currEdgeX = NULL;
-	Cell::Edge* currEdgeY = NULL;
-	Cell::Edge* prevEdgeX = NULL;
-	Cell::Edge* prevEdgeY = NULL;
+	ws.solveGroupID = NO_GROUP;
+	ws.edgeVelocities = NULL;
+	ws.visCapture = NULL;
+}
 
-	for (unsigned int i = 0; i < parent->numNeighbors; i++) {
-		const unsigned int ngbIdx = parent->neighbors[i];
+void CCGrid::UpdateCandidates(Workspace& ws, unsigned int parentIdx) {
+	Buffer& buffer = ws.buffer;
+
+	const unsigned int parentX = parentIdx % numCellsX;
+	const unsigned int parentY = parentIdx / numCellsX;
+
+	// the neighbors of <parentIdx> inside the window
+	// of the current solve, in N-S-W-E order
+	unsigned int ngbCells[NUM_DIRS] = {0};
+	unsigned int numNgbCells = 0;
+
+	if (parentY > ws.window.z0) { ngbCells[numNgbCells++] = parentIdx - numCellsX; }
+	if (parentY < ws.window.z1) { ngbCells[numNgbCells++] = parentIdx + numCellsX; }
+	if (parentX > ws.window.x0) { ngbCells[numNgbCells++] = parentIdx - 1;         }
+	if (parentX < ws.window.x1) { ngbCells[numNgbCells++] = parentIdx + 1;         }
+
+	// NOTE: not static, multiple workspaces can be solved concurrently
+	float        dirCosts[NUM_DIRS] = {0.0f};
+	bool         dirValid[NUM_DIRS] = {false};
+	unsigned int dirCells[NUM_DIRS] = {NO_CELL, NO_CELL, NO_CELL, NO_CELL};
+
+	unsigned int minPotCellX = NO_CELL;
+	unsigned int minPotCellY = NO_CELL;
+	int          minPotCellDirX = -1;
+	int          minPotCellDirY = -1;
+
+	unsigned int edgeIdxX = 0;
+	unsigned int edgeIdxY = 0;
+
+	for (unsigned int i = 0; i < numNgbCells; i++) {
+		const unsigned int ngbIdx = ngbCells[i];
+		const unsigned int ngbX = ngbIdx % numCellsX;
+		const unsigned int ngbY = ngbIdx / numCellsX;
+
+		#if (FMM_TRACE_TOUCHED_BYTES == 1)
+		if (!buffer.IsCurrentCell(ngbIdx)) {
+			// written by ResetCell
+			FMM_TRACE_TOUCH(ws, buffer.potentials[ngbIdx]);
+			FMM_TRACE_TOUCH_N(ws, buffer.speeds[ngbIdx * NUM_DIRS], NUM_DIRS);
+			FMM_TRACE_TOUCH_N(ws, buffer.costs[ngbIdx * NUM_DIRS], NUM_DIRS);
+		}
 
-		Cell* currNgb = &currCells[ngbIdx];
-		Cell* prevNgb = &prevCells[ngbIdx];
+		FMM_TRACE_TOUCH(ws, buffer.cellEpochs[ngbIdx]);
+		FMM_TRACE_TOUCH(ws, buffer.states[ngbIdx]);
+		#endif
 
-		prevNgb->ResetGroupVars();
+		buffer.TouchCell(ngbIdx);
 
-		if (currNgb->known || currNgb->candidate) {
+		if ((buffer.states[ngbIdx] & (CELL_KNOWN | CELL_CANDIDATE)) != 0) {
+			// known or candidate
 			continue;
 		}
 
 		#if (SPEED_COST_POTENTIAL_MERGED_COMPUTATION == 1)
-		ComputeCellSpeedAndCostMERGED(groupID, currNgb, currCells, currEdges);
-		#else
-		groupID = groupID;
+		ComputeCellSpeedAndCostMERGED(ws, ngbIdx, buffer);
 		#endif
 
-		dirCells[DIR_N] = (currNgb->y >             0) ? &currCells[GRID_INDEX_UNSAFE(currNgb->x    , currNgb->y - 1)] : NULL;
-		dirCells[DIR_S] = (currNgb->y < numCellsZ - 1) ? &currCells[GRID_INDEX_UNSAFE(currNgb->x    , currNgb->y + 1)] : NULL;
-		dirCells[DIR_E] = (currNgb->x < numCellsX - 1) ? &currCells[GRID_INDEX_UNSAFE(currNgb->x + 1, currNgb->y    )] : NULL;
-		dirCells[DIR_W] = (currNgb->x >             0) ? &currCells[GRID_INDEX_UNSAFE(currNgb->x - 1, currNgb->y    )] : NULL;
+		const float* ngbCosts = &buffer.costs[ngbIdx * NUM_DIRS];
+		      float& ngbPotential = buffer.potentials[ngbIdx];
+
+		FMM_TRACE_TOUCH_N(ws, buffer.costs[ngbIdx * NUM_DIRS], NUM_DIRS);
+		FMM_TRACE_TOUCH(ws, buffer.potentials[ngbIdx]);
+
+		dirCells[DIR_N] = (ngbY >             0) ? (ngbIdx - numCellsX) : NO_CELL;
+		dirCells[DIR_S] = (ngbY < numCellsZ - 1) ? (ngbIdx + numCellsX) : NO_CELL;
+		dirCells[DIR_E] = (ngbX < numCellsX - 1) ? (ngbIdx + 1        ) : NO_CELL;
+		dirCells[DIR_W] = (ngbX >             0) ? (ngbIdx - 1        ) : NO_CELL;
 
 		for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
-			if (dirCells[dir] == NULL) {
+			if (dirCells[dir] == NO_CELL) {
 				dirValid[dir] = false;
 				dirCosts[dir] = std::numeric_limits<float>::infinity();
 			} else {
-				dirCosts[dir] = (dirCells[dir]->potential + dirCells[dir]->cost[dir]);
+				// cells not yet visited by this solve have infinite potential
+				dirCosts[dir] = (buffer.GetPotential(dirCells[dir]) + buffer.costs[dirCells[dir] * NUM_DIRS + dir]);
+
+				FMM_TRACE_TOUCH(ws, buffer.cellEpochs[dirCells[dir]]);
+				FMM_TRACE_TOUCH(ws, buffer.potentials[dirCells[dir]]);
+				FMM_TRACE_TOUCH(ws, buffer.costs[dirCells[dir] * NUM_DIRS + dir]);
 				dirValid[dir] = (dirCosts[dir] != std::numeric_limits<float>::infinity());
 			}
 		}
@@ -1150,118 +2434,402 @@ void CCGrid::UpdateCandidates(unsigned int groupID, const Cell* parent) {
 			// both dimensions are defined
 			if (dirCosts[DIR_E] < dirCosts[DIR_W]) {
 				minPotCellDirX = DIR_E;
-				minPotCellPtrX = dirCells[DIR_E];
+				minPotCellX = dirCells[DIR_E];
 			} else {
 				minPotCellDirX = DIR_W;
-				minPotCellPtrX = dirCells[DIR_W];
+				minPotCellX = dirCells[DIR_W];
 			}
 
 			if (dirCosts[DIR_N] < dirCosts[DIR_S]) {
 				minPotCellDirY = DIR_N;
-				minPotCellPtrY = dirCells[DIR_N];
+				minPotCellY = dirCells[DIR_N];
 			} else {
 				minPotCellDirY = DIR_S;
-				minPotCellPtrY = dirCells[DIR_S];
+				minPotCellY = dirCells[DIR_S];
 			}
 
 			PFFG_ASSERT(dirValid[DIR_N] || dirValid[DIR_S]);
 			PFFG_ASSERT(dirValid[DIR_E] || dirValid[DIR_W]);
-			PFFG_ASSERT(minPotCellPtrX != NULL && minPotCellPtrY != NULL);
+			PFFG_ASSERT(minPotCellX != NO_CELL && minPotCellY != NO_CELL);
 
-			if (minPotCellPtrX != NULL && minPotCellPtrY != NULL) {
-				currNgb->potential = Potential2D(
-					minPotCellPtrX->potential, currNgb->cost[minPotCellDirX], 
-					minPotCellPtrY->potential, currNgb->cost[minPotCellDirY]
+			if (minPotCellX != NO_CELL && minPotCellY != NO_CELL) {
+				const float minPotX = buffer.potentials[minPotCellX];
+				const float minPotY = buffer.potentials[minPotCellY];
+
+				ngbPotential = Potential2D(
+					minPotX, ngbCosts[minPotCellDirX], 
+					minPotY, ngbCosts[minPotCellDirY]
 				);
 
 				// the world-space direction of the gradient vector must always
 				// match the direction along which the potential increases, but
 				// for DIR_N and DIR_W these are inverted
-				const float gradientX = (minPotCellPtrX->potential - currNgb->potential);
-				const float gradientY = (minPotCellPtrY->potential - currNgb->potential);
+				const float gradientX = (minPotX - ngbPotential);
+				const float gradientY = (minPotY - ngbPotential);
 				const float scaleX    = (minPotCellDirX == DIR_W)? -1.0f: 1.0f;
 				const float scaleY    = (minPotCellDirY == DIR_N)? -1.0f: 1.0f;
 				const vec3f gradient  = vec3f(gradientX * scaleX, 0.0f, gradientY * scaleY);
 
-				currEdgeX = &currEdges[currNgb->edges[minPotCellDirX]];
-				currEdgeY = &currEdges[currNgb->edges[minPotCellDirY]];
-				prevEdgeX = &prevEdges[currNgb->edges[minPotCellDirX]];
-				prevEdgeY = &prevEdges[currNgb->edges[minPotCellDirY]];
+				edgeIdxX = GetEdgeIndex(ngbX, ngbY, minPotCellDirX);
+				edgeIdxY = GetEdgeIndex(ngbX, ngbY, minPotCellDirY);
+
+				buffer.SetPotentialDelta(edgeIdxX, gradient);
+				buffer.SetPotentialDelta(edgeIdxY, gradient);
 
-				currEdgeX->potentialDelta = gradient;
-				currEdgeY->potentialDelta = gradient;
-				prevEdgeX->potentialDelta = NVECf;
-				prevEdgeY->potentialDelta = NVECf;
+				FMM_TRACE_TOUCH(ws, buffer.potentialDeltas[edgeIdxX]);
+				FMM_TRACE_TOUCH(ws, buffer.edgeEpochs[edgeIdxX]);
+				FMM_TRACE_TOUCH(ws, buffer.potentialDeltas[edgeIdxY]);
+				FMM_TRACE_TOUCH(ws, buffer.edgeEpochs[edgeIdxY]);
 			} else {
-				numIllegalDirectionCases += 1;
+				ws.numIllegalDirectionCases += 1;
 			}
 		} else {
 			if (undefinedX) {
 				if (dirCosts[DIR_N] < dirCosts[DIR_S]) {
 					minPotCellDirY = DIR_N;
-					minPotCellPtrY = dirCells[DIR_N];
+					minPotCellY = dirCells[DIR_N];
 				} else {
 					minPotCellDirY = DIR_S;
-					minPotCellPtrY = dirCells[DIR_S];
+					minPotCellY = dirCells[DIR_S];
 				}
 
 				PFFG_ASSERT(dirValid[DIR_N] || dirValid[DIR_S]);
 				PFFG_ASSERT(!undefinedY);
-				PFFG_ASSERT(minPotCellPtrY != NULL);
+				PFFG_ASSERT(minPotCellY != NO_CELL);
 
-				if (minPotCellPtrY != NULL) {
-					currNgb->potential = Potential1D(minPotCellPtrY->potential, currNgb->cost[minPotCellDirY]);
+				if (minPotCellY != NO_CELL) {
+					const float minPotY = buffer.potentials[minPotCellY];
 
-					const float gradientY = (minPotCellPtrY->potential - currNgb->potential);
+					ngbPotential = Potential1D(minPotY, ngbCosts[minPotCellDirY]);
+
+					const float gradientY = (minPotY - ngbPotential);
 					const float scaleY    = (minPotCellDirY == DIR_N)? -1.0f: 1.0f;
 					const vec3f gradient  = vec3f(0.0f, 0.0f, gradientY * scaleY);
 
-					currEdgeY = &currEdges[currNgb->edges[minPotCellDirY]];
-					prevEdgeY = &prevEdges[currNgb->edges[minPotCellDirY]];
+					edgeIdxY = GetEdgeIndex(ngbX, ngbY, minPotCellDirY);
+
+					buffer.SetPotentialDelta(edgeIdxY, gradient);
 
-					currEdgeY->potentialDelta = gradient;
-					prevEdgeY->potentialDelta = NVECf;
+					FMM_TRACE_TOUCH(ws, buffer.potentialDeltas[edgeIdxY]);
+					FMM_TRACE_TOUCH(ws, buffer.edgeEpochs[edgeIdxY]);
 				} else {
-					numIllegalDirectionCases += 1;
+					ws.numIllegalDirectionCases += 1;
 				}
 			}
 
 			if (undefinedY) {
 				if (dirCosts[DIR_E] < dirCosts[DIR_W]) {
 					minPotCellDirX = DIR_E;
-					minPotCellPtrX = dirCells[DIR_E];
+					minPotCellX = dirCells[DIR_E];
 				} else {
 					minPotCellDirX = DIR_W;
-					minPotCellPtrX = dirCells[DIR_W];
+					minPotCellX = dirCells[DIR_W];
 				}
 
 				PFFG_ASSERT(dirValid[DIR_E] || dirValid[DIR_W]);
 				PFFG_ASSERT(!undefinedX);
-				PFFG_ASSERT(minPotCellPtrX != NULL);
+				PFFG_ASSERT(minPotCellX != NO_CELL);
 
-				if (minPotCellPtrX != NULL) {
-					currNgb->potential = Potential1D(minPotCellPtrX->potential, currNgb->cost[minPotCellDirX]);
+				if (minPotCellX != NO_CELL) {
+					const float minPotX = buffer.potentials[minPotCellX];
 
-					const float gradientX = (minPotCellPtrX->potential - currNgb->potential);
+					ngbPotential = Potential1D(minPotX, ngbCosts[minPotCellDirX]);
+
+					const float gradientX = (minPotX - ngbPotential);
 					const float scaleX    = (minPotCellDirX == DIR_W)? -1.0f: 1.0f;
 					const vec3f gradient  = vec3f(gradientX * scaleX, 0.0f, 0.0f);
 
-					currEdgeX = &currEdges[currNgb->edges[minPotCellDirX]];
-					prevEdgeX = &prevEdges[currNgb->edges[minPotCellDirX]];
+					edgeIdxX = GetEdgeIndex(ngbX, ngbY, minPotCellDirX);
+
+					buffer.SetPotentialDelta(edgeIdxX, gradient);
 
-					currEdgeX->potentialDelta = gradient;
-					prevEdgeX->potentialDelta = NVECf;
+					FMM_TRACE_TOUCH(ws, buffer.potentialDeltas[edgeIdxX]);
+					FMM_TRACE_TOUCH(ws, buffer.edgeEpochs[edgeIdxX]);
 				} else {
-					numIllegalDirectionCases += 1;
+					ws.numIllegalDirectionCases += 1;
 				}
 			}
 		}
 
-		currNgb->candidate = true;
-		mCandidates.push(currNgb);
+		buffer.states[ngbIdx] |= CELL_CANDIDATE;
+		PushCandidate(ws, ngbIdx);
+
+		ws.numInfinitePotentialCases += int(ngbPotential == std::numeric_limits<float>::infinity());
+	}
+}
+
+
+
+// candidates are ordered by potential, or by potential plus
+// heuristic bound (stored in <candidateKeys>) if the solve in
+// <ws> is heuristic; the potential of a candidate never changes
+// after it is pushed, so neither does its key
+void CCGrid::PushCandidate(Workspace& ws, unsigned int cellIdx) {
+	float key = ws.buffer.potentials[cellIdx];
+
+	if (ws.heuristic) {
+		key += GetHeuristicBound(ws, cellIdx);
+		ws.candidateKeys[cellIdx] = key;
+	}
+
+	if (ws.queueMode == FMM_QUEUE_UNTIDY) {
+		ws.bucketCandidates.push(cellIdx, key);
+	} else {
+		const float* keys = ws.heuristic? &ws.candidateKeys[0]: &ws.buffer.potentials[0];
+
+		ws.candidates.push_back(cellIdx);
+		std::push_heap(ws.candidates.begin(), ws.candidates.end(), CellPotentialCmp(keys));
+	}
+}
+
+void CCGrid::PopCandidate(Workspace& ws) {
+	if (ws.queueMode == FMM_QUEUE_UNTIDY) {
+		ws.bucketCandidates.pop();
+	} else {
+		const float* keys = ws.heuristic? &ws.candidateKeys[0]: &ws.buffer.potentials[0];
+
+		std::pop_heap(ws.candidates.begin(), ws.candidates.end(), CellPotentialCmp(keys));
+		ws.candidates.pop_back();
+	}
+}
+
+unsigned int CCGrid::TopCandidate(Workspace& ws) {
+	if (ws.queueMode == FMM_QUEUE_UNTIDY) {
+		return ws.bucketCandidates.top();
+	}
+
+	return ws.candidates.front();
+}
+
+bool CCGrid::HaveCandidates(const Workspace& ws) const {
+	return (!ws.candidates.empty() || !ws.bucketCandidates.empty());
+}
+
+
+
+// fast sweeping method (Zhao, 2005): rather than settling the cells
+// in order of increasing potential, every cell is relaxed repeatedly
+// (Gauss-Seidel) in four alternating raster orders until no potential
+// decreases any more; each relaxation uses the same upwind choice and
+// Potential1D / Potential2D updates as UpdateCandidates
+//
+// NOTE:
+//    one iteration is O(N) and needs no priority queue, but the number
+//    of iterations grows with the number of times the characteristics
+//    change direction (ie. with the number of obstacles and the amount
+//    of discomfort), so FMM can still be faster on some maps
+void CCGrid::SolveGroupPotentialFieldFSM(Workspace& ws, const std::set<unsigned int>& goalIDs) {
+	PFFG_ASSERT(!HaveCandidates(ws));
+
+	Buffer& buffer = ws.buffer;
+
+	std::vector<EdgeVelocity>& edgeVelocities = *ws.edgeVelocities;
+
+	const unsigned int numCells = numCellsX * numCellsZ;
+
+	unsigned int cellEdges[NUM_DIRS] = {0};
+
+	PFFG_ASSERT(ws.window == GetFullWindow());
+
+	// every cell is swept, so there is nothing to gain
+	// from resetting them lazily
+	buffer.NextEpoch();
+	buffer.TouchAll();
+
+	// goal-cells are fixed at zero potential and (as in the
+	// FMM) keep zero speed and cost; every other cell needs
+	// its speed and cost before the first sweep
+	for (std::set<unsigned int>::const_iterator it = goalIDs.begin(); it != goalIDs.end(); ++it) {
+		buffer.states[*it] = CELL_KNOWN;
+		buffer.potentials[*it] = 0.0f;
+	}
+
+	for (unsigned int cellIdx = 0; cellIdx < numCells; cellIdx++) {
+		if (buffer.states[cellIdx] == 0) {
+			ComputeCellSpeedAndCost(ws, cellIdx, buffer, false);
+		}
+	}
+
+	for (unsigned int n = 0, numUpdates = 1; n < mFSMMaxIterations && numUpdates > 0; n++) {
+		numUpdates = 0;
+
+		// orderings (+x, +z), (-x, +z), (-x, -z), (+x, -z); rows
+		// within one sweep depend on each other, cells in a row
+		// only through their horizontal neighbors
+		for (unsigned int sweep = 0; sweep < 4; sweep++) {
+			const bool reverseX = (sweep == 1 || sweep == 2);
+			const bool reverseZ = (sweep >= 2);
+
+			for (unsigned int row = 0; row < numCellsZ; row++) {
+				numUpdates += SweepRow(ws, (reverseZ? (numCellsZ - 1 - row): row), reverseX);
+			}
+		}
+	}
+
+	// store the gradients, then the velocities; the edges of
+	// goal-cells are cleared first so that edges shared with
+	// other cells take the values of the latter
+	for (std::set<unsigned int>::const_iterator it = goalIDs.begin(); it != goalIDs.end(); ++it) {
+		GetCellEdgeIndices(*it, cellEdges);
+
+		for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+			edgeVelocities[ cellEdges[dir] ].Set(NVECf);
+		}
+	}
+
+	for (unsigned int cellIdx = 0; cellIdx < numCells; cellIdx++) {
+		if (buffer.states[cellIdx] == 0) {
+			ComputeCellPotentialDeltas(buffer, cellIdx);
+		}
+	}
+
+	ws.numInfinitePotentialCases = 0;
+	ws.numIllegalDirectionCases = 0;
+
+	for (unsigned int cellIdx = 0; cellIdx < numCells; cellIdx++) {
+		if (buffer.states[cellIdx] != 0) {
+			continue;
+		}
+
+		GetCellEdgeIndices(cellIdx, cellEdges);
+
+		for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+			const unsigned int edgeIdx = cellEdges[dir];
+
+			edgeVelocities[edgeIdx].Set(GetNormalisedPotentialGradient(buffer, edgeIdx) * -buffer.speeds[cellIdx * NUM_DIRS + dir]);
+		}
+
+		ws.numInfinitePotentialCases += int(buffer.potentials[cellIdx] == std::numeric_limits<float>::infinity());
+	}
+
+	PFFG_ASSERT(ws.numInfinitePotentialCases == 0);
+}
+
+// relaxes every cell in row <y> once, in increasing (or decreasing
+// if <reverseX>) order of x, and returns how many potentials dropped
+unsigned int CCGrid::SweepRow(Workspace& ws, unsigned int y, bool reverseX) {
+	static const float INF = std::numeric_limits<float>::infinity();
+
+	Buffer& buffer = ws.buffer;
+
+	const unsigned int rowIdx = y * numCellsX;
+
+	float*               potentials = &buffer.potentials[0];
+	const float*         costs      = &buffer.costs[0];
+	const unsigned char* rowStates  = &buffer.states[rowIdx];
+
+	float* potentialsY = &ws.sweepPotentialsY[0];
+	float* costsY      = &ws.sweepCostsY[0];
+
+	// the rows above and below do not change while this one is
+	// swept, so the vertical half of the upwind choice is made
+	// for the whole row first (this loop has no loop-carried
+	// dependencies and can be vectorised)
+	{
+		const unsigned int ngbIdxN = (y >             0)? (rowIdx - numCellsX): rowIdx;
+		const unsigned int ngbIdxS = (y < numCellsZ - 1)? (rowIdx + numCellsX): rowIdx;
+		const float        validN  = (y >             0)? 0.0f: INF;
+		const float        validS  = (y < numCellsZ - 1)? 0.0f: INF;
+
+		for (unsigned int x = 0; x < numCellsX; x++) {
+			const float dirCostN = validN + potentials[ngbIdxN + x] + costs[(ngbIdxN + x) * NUM_DIRS + DIR_N];
+			const float dirCostS = validS + potentials[ngbIdxS + x] + costs[(ngbIdxS + x) * NUM_DIRS + DIR_S];
+
+			if (dirCostN < dirCostS) {
+				potentialsY[x] = potentials[ngbIdxN + x];
+				costsY[x] = costs[(rowIdx + x) * NUM_DIRS + DIR_N];
+			} else {
+				potentialsY[x] = (dirCostS != INF)? potentials[ngbIdxS + x]: INF;
+				costsY[x] = costs[(rowIdx + x) * NUM_DIRS + DIR_S];
+			}
+		}
+	}
+
+	unsigned int numUpdates = 0;
+
+	for (unsigned int n = 0; n < numCellsX; n++) {
+		const unsigned int x = reverseX? (numCellsX - 1 - n): n;
+		const unsigned int cellIdx = rowIdx + x;
+
+		if (rowStates[x] != 0) {
+			continue;
+		}
+
+		const float dirCostE = (x < numCellsX - 1)? (potentials[cellIdx + 1] + costs[(cellIdx + 1) * NUM_DIRS + DIR_E]): INF;
+		const float dirCostW = (x >             0)? (potentials[cellIdx - 1] + costs[(cellIdx - 1) * NUM_DIRS + DIR_W]): INF;
+
+		float potentialX = INF;
+		float costX = 0.0f;
+
+		if (dirCostE < dirCostW) {
+			potentialX = potentials[cellIdx + 1];
+			costX = costs[cellIdx * NUM_DIRS + DIR_E];
+		} else {
+			potentialX = (dirCostW != INF)? potentials[cellIdx - 1]: INF;
+			costX = costs[cellIdx * NUM_DIRS + DIR_W];
+		}
+
+		const bool undefinedX = (potentialX == INF);
+		const bool undefinedY = (potentialsY[x] == INF);
+
+		float potential = INF;
+
+		if (!undefinedX && !undefinedY) {
+			potential = Potential2D(potentialX, costX, potentialsY[x], costsY[x]);
+		} else if (!undefinedY) {
+			potential = Potential1D(potentialsY[x], costsY[x]);
+		} else if (!undefinedX) {
+			potential = Potential1D(potentialX, costX);
+		}
+
+		if (potential < potentials[cellIdx]) {
+			potentials[cellIdx] = potential;
+			numUpdates += 1;
+		}
+	}
+
+	return numUpdates;
+}
+
+// stores the gradient of a solved cell on the edges towards its
+// upwind neighbors (the FMM does this in UpdateCandidates)
+void CCGrid::ComputeCellPotentialDeltas(Buffer& buffer, unsigned int cellIdx) {
+	const unsigned int cellX = cellIdx % numCellsX;
+	const unsigned int cellY = cellIdx / numCellsX;
+
+	const float potential = buffer.potentials[cellIdx];
 
-		numInfinitePotentialCases += int(currNgb->potential == std::numeric_limits<float>::infinity());
+	float        dirCosts[NUM_DIRS] = {0.0f};
+	unsigned int dirCells[NUM_DIRS] = {NO_CELL, NO_CELL, NO_CELL, NO_CELL};
+
+	dirCells[DIR_N] = (cellY >             0) ? (cellIdx - numCellsX) : NO_CELL;
+	dirCells[DIR_S] = (cellY < numCellsZ - 1) ? (cellIdx + numCellsX) : NO_CELL;
+	dirCells[DIR_E] = (cellX < numCellsX - 1) ? (cellIdx + 1        ) : NO_CELL;
+	dirCells[DIR_W] = (cellX >             0) ? (cellIdx - 1        ) : NO_CELL;
+
+	for (unsigned int dir = 0; dir < NUM_DIRS; dir++) {
+		if (dirCells[dir] == NO_CELL) {
+			dirCosts[dir] = std::numeric_limits<float>::infinity();
+		} else {
+			dirCosts[dir] = (buffer.potentials[dirCells[dir]] + buffer.costs[dirCells[dir] * NUM_DIRS + dir]);
+		}
 	}
+
+	const int minPotCellDirX = (dirCosts[DIR_E] < dirCosts[DIR_W])? DIR_E: DIR_W;
+	const int minPotCellDirY = (dirCosts[DIR_N] < dirCosts[DIR_S])? DIR_N: DIR_S;
+
+	const bool undefinedX = (dirCosts[minPotCellDirX] == std::numeric_limits<float>::infinity());
+	const bool undefinedY = (dirCosts[minPotCellDirY] == std::numeric_limits<float>::infinity());
+
+	// the world-space direction of the gradient vector must always
+	// match the direction along which the potential increases, but
+	// for DIR_N and DIR_W these are inverted
+	const float gradientX = undefinedX? 0.0f: ((buffer.potentials[dirCells[minPotCellDirX]] - potential) * ((minPotCellDirX == DIR_W)? -1.0f: 1.0f));
+	const float gradientY = undefinedY? 0.0f: ((buffer.potentials[dirCells[minPotCellDirY]] - potential) * ((minPotCellDirY == DIR_N)? -1.0f: 1.0f));
+	const vec3f gradient  = vec3f(gradientX, 0.0f, gradientY);
+
+	if (!undefinedX) { buffer.SetPotentialDelta(GetEdgeIndex(cellX, cellY, minPotCellDirX), gradient); }
+	if (!undefinedY) { buffer.SetPotentialDelta(GetEdgeIndex(cellX, cellY, minPotCellDirY), gradient); }
 }
 
 
@@ -1290,42 +2858,98 @@ float CCGrid::Potential2D(const float p1, const float c1, const float p2, const
 
 
 
-bool CCGrid::UpdateSimObjectLocation(unsigned int groupID, unsigned int objectID, unsigned int objectCellID) {
-	const vec3f& objectPos = mCOH->GetSimObjectPosition(objectID);
-	const vec3f& objectDir = mCOH->GetSimObjectDirection(objectID);
-	const float  objectSpd = mCOH->GetSimObjectSpeed(objectID);
+void CCGrid::AdvectionArrays::Clear() {
+	objectIDs.clear();
+	cellIndices.clear();
+
+	positions.clear();
+	directions.clear();
+	speeds.clear();
+
+	maxForwardSpeeds.clear();
+	maxAccelerationRates.clear();
+	maxDeccelerationRates.clear();
+	maxTurningRateCos.clear();
+	maxTurningRateSin.clear();
+
+	wantedPositions.clear();
+	wantedDirections.clear();
+	wantedSpeeds.clear();
+	moved.clear();
+}
+
+void CCGrid::AdvectionArrays::Push(
+	unsigned int objectID,
+	unsigned int cellIdx,
+	const vec3f& pos,
+	const vec3f& dir,
+	float speed,
+	const AdvectionLimits& limits
+) {
+	objectIDs.push_back(objectID);
+	cellIndices.push_back(cellIdx);
+
+	positions.push_back(pos);
+	directions.push_back(dir);
+	speeds.push_back(speed);
+
+	maxForwardSpeeds.push_back(limits.maxForwardSpeed);
+	maxAccelerationRates.push_back(limits.maxAccelerationRate);
+	maxDeccelerationRates.push_back(limits.maxDeccelerationRate);
+	maxTurningRateCos.push_back(limits.maxTurningRateCos);
+	maxTurningRateSin.push_back(limits.maxTurningRateSin);
+
+	wantedPositions.push_back(pos);
+	wantedDirections.push_back(dir);
+	wantedSpeeds.push_back(speed);
+	moved.push_back(0);
+}
+
+void CCGrid::UpdateSimObjectLocations(unsigned int groupID, AdvectionArrays& objects) const {
+	const unsigned int numObjects = objects.GetSize();
+
+	if (numObjects == 0) {
+		return;
+	}
+
+	// every member follows the same velocity-field, so
+	// it only has to be looked up once for the group
+	const std::vector<EdgeVelocity>& edgeVelocities = mGroupEdgeVelocities.find(groupID)->second;
+
+	for (unsigned int n = 0; n < numObjects; n++) {
+		const unsigned int objectCellID = objects.cellIndices[n];
 
-	const Buffer& buffer =
-		(mUpdateInt > 1)?
-		mGroupGridStates[groupID]:
-		mGridStates[mCurrBufferIdx];
+		const vec3f& objectPos = objects.positions[n];
+		const vec3f& objectDir = objects.directions[n];
+		const float  objectSpd = objects.speeds[n];
 
-	const std::vector<Cell      >& currCells = buffer.cells;
-	const std::vector<Cell::Edge>& currEdges = buffer.edges;
+		const vec3f& objectCellVel = GetInterpolatedVelocity(edgeVelocities, objectCellID, objectPos, objectDir);
 
+		PFFG_ASSERT_MSG(!(std::isnan(objectCellVel.x) || std::isnan(objectCellVel.y) || std::isnan(objectCellVel.z)), "Inf velocity-field for cell <%u,%u>", objectCellID % numCellsX, objectCellID / numCellsX);
+		PFFG_ASSERT_MSG(!(std::isinf(objectCellVel.x) || std::isinf(objectCellVel.y) || std::isinf(objectCellVel.z)), "NaN velocity-field for cell <%u,%u>", objectCellID % numCellsX, objectCellID / numCellsX);
 
-	const Cell* objectCell = &currCells[objectCellID];
-	const vec3f& objectCellVel = GetInterpolatedVelocity(currEdges, objectCell, objectPos, objectDir);
+		objects.moved[n] = (objectCellVel.sqLen2D() > EPSILON);
 
-	PFFG_ASSERT_MSG(!(std::isnan(objectCellVel.x) || std::isnan(objectCellVel.y) || std::isnan(objectCellVel.z)), "Inf velocity-field for cell <%u,%u>", objectCell->x, objectCell->y);
-	PFFG_ASSERT_MSG(!(std::isinf(objectCellVel.x) || std::isinf(objectCellVel.y) || std::isinf(objectCellVel.z)), "NaN velocity-field for cell <%u,%u>", objectCell->x, objectCell->y);
+		if (objects.moved[n] == 0) {
+			continue;
+		}
 
-	if (objectCellVel.sqLen2D() > EPSILON) {
 		#if (VELOCITY_FIELD_DIRECT_INTERPOLATION == 1)
-			mCOH->SetSimObjectRawPhysicalState(objectID, objectPos + objectCellVel, objectCellVel.norm3D(), objectCellVel.len2D());
+			objects.wantedPositions[n]  = objectPos + objectCellVel;
+			objects.wantedDirections[n] = objectCellVel.norm3D();
+			objects.wantedSpeeds[n]     = objectCellVel.len2D();
 		#else
 			static const float MAX_ANGLE_DEG = 90.0f;
-			static const float MIN_ANGLE_RAD = DEG2RAD(2.0f);
 			static const float MAX_SPEED_FAC = EPSILON * 10.0f;
 
-			const SimObjectDef* objectDef = mCOH->GetSimObjectDef(objectID);
+			const float maxAccRate = objects.maxAccelerationRates[n];
+			const float maxDecRate = objects.maxDeccelerationRates[n];
+			const float spdFactor  = objectSpd / objects.maxForwardSpeeds[n];     // FIXME: greater than 1
 
-			const float maxAccRate      = objectDef->GetMaxAccelerationRate();
-			const float maxDecRate      = objectDef->GetMaxDeccelerationRate();
-			const float spdFactor       = objectSpd / objectDef->GetMaxForwardSpeed();     // FIXME: greater than 1
-			const float maxTurnAngleDeg = objectDef->GetMaxTurningRate();                  // degrees per frame (!)
-
-			float turnAngleDeg = maxTurnAngleDeg;
+			// cosine and sine of the maximum angle the object
+			// can turn by this frame (degrees per frame (!))
+			float turnRateCos = objects.maxTurningRateCos[n];
+			float turnRateSin = objects.maxTurningRateSin[n];
 
 			#if (SIMOBJECT_ALLOW_INPLACE_TURNS == 1)
 			// turnAngleDeg = MMIX(maxTurnAngleDeg * 0.2f, maxTurnAngleDeg, spdFactor);       // linear interpolation
@@ -1333,7 +2957,10 @@ bool CCGrid::UpdateSimObjectLocation(unsigned int groupID, unsigned int objectID
 			// turnAngleDeg = (spdFactor < EPSILON)? 180.0f: maxTurnAngleDeg;                 // insta-turns when idle
 
 			if (spdFactor < MAX_SPEED_FAC) {
-				turnAngleDeg = MAX_ANGLE_DEG - (MAX_ANGLE_DEG * spdFactor * (1.0f / MAX_SPEED_FAC));
+				const float turnAngleRad = DEG2RAD(MAX_ANGLE_DEG - (MAX_ANGLE_DEG * spdFactor * (1.0f / MAX_SPEED_FAC)));
+
+				turnRateCos = cosf(turnAngleRad);
+				turnRateSin = sinf(turnAngleRad);
 			}
 			#endif
 
@@ -1341,7 +2968,7 @@ bool CCGrid::UpdateSimObjectLocation(unsigned int groupID, unsigned int objectID
 			// in theory, the velocity-field should never cause units
 			// in any group to exceed that group's speed limitations
 			// (note that this is not true on slopes)
-			// float wantedSpeed = std::min(objectCellVel.len2D(), objectDef->GetMaxForwardSpeed());
+			// float wantedSpeed = std::min(objectCellVel.len2D(), objects.maxForwardSpeeds[n]);
 			float wantedSpeed = objectCellVel.len2D();
 
 			// note: should accelerate and deccelerate more quickly on slopes
@@ -1355,48 +2982,47 @@ bool CCGrid::UpdateSimObjectLocation(unsigned int groupID, unsigned int objectID
 			vec3f wantedDir = objectCellVel.norm3D();
 
 			{
-				float forwardGlobalAngleRad = atan2f(-objectDir.z, -objectDir.x);
-				float wantedGlobalAngleRad = atan2f(-wantedDir.z, -wantedDir.x);
-				float deltaGlobalAngleRad = 0.0f;
-
-				if (forwardGlobalAngleRad < 0.0f) { forwardGlobalAngleRad += (M_PI * 2.0f); }
-				if (wantedGlobalAngleRad < 0.0f) { wantedGlobalAngleRad += (M_PI * 2.0f); }
-
-				deltaGlobalAngleRad = (forwardGlobalAngleRad - wantedGlobalAngleRad);
-
-				// take the shorter of the two possible turns
-				// (positive angle means a right turn and vv)
-				if (deltaGlobalAngleRad >  M_PI) { deltaGlobalAngleRad = -((M_PI * 2.0f) - deltaGlobalAngleRad); }
-				if (deltaGlobalAngleRad < -M_PI) { deltaGlobalAngleRad =  ((M_PI * 2.0f) + deltaGlobalAngleRad); }
+				// cosine and sine of the angle between the horizontal
+				// forward and wanted directions, with the sign of the
+				// sine such that a positive angle is a right turn (the
+				// same convention as PhysicalStateArrays::Integrate)
+				const float sqLenProduct = (objectDir.x * objectDir.x + objectDir.z * objectDir.z) * (wantedDir.x * wantedDir.x + wantedDir.z * wantedDir.z);
+				const float invLenProduct = (sqLenProduct > 0.0f)? (1.0f / sqrtf(sqLenProduct)): 0.0f;
+
+				const float turnAngleCos = (sqLenProduct > 0.0f)? ((objectDir.x * wantedDir.x + objectDir.z * wantedDir.z) * invLenProduct): 1.0f;
+				const float turnAngleSin = (wantedDir.x * objectDir.z - wantedDir.z * objectDir.x) * invLenProduct;
+
+				// take the shorter of the two possible turns, but by
+				// no more than the turning-rate allows this frame
+				const bool  instaTurn = (turnAngleCos >= turnRateCos);
+				const float rotAngleCos = instaTurn? turnAngleCos: turnRateCos;
+				const float rotAngleSin = instaTurn? turnAngleSin: ((turnAngleSin > 0.0f)? turnRateSin: -turnRateSin);
 
 				// ignore angles smaller than 2 degrees (2PI/180 radians) or
 				// units will experience oscillations (at higher turn-rates)
 				// even when travelling in straight lines
 				// FIXME: units in tightly clustered groups still fish-tail
-				const float turnAngleRad = DEG2RAD(turnAngleDeg);
-
-				const bool  instaTurn = (std::fabs(deltaGlobalAngleRad) <= turnAngleRad);
-				const float turnAngle = instaTurn? deltaGlobalAngleRad: turnAngleRad;
-				const float turnSign  = (deltaGlobalAngleRad > 0.0f)? 1.0f: -1.0f;
-
-				if (std::fabs(turnAngle) > MIN_ANGLE_RAD || turnAngleRad <= MIN_ANGLE_RAD) {
-					wantedDir = objectDir.rotateY(turnAngle * turnSign);
+				if (rotAngleCos < MIN_TURNING_ANGLE_COS || turnRateCos >= MIN_TURNING_ANGLE_COS) {
+					// the same rotation as vec3::rotateY
+					wantedDir.x = rotAngleCos * objectDir.x + rotAngleSin * objectDir.z;
+					wantedDir.y = objectDir.y;
+					wantedDir.z = rotAngleCos * objectDir.z - rotAngleSin * objectDir.x;
 				} else {
 					wantedDir = objectDir;
 				}
 			}
 
-			// note: when using the individual Set*Raw* callouts,
-			// change the position last so that the object's new
-			// hasMoved state is not overwritten again
-			mCOH->SetSimObjectRawPhysicalState(objectID, objectPos + wantedDir * wantedSpeed, wantedDir, wantedSpeed);
+			objects.wantedPositions[n]  = objectPos + wantedDir * wantedSpeed;
+			objects.wantedDirections[n] = wantedDir;
+			objects.wantedSpeeds[n]     = wantedSpeed;
 		#endif
 	}
-
-	return true;
 }
 
-vec3f CCGrid::GetInterpolatedVelocity(const std::vector<Cell::Edge>& edges, const Cell* c, const vec3f& pos, const vec3f& dir) const {
+vec3f CCGrid::GetInterpolatedVelocity(const std::vector<EdgeVelocity>& edgeVelocities, unsigned int cellIdx, const vec3f& pos, const vec3f& dir) const {
+	const unsigned int cellX = cellIdx % numCellsX;
+	const unsigned int cellY = cellIdx / numCellsX;
+
 	vec3f vel;
 
 	float a = 0.0f;
@@ -1412,13 +3038,13 @@ vec3f CCGrid::GetInterpolatedVelocity(const std::vector<Cell::Edge>& edges, cons
 		// first get the relative distance to the
 		// DIR_W (a) and DIR_N (b) edges based on
 		// <pos>
-		a = CLAMP(((pos.x - c->x * mSquareSize) / mSquareSize), 0.0f, 1.0f);
-		b = CLAMP(((pos.z - c->y * mSquareSize) / mSquareSize), 0.0f, 1.0f);
+		a = CLAMP(((pos.x - cellX * mSquareSize) / mSquareSize), 0.0f, 1.0f);
+		b = CLAMP(((pos.z - cellY * mSquareSize) / mSquareSize), 0.0f, 1.0f);
 
-		const vec3f& vN = edges[ c->edges[DIR_N] ].velocity;
-		const vec3f& vS = edges[ c->edges[DIR_S] ].velocity;
-		const vec3f& vE = edges[ c->edges[DIR_E] ].velocity;
-		const vec3f& vW = edges[ c->edges[DIR_W] ].velocity;
+		const vec3f vN = edgeVelocities[ GetEdgeIndex(cellX, cellY, DIR_N) ].Get();
+		const vec3f vS = edgeVelocities[ GetEdgeIndex(cellX, cellY, DIR_S) ].Get();
+		const vec3f vE = edgeVelocities[ GetEdgeIndex(cellX, cellY, DIR_E) ].Get();
+		const vec3f vW = edgeVelocities[ GetEdgeIndex(cellX, cellY, DIR_W) ].Get();
 
 		const vec3f vTL = (vN + vW) * 0.5f; // top-left sample point
 		const vec3f vTR = (vN + vE) * 0.5f; // top-right sample point
@@ -1452,8 +3078,8 @@ vec3f CCGrid::GetInterpolatedVelocity(const std::vector<Cell::Edge>& edges, cons
 			b = -dir.z;
 		}
 
-		vel += (edges[ c->edges[i] ].velocity * a);
-		vel += (edges[ c->edges[j] ].velocity * b);
+		vel += (edgeVelocities[ GetEdgeIndex(cellX, cellY, i) ].Get() * a);
+		vel += (edgeVelocities[ GetEdgeIndex(cellX, cellY, j) ].Get() * b);
 	#endif
 
 	return vel;
@@ -1479,59 +3105,79 @@ unsigned int CCGrid::GetCellIndex1D(const vec3f& worldPos) const {
 
 // convert a cell's <x, y> grid-indices to the
 // world-space position of its top-left corner
-vec3f CCGrid::GetCellCornerPos(const Cell* c) const {
-	const float wx = c->x * mSquareSize;
-	const float wz = c->y * mSquareSize;
-	return vec3f(wx, ELEVATION(c->x, c->y), wz);
+vec3f CCGrid::GetCellCornerPos(unsigned int cellIdx) const {
+	const unsigned int cx = cellIdx % numCellsX;
+	const unsigned int cz = cellIdx / numCellsX;
+	const float wx = cx * mSquareSize;
+	const float wz = cz * mSquareSize;
+	return vec3f(wx, ELEVATION(cx, cz), wz);
 }
 
-vec3f CCGrid::GetCellMidPos(const Cell* c) const {
-	const float wx = (c->x * mSquareSize) + (mSquareSize >> 1);
-	const float wz = (c->y * mSquareSize) + (mSquareSize >> 1);
+vec3f CCGrid::GetCellMidPos(unsigned int cellIdx) const {
+	const float wx = ((cellIdx % numCellsX) * mSquareSize) + (mSquareSize >> 1);
+	const float wz = ((cellIdx / numCellsX) * mSquareSize) + (mSquareSize >> 1);
 	return vec3f(wx, 0.0f, wz);
 }
 
+// bilinearly interpolated potential of group <groupID> at <worldPos>
+// (from its last solve, in units of this grid's cells); falls back to
+// the potential of the cell containing <worldPos> if any of the four
+// surrounding cells was not reached, and returns infinity if that one
+// was not reached either
+float CCGrid::GetGroupPotential(unsigned int groupID, const vec3f& worldPos) const {
+	std::map<unsigned int, std::vector<float> >::const_iterator it = mGroupPotentials.find(groupID);
 
+	if (it == mGroupPotentials.end()) {
+		return std::numeric_limits<float>::infinity();
+	}
 
+	const std::vector<float>& potentials = it->second;
+
+	// position relative to the mid-point of cell <0, 0>
+	const float fx = CLAMP((worldPos.x / mSquareSize) - 0.5f, 0.0f, numCellsX - 1.0f);
+	const float fz = CLAMP((worldPos.z / mSquareSize) - 0.5f, 0.0f, numCellsZ - 1.0f);
+	const unsigned int x0 = fx, x1 = std::min(x0 + 1, numCellsX - 1);
+	const unsigned int z0 = fz, z1 = std::min(z0 + 1, numCellsZ - 1);
+	const float tx = fx - x0;
+	const float tz = fz - z0;
+
+	const float p00 = potentials[GRID_INDEX_UNSAFE(x0, z0)];
+	const float p10 = potentials[GRID_INDEX_UNSAFE(x1, z0)];
+	const float p01 = potentials[GRID_INDEX_UNSAFE(x0, z1)];
+	const float p11 = potentials[GRID_INDEX_UNSAFE(x1, z1)];
+
+	// unreached cells have infinite potential
+	if (p00 == std::numeric_limits<float>::infinity() || p10 == std::numeric_limits<float>::infinity() ||
+		p01 == std::numeric_limits<float>::infinity() || p11 == std::numeric_limits<float>::infinity()) {
+		return potentials[GetCellIndex1D(worldPos)];
+	}
 
+	return (MMIX(MMIX(p11, p01, tx), MMIX(p10, p00, tx), tz));
+}
 
 
-void CCGrid::Cell::ResetFull() {
-	ResetGlobalStaticVars();
-	ResetGlobalDynamicVars();
-	ResetGroupVars();
-}
 
-void CCGrid::Cell::ResetGlobalStaticVars() {
-	height = 0.0f; staticDiscomfort = NVECf;
-}
 
-void CCGrid::Cell::ResetGlobalDynamicVars() {
-	avgVelocity      = NVECf;
-	mobileDiscomfort = NVECf;
-	density          = 0.0f;
-}
 
-void CCGrid::Cell::ResetGroupVars() {
-	potential  = std::numeric_limits<float>::infinity();
 
-	known     = false;
-	candidate = false;
+void CCGrid::GetCellEdgeIndices(unsigned int cellIdx, unsigned int* edges) const {
+	const unsigned int cellX = cellIdx % numCellsX;
+	const unsigned int cellY = cellIdx / numCellsX;
 
-	speed[DIR_N] = cost[DIR_N] = 0.0f;
-	speed[DIR_S] = cost[DIR_S] = 0.0f;
-	speed[DIR_E] = cost[DIR_E] = 0.0f;
-	speed[DIR_W] = cost[DIR_W] = 0.0f;
+	edges[DIR_N] = GetEdgeIndex(cellX, cellY, DIR_N);
+	edges[DIR_S] = GetEdgeIndex(cellX, cellY, DIR_S);
+	edges[DIR_E] = GetEdgeIndex(cellX, cellY, DIR_E);
+	edges[DIR_W] = GetEdgeIndex(cellX, cellY, DIR_W);
 }
 
-vec3f CCGrid::Cell::GetNormalisedPotentialGradient(const std::vector<Cell::Edge>& gridEdges, unsigned int dir) const {
-	const Edge* edge = &gridEdges[edges[dir]];
-	const float plen = edge->potentialDelta.len2D();
+vec3f CCGrid::GetNormalisedPotentialGradient(const Buffer& buffer, unsigned int edgeIdx) const {
+	const vec3f potentialDelta = buffer.GetPotentialDelta(edgeIdx);
+	const float plen = potentialDelta.len2D();
 
 	vec3f pgrad;
 
 	if (plen > 0.0f) {
-		pgrad = (edge->potentialDelta / plen);
+		pgrad = (potentialDelta / plen);
 	}
 
 	return pgrad;
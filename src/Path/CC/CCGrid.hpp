@@ -4,13 +4,28 @@
 #include <vector>
 #include <map>
 #include <set>
-#include <queue>
 #include <list>
+#include <limits>
+#include <algorithm>
 
+#include "./CCBucketQueue.hpp"
 #include "../../Math/vec3fwd.hpp"
 #include "../../Math/vec3.hpp"
+#include "../../Math/FastMath.hpp"
+
+// whether the velocity-field that is kept for every group
+// between its updates is stored at half precision (halves
+// its size again, but objects then follow a quantized field)
+#define GROUP_VELOCITY_FIELD_HALF_PRECISION 0
+
+// debug: whether every FMM solve records the cache-lines of
+// cell- and edge-state it accesses, and prints the number of
+// bytes these amount to per settled cell when it finishes
+#define FMM_TRACE_TOUCHED_BYTES 0
 
 class ICallOutHandler;
+class SimObjectDef;
+class WorkerPool;
 class CCGrid {
 public:
 	enum {
@@ -46,87 +61,219 @@ public:
 		NUM_VECTOR_DATATYPES     = 5,
 	};
 	enum {
-		UPDATE_MODE_ALLATONCE = 0,
-		UPDATE_MODE_STAGGERED = 1,  // TODO
-	};
-
-	struct Cell {
-		struct Edge {
-			vec3f velocity;
-			vec3f heightDelta;
-			vec3f potentialDelta;
-		};
-
-		Cell(): x(0), y(0), tmpID(0), known(false), candidate(false), numNeighbors(0) {
-			edges[DIR_N] = 0; neighbors[DIR_N] = 0;
-			edges[DIR_E] = 0; neighbors[DIR_E] = 0;
-			edges[DIR_S] = 0; neighbors[DIR_S] = 0;
-			edges[DIR_W] = 0; neighbors[DIR_W] = 0;
-		}
+		UPDATE_MODE_ALLATONCE = 0, // every group is solved on each update frame
+		UPDATE_MODE_STAGGERED = 1, // solves are spread over frames, see UpdateGroupPotentialFieldsStaggered
+	};
+	enum {
+		FMM_QUEUE_HEAP   = 0, // exact binary heap, O(log n) per candidate
+		FMM_QUEUE_UNTIDY = 1, // bucketed queue, O(1) per candidate but not exact
+	};
+	enum {
+		SOLVER_FMM = 0, // fast marching, settles every cell once in order of potential
+		SOLVER_FSM = 1, // fast sweeping, repeated Gauss-Seidel passes in four orderings
+	};
 
-		Cell(unsigned int _x, unsigned int _y): x(_x), y(_y), tmpID(0), known(false), candidate(false), numNeighbors(0) {
-			edges[DIR_N] = 0; neighbors[DIR_N] = 0;
-			edges[DIR_E] = 0; neighbors[DIR_E] = 0;
-			edges[DIR_S] = 0; neighbors[DIR_S] = 0;
-			edges[DIR_W] = 0; neighbors[DIR_W] = 0;
-		}
+	// rectangle of cells (bounds inclusive) that a solve is confined to
+	struct Window {
+		Window(): x0(0), z0(0), x1(0), z1(0) {}
+		Window(unsigned int _x0, unsigned int _z0, unsigned int _x1, unsigned int _z1): x0(_x0), z0(_z0), x1(_x1), z1(_z1) {}
+
+		bool operator == (const Window& w) const { return (x0 == w.x0 && z0 == w.z0 && x1 == w.x1 && z1 == w.z1); }
+		bool operator != (const Window& w) const { return !((*this) == w); }
+
+		bool Contains(unsigned int x, unsigned int z) const { return (x >= x0 && x <= x1 && z >= z0 && z <= z1); }
+		unsigned int GetNumCells() const { return ((x1 - x0 + 1) * (z1 - z0 + 1)); }
+
+		unsigned int x0, z0;
+		unsigned int x1, z1;
+	};
 
-		// for less() (NOTE: candidates are sorted in increasing order)
-		bool operator() (const Cell* a, const Cell* b) const {
-			return (a->potential > b->potential);
+	// cells with a fixed initial potential (in addition to the goals)
+	typedef std::vector< std::pair<unsigned int, float> > SeedList;
+
+	// groups whose members share the same speed limits and sample
+	// the global fields at the same offset (CELLS_IN_RADIUS(r) + 1)
+	// have the same speeds and costs wherever the sampled cells are
+	// empty (no density, avg. velocity or mobile discomfort)
+	struct SpeedClass {
+		SpeedClass(): minSpeed(0.0f), maxSpeed(0.0f), sampleOffset(0) {}
+
+		bool operator < (const SpeedClass& c) const {
+			if (minSpeed != c.minSpeed) { return (minSpeed < c.minSpeed); }
+			if (maxSpeed != c.maxSpeed) { return (maxSpeed < c.maxSpeed); }
+			return (sampleOffset < c.sampleOffset);
 		}
 
-		void ResetFull();
-		void ResetGlobalStaticVars();
-		void ResetGlobalDynamicVars();
-		void ResetGroupVars();
+		float minSpeed;
+		float maxSpeed;
+		unsigned int sampleOffset;
+	};
+
+	// the speeds and costs (NUM_DIRS per cell) of one speed-class
+	// over empty cells, which only depend on the terrain
+	struct StaticSpeedCostField {
+		std::vector<float> speeds;
+		std::vector<float> costs;
+	};
 
-		vec3f GetNormalisedPotentialGradient(const std::vector<Edge>&, unsigned int) const;
-		vec3f avgVelocity;
-		vec3f staticDiscomfort;
-		vec3f mobileDiscomfort;
+	// the velocity of one edge as kept between the updates
+	// of a group; the y-component of the velocity-field is
+	// always zero, so only x and z are stored
+	struct EdgeVelocity {
+		#if (GROUP_VELOCITY_FIELD_HALF_PRECISION == 1)
+		EdgeVelocity(): x(0), z(0) {}
 
-		unsigned int x, y;
-		unsigned int tmpID;
+		void Set(const vec3f& v) { x = fastmath::float_to_half(v.x); z = fastmath::float_to_half(v.z); }
+		vec3f Get() const { return vec3f(fastmath::half_to_float(x), 0.0f, fastmath::half_to_float(z)); }
 
-		bool  known;
-		bool  candidate;
-		float potential;
-		float density;
-		float height;
+		unsigned short x;
+		unsigned short z;
+		#else
+		EdgeVelocity(): x(0.0f), z(0.0f) {}
 
-		// NOTE:
-		//    redundant, f(A --> B) is the same as f(B --> A) but
-		//    now stored twice (A.speed[DIR_N] and B.speed[DIR_S])
-		float speed[NUM_DIRS];
-		float cost[NUM_DIRS];
+		void Set(const vec3f& v) { x = v.x; z = v.z; }
+		vec3f Get() const { return vec3f(x, 0.0f, z); }
+
+		float x;
+		float z;
+		#endif
+	};
+
+	// the per-group fields that only exist during a solve, kept
+	// for the groups whose visualisation data was last requested
+	struct GroupVisCapture {
+		GroupVisCapture(): lastRequest(0) {}
+
+		std::vector<float> speeds;
+		std::vector<float> costs;
+		std::vector<vec3f> potentialDeltas;
+
+		unsigned int lastRequest;
+	};
 
-		unsigned int edges[NUM_DIRS];
-		unsigned int neighbors[NUM_DIRS];
-		unsigned int numNeighbors;
+	// a group whose fields need to be (re)computed
+	struct GroupUpdate {
+		GroupUpdate(unsigned int id, const std::set<unsigned int>* gIDs, const std::set<unsigned int>* oIDs):
+			groupID(id), goalIDs(gIDs), objectIDs(oIDs), window(NULL), seeds(NULL), staticCosts(NULL),
+			potentials(NULL), edgeVelocities(NULL), settledCells(NULL), visCapture(NULL), maxPotentialError(0.0f), meanPotentialError(0.0f) {}
+
+		unsigned int groupID;
+
+		const std::set<unsigned int>* goalIDs;
+		const std::set<unsigned int>* objectIDs;
+
+		// if set, the (FMM) solve only covers the cells inside
+		// <window> and starts from <seeds> as well as the goals
+		// (which must then all lie inside the window)
+		const Window* window;
+		const SeedList* seeds;
+
+		// the static speeds and costs of the group's speed-class
+		// (assigned by the grid when the update is handed to it,
+		// NULL if every cost is computed from scratch)
+		const StaticSpeedCostField* staticCosts;
+
+		// the persistent arrays of the group that the solve writes
+		// (also assigned by the grid, before any worker runs), the
+		// capture is NULL unless the group is being visualised
+		std::vector<float>* potentials;
+		std::vector<EdgeVelocity>* edgeVelocities;
+		std::vector<unsigned int>* settledCells;
+		GroupVisCapture* visCapture;
+
+		// only set if the untidy queue or FSM is being error-checked
+		float maxPotentialError;
+		float meanPotentialError;
 	};
 
-	CCGrid(): numCellsX(0), numCellsZ(0), mSquareSize(0), mDownScale(0), mUpdateInt(1), mUpdateMode(UPDATE_MODE_ALLATONCE) {
+	struct ObjectData {
+		ObjectData(): minRadius(0.0f), maxRadius(0.0f), numDiscomfortSteps(0), discomfortStepSize(0.0f), addDensity(false), addDiscomfort(false) {}
+
+		vec3f pos;
+		vec3f vel;
+
+		float minRadius;
+		float maxRadius;
+
+		// predicted path for the discomfort, see AddDiscomfort()
+		unsigned int numDiscomfortSteps;
+		float discomfortStepSize;
+
+		bool addDensity;
+		bool addDiscomfort;
+	};
+
+	// the limits of a SimObjectDef that the advection needs,
+	// with the turning-rate as the cosine and sine of the
+	// maximum angle (in degrees) an object turns per frame
+	struct AdvectionLimits {
+		AdvectionLimits(): maxForwardSpeed(0.0f), maxAccelerationRate(0.0f), maxDeccelerationRate(0.0f), maxTurningRateCos(1.0f), maxTurningRateSin(0.0f) {}
+
+		float maxForwardSpeed;
+		float maxAccelerationRate;
+		float maxDeccelerationRate;
+		float maxTurningRateCos;
+		float maxTurningRateSin;
+	};
+
+	// per-object input and output of UpdateSimObjectLocations,
+	// as one array per field (the limits of every object's def
+	// are copied in by Push, so the advection touches no defs)
+	struct AdvectionArrays {
+		void Clear();
+		void Push(unsigned int, unsigned int, const vec3f&, const vec3f&, float, const AdvectionLimits&);
+
+		unsigned int GetSize() const { return objectIDs.size(); }
+
+		std::vector<unsigned int> objectIDs;
+		std::vector<unsigned int> cellIndices;
+
+		std::vector<vec3f> positions;
+		std::vector<vec3f> directions;
+		std::vector<float> speeds;
+
+		std::vector<float> maxForwardSpeeds;
+		std::vector<float> maxAccelerationRates;
+		std::vector<float> maxDeccelerationRates;
+		std::vector<float> maxTurningRateCos;
+		std::vector<float> maxTurningRateSin;
+
+		// the states the objects should be moved into
+		// (only valid where the velocity-field is non-
+		// zero at an object's position, see <moved>)
+		std::vector<vec3f> wantedPositions;
+		std::vector<vec3f> wantedDirections;
+		std::vector<float> wantedSpeeds;
+		std::vector<unsigned char> moved;
+	};
+
+	CCGrid(): numCellsX(0), numCellsZ(0), mSquareSize(0), mDownScale(0), mUpdateInt(1), mUpdateMode(UPDATE_MODE_ALLATONCE),
+		mSolver(SOLVER_FMM), mFMMQueueMode(FMM_QUEUE_HEAP), mFMMBucketWidth(0.0f), mFMMCheckError(false), mMaxPotentialError(0.0f),
+		mFMMEarlyExit(false), mFMMEarlyExitMargin(0), mFMMHeuristic(false), mNumLandmarks(0),
+		mLazyVelocities(false), mLazyVelocityMargin(0),
+		mFSMMaxIterations(0), mUpdateBudget(0), mWorkerPool(NULL), mNumVisCaptureRequests(0) {
 		mDirVectors[DIR_N] = -ZVECf;  mDirDeltas[DIR_N].x =  0; mDirDeltas[DIR_N].z = -1;
 		mDirVectors[DIR_S] =  ZVECf;  mDirDeltas[DIR_S].x =  0; mDirDeltas[DIR_S].z =  1;
 		mDirVectors[DIR_E] =  XVECf;  mDirDeltas[DIR_E].x =  1; mDirDeltas[DIR_E].z =  0;
 		mDirVectors[DIR_W] = -XVECf;  mDirDeltas[DIR_W].x = -1; mDirDeltas[DIR_W].z =  0;
-
-		mCurrBufferIdx = 0;
-		mPrevBufferIdx = 1;
 	}
 
 	void Init(unsigned int, ICallOutHandler*);
 	void Kill();
 	void Reset();
 
-	void AddGlobalDynamicCellData(std::vector<Cell>&, std::vector<Cell>&, const Cell*, int, int, const vec3f&, unsigned int, unsigned int);
-	void AddDensity(const vec3f&, const vec3f&, float, float);
-	void AddDiscomfort(const vec3f&, const vec3f&, float, float, unsigned int, float);
+	// splats the density and (predictive) discomfort of every
+	// object onto the grid, in parallel over bands of rows
+	void AddObjects(const std::vector<ObjectData>&);
 	void ComputeAvgVelocity();
 
-	void UpdateGroupPotentialField(unsigned int, const std::set<unsigned int>&, const std::set<unsigned int>&);
-	bool UpdateSimObjectLocation(unsigned int, unsigned int, unsigned int);
+	void UpdateGroupPotentialFields(std::vector<GroupUpdate>&);
+	void UpdateGroupPotentialFieldsStaggered(std::vector<GroupUpdate>&, bool);
+
+	// computes the next physical state of every object of a
+	// group in one pass over <objects>; the caller gathers the
+	// current states beforehand and applies the new ones after
+	void UpdateSimObjectLocations(unsigned int, AdvectionArrays&) const;
 
 	void AddGroup(unsigned int);
 	void DelGroup(unsigned int);
@@ -134,28 +281,42 @@ public:
 	// visualisation data accessors for scalar fields
 	const float* GetDensityVisDataArray() const;
 	const float* GetHeightVisDataArray() const;
-	const float* GetSpeedVisDataArray(unsigned int) const;
-	const float* GetCostVisDataArray(unsigned int) const;
-	const float* GetPotentialVisDataArray(unsigned int) const;
+	const float* GetSpeedVisDataArray(unsigned int);
+	const float* GetCostVisDataArray(unsigned int);
+	const float* GetPotentialVisDataArray(unsigned int);
 
 	// visualisation data accessors for vector fields
 	const vec3f* GetDiscomfortVisDataArray() const;
 	const vec3f* GetHeightDeltaVisDataArray() const;
 	const vec3f* GetVelocityAvgVisDataArray() const;
-	const vec3f* GetVelocityVisDataArray(unsigned int) const;
-	const vec3f* GetPotentialDeltaVisDataArray(unsigned int) const;
+	const vec3f* GetVelocityVisDataArray(unsigned int);
+	const vec3f* GetPotentialDeltaVisDataArray(unsigned int);
 
-	const Cell* GetCell(unsigned int idx, unsigned int buf = 0) const { return &mGridStates[buf].cells[idx]; }
 	unsigned int GetCellIndex1D(const vec3f&) const;
 	vec3i GetCellIndex2D(const vec3f&) const;
-	vec3f GetCellMidPos(const Cell*) const;
-	vec3f GetCellCornerPos(const Cell*) const;
+	vec3f GetCellMidPos(unsigned int) const;
+	vec3f GetCellCornerPos(unsigned int) const;
+
+	float GetGroupPotential(unsigned int, const vec3f&) const;
 
 	unsigned int GetGridWidth() const { return numCellsX; }
 	unsigned int GetGridHeight() const { return numCellsZ; }
 	unsigned int GetSquareSize() const { return mSquareSize; }
 	unsigned int GetUpdateInterval() const { return mUpdateInt; }
 	unsigned int GetUpdateMode() const { return mUpdateMode; }
+	unsigned int GetSolver() const { return mSolver; }
+	unsigned int GetFMMQueueMode() const { return mFMMQueueMode; }
+	unsigned int GetNumWorkers() const;
+
+	// largest |phi_untidy - phi_heap| over all cells in the last
+	// update, only measured when the "fmmCheckError" option is set
+	float GetMaxPotentialError() const { return mMaxPotentialError; }
+
+	// true if every field is also solved with the exact (heap-based)
+	// FMM in order to measure the error of the configured solver
+	bool IsCheckingPotentialError() const {
+		return (mFMMCheckError && (mSolver == SOLVER_FSM || mFMMQueueMode == FMM_QUEUE_UNTIDY));
+	}
 
 private:
 	float mRhoMin;
@@ -172,66 +333,409 @@ private:
 	unsigned int mUpdateInt;
 	unsigned int mUpdateMode;
 
-	float mMinGroupSlope, mMinTerrainSlope; // ?, sMin (not normalised)
-	float mMaxGroupSlope, mMaxTerrainSlope; // ?, sMax (not normalised)
-	float mMinGroupSpeed;                   // fMin
-	float mMaxGroupSpeed;                   // fMax
-	float mMaxGroupRadius;
+	// which solver computes the potential fields (SOLVER_*)
+	unsigned int mSolver;
 
-	bool mFlatTerrain;
+	// which candidate queue the FMM uses (FMM_QUEUE_*)
+	unsigned int mFMMQueueMode;
+	float mFMMBucketWidth;
+	bool mFMMCheckError;
+	float mMaxPotentialError;
+
+	// whether an FMM solve stops as soon as every cell within
+	// <mFMMEarlyExitMargin> cells of a group member is settled
+	bool mFMMEarlyExit;
+	unsigned int mFMMEarlyExitMargin;
+
+	// whether early-terminated FMM solves settle their candidates
+	// in order of potential plus a lower bound on the remaining
+	// potential to the group (A*-style), and the number of terrain
+	// landmarks that bound is derived from
+	bool mFMMHeuristic;
+	unsigned int mNumLandmarks;
+
+	// whether FMM solves leave the velocity-fields alone and only
+	// the cells within <mLazyVelocityMargin> cells of each member
+	// get velocities once a solve is finished
+	bool mLazyVelocities;
+	unsigned int mLazyVelocityMargin;
 
-	// used by UpdateGroupPotentialField() to
-	// validate potential-field construction
-	unsigned int numInfinitePotentialCases;
-	unsigned int numIllegalDirectionCases;
+	// upper bound on the number of FSM iterations (of
+	// four sweeps each) if the field does not converge
+	unsigned int mFSMMaxIterations;
 
-	// FMM vars
-	std::priority_queue<Cell*, std::vector<Cell*, std::allocator<Cell*> >, Cell> mCandidates;
+	// UPDATE_MODE_STAGGERED: the number of cells every
+	// worker may settle (solving fields) per frame
+	unsigned int mUpdateBudget;
+
+	float mMinTerrainSlope; // sMin (not normalised)
+	float mMaxTerrainSlope; // sMax (not normalised)
+
+	bool mFlatTerrain;
 
 	// visualization data for scalar fields
 	std::vector<float> mDensityVisData;
 	std::vector<float> mHeightVisData;
-	std::map<unsigned int, std::vector<float> > mSpeedVisData;
-	std::map<unsigned int, std::vector<float> > mCostVisData;
-	std::map<unsigned int, std::vector<float> > mPotentialVisData;
+	std::vector<float> mPotentialVisData;
 
 	// visualization data for vector fields
 	std::vector<vec3f> mDiscomfortVisData;
 	std::vector<vec3f> mHeightDeltaVisData;
 	std::vector<vec3f> mAvgVelocityVisData;
-	std::map<unsigned int, std::vector<vec3f> > mVelocityVisData;
-	std::map<unsigned int, std::vector<vec3f> > mPotentialDeltaVisData;
+	std::vector<vec3f> mVelocityVisData;
 
 	ICallOutHandler* mCOH;
 
 
 	// cells that were modified by the AddDensityAndVelocity step
-	// (which sets the Cell::avgVelocity and Cell::density dynamic
-	// globals)
-	std::set<unsigned int> mTouchedCells;
+	// (which sets the mAvgVelocities and mDensities dynamic globals)
+	// the flags make insertion O(1) and duplicate-free, the list
+	// holds every flagged index once in order of first touch
+	std::vector<unsigned char> mTouchedCellFlags;
+	std::vector<unsigned int> mTouchedCells;
+
+	// per-row half-widths of the discs projected by objects onto
+	// the grid, for every radius (in cells) seen so far
+	std::vector<int> mDiscSpans;
+
+	// per-row extents of the union of discs covering the
+	// predicted path of one object (see AddDiscomfort())
+	struct DiscomfortStamp {
+		void Init(unsigned int numRows) {
+			minX.clear(); minX.resize(numRows, std::numeric_limits<int>::max());
+			maxX.clear(); maxX.resize(numRows, std::numeric_limits<int>::min());
+
+			minZ = std::numeric_limits<int>::max();
+			maxZ = std::numeric_limits<int>::min();
+		}
+
+		std::vector<int> minX;
+		std::vector<int> maxX;
 
-	// these buffers are cycled after processing a group; during
-	// UpdateGroupPotentialField, one buffer is made dirty (wrt.
-	// the per-group dynamic data) while the other is cleaned
+		int minZ;
+		int maxZ;
+	};
+
+	// a band of grid rows [minZ, maxZ] that AddObjects() splats
+	// every object into; bands never share cells, so they can be
+	// filled concurrently
+	struct SplatBand {
+		SplatBand(): minZ(0), maxZ(-1) {}
+
+		int minZ;
+		int maxZ;
+
+		// cells first touched by this band during the current
+		// AddObjects() call (appended to mTouchedCells after)
+		std::vector<unsigned int> touchedCells;
+
+		DiscomfortStamp discomfortStamp;
+	};
+
+	std::vector<SplatBand> mSplatBands;
+
+	// tmp-ID of the next moving object's discomfort stamp
+	unsigned int mDiscomfortTmpID;
+
+	// global (group-independent) cell fields, shared by all workspaces
+	// NOTE:
+	//    these are only written by Reset(), AddObjects() and
+	//    ComputeAvgVelocity(), so they are read-only while the group
+	//    fields are being solved
+	std::vector<float> mDensities;
+	std::vector<float> mHeights;
+	std::vector<vec3f> mAvgVelocities;
+	std::vector<vec3f> mStaticDiscomforts;
+	std::vector<vec3f> mMobileDiscomforts;
+	std::vector<unsigned int> mTmpIDs;
+	std::vector<vec3f> mHeightDeltas; // per edge
+
+	// one static speed- and cost-field per speed-class seen so far
+	// (created by the main thread before any group is solved, so the
+	// workers only read them)
+	std::map<SpeedClass, StaticSpeedCostField> mStaticSpeedCostFields;
+
+	// per landmark, the lower bound on the summed static discomfort
+	// along any path from the landmark to every cell (numCells floats
+	// per landmark, see ComputeLandmarkDistances())
+	std::vector<float> mLandmarkDistances;
+
+	enum {
+		CELL_KNOWN     = 1,
+		CELL_CANDIDATE = 2,
+		CELL_TARGET    = 4, // must be settled before the solve may stop early
+		CELL_SOURCE    = 8, // goal- or seed-cell (known without being settled)
+		CELL_VELOCITY  = 16, // velocities derived by StoreMemberVelocities()
+	};
+	enum {
+		NO_CELL  = 0xFFFFFFFFU,
+		NO_GROUP = 0xFFFFFFFFU,
+	};
+
+	// per-group cell state, one array per field; a cell is
+	// only identified by its index (the indices of its edges
+	// and neighbors follow from it, see GetEdgeIndex)
+	//
+	// every solve starts a new epoch instead of clearing the
+	// buffer: a cell (or edge) whose stamp differs from <epoch>
+	// counts as reset, and is actually reset when a solve first
+	// visits it, so a solve only costs O(cells it visits)
 	struct Buffer {
-		Buffer() {}
-		Buffer(unsigned int ncx, unsigned int ncz) {
-			cells.resize(ncx * ncz);
-			edges.resize((ncx + 1) * ncz + (ncz + 1) * ncx);
+		Buffer(): epoch(0) {}
+
+		void Resize(unsigned int numCells, unsigned int numEdges) {
+			potentials.resize(numCells, std::numeric_limits<float>::infinity());
+			speeds.resize(numCells * NUM_DIRS, 0.0f);
+			costs.resize(numCells * NUM_DIRS, 0.0f);
+			states.resize(numCells, 0);
+			cellEpochs.resize(numCells, epoch);
+			potentialDeltas.resize(numEdges, NVECf);
+			edgeEpochs.resize(numEdges, epoch);
+		}
+
+		void NextEpoch() {
+			if ((++epoch) == 0) {
+				// the stamps wrapped around, make them all stale
+				std::fill(cellEpochs.begin(), cellEpochs.end(), 0);
+				std::fill(edgeEpochs.begin(), edgeEpochs.end(), 0);
+				epoch = 1;
+			}
+		}
+
+		// resets <idx> if it was not yet visited in this epoch
+		void TouchCell(unsigned int idx) {
+			if (cellEpochs[idx] != epoch) {
+				cellEpochs[idx] = epoch;
+				ResetCell(idx);
+			}
+		}
+		// resets every cell and edge (for solves that visit all of them)
+		void TouchAll() {
+			for (unsigned int idx = 0; idx < potentials.size(); idx++) {
+				ResetCell(idx);
+			}
+
+			std::fill(cellEpochs.begin(), cellEpochs.end(), epoch);
+			std::fill(potentialDeltas.begin(), potentialDeltas.end(), NVECf);
+			std::fill(edgeEpochs.begin(), edgeEpochs.end(), epoch);
+		}
+
+		void ResetCell(unsigned int idx) {
+			potentials[idx] = std::numeric_limits<float>::infinity();
+			states[idx] = 0;
+
+			speeds[idx * NUM_DIRS + DIR_N] = costs[idx * NUM_DIRS + DIR_N] = 0.0f;
+			speeds[idx * NUM_DIRS + DIR_S] = costs[idx * NUM_DIRS + DIR_S] = 0.0f;
+			speeds[idx * NUM_DIRS + DIR_E] = costs[idx * NUM_DIRS + DIR_E] = 0.0f;
+			speeds[idx * NUM_DIRS + DIR_W] = costs[idx * NUM_DIRS + DIR_W] = 0.0f;
+		}
+
+		bool IsCurrentCell(unsigned int idx) const { return (cellEpochs[idx] == epoch); }
+		float GetPotential(unsigned int idx) const {
+			return (IsCurrentCell(idx)? potentials[idx]: std::numeric_limits<float>::infinity());
+		}
+
+		void SetPotentialDelta(unsigned int edgeIdx, const vec3f& delta) {
+			potentialDeltas[edgeIdx] = delta;
+			edgeEpochs[edgeIdx] = epoch;
 		}
-		~Buffer() {
-			cells.clear();
-			edges.clear();
+		vec3f GetPotentialDelta(unsigned int edgeIdx) const {
+			return ((edgeEpochs[edgeIdx] == epoch)? potentialDeltas[edgeIdx]: NVECf);
 		}
-		std::vector<Cell      > cells;
-		std::vector<Cell::Edge> edges;
+
+		// number of bytes of solver state per cell and per edge
+		static unsigned int GetCellSize() { return (sizeof(float) * (1 + NUM_DIRS * 2) + sizeof(unsigned char) + sizeof(unsigned int)); }
+		static unsigned int GetEdgeSize() { return (sizeof(vec3f) + sizeof(unsigned int)); }
+
+		// NOTE: the fields of a cell are only valid if its stamp matches
+		std::vector<float> potentials;
+		std::vector<float> speeds;         // NUM_DIRS per cell
+		std::vector<float> costs;          // NUM_DIRS per cell
+		std::vector<unsigned char> states; // CELL_* flags
+		std::vector<unsigned int> cellEpochs;
+
+		std::vector<vec3f> potentialDeltas; // per edge
+		std::vector<unsigned int> edgeEpochs;
+
+		unsigned int epoch;
+	};
+
+	// for the candidate heap (NOTE: candidates are sorted in increasing order)
+	struct CellPotentialCmp {
+		CellPotentialCmp(const float* p): potentials(p) {}
+		bool operator() (unsigned int a, unsigned int b) const {
+			return (potentials[a] > potentials[b]);
+		}
+
+		const float* potentials;
+	};
+
+	// everything a worker needs to solve the fields of one group
+	// (every solve leaves the buffer it cycles to completely clean,
+	// so the outcome does not depend on which groups a workspace
+	// has solved before)
+	struct Workspace {
+		Workspace():
+			queueMode(FMM_QUEUE_HEAP),
+			minGroupSlope(0.0f),
+			maxGroupSlope(0.0f),
+			minGroupSpeed(0.0f),
+			maxGroupSpeed(0.0f),
+			maxGroupRadius(0.0f),
+			staticCosts(NULL),
+			potentials(NULL),
+			edgeVelocities(NULL),
+			groupSettledCells(NULL),
+			visCapture(NULL),
+			seeds(NULL),
+			objectIDs(NULL),
+			earlyExit(false),
+			numTargetCells(0),
+			numSettledCells(0),
+			heuristic(false),
+			heuristicHopCost(0.0f),
+			heuristicDiscomfortCost(0.0f),
+			solveGroupID(NO_GROUP),
+			numStartedUpdates(0),
+			numInfinitePotentialCases(0),
+			numIllegalDirectionCases(0) {
+		}
+
+		Buffer buffer;
+
+		// FMM vars (<candidates> is a binary heap ordered by
+		// CellPotentialCmp, <queueMode> is the queue the current
+		// solve is running with, which differs from mFMMQueueMode
+		// when the untidy queue is being error-checked)
+		std::vector<unsigned int> candidates;
+		CCBucketQueue<unsigned int> bucketCandidates;
+		unsigned int queueMode;
+
+		float minGroupSlope;  // ?
+		float maxGroupSlope;  // ?
+		float minGroupSpeed;  // fMin
+		float maxGroupSpeed;  // fMax
+		float maxGroupRadius;
+
+		// speeds and costs over empty cells of the group being solved
+		const StaticSpeedCostField* staticCosts;
+
+		// output arrays of the group being solved
+		std::vector<float>* potentials;
+		std::vector<EdgeVelocity>* edgeVelocities;
+		std::vector<unsigned int>* groupSettledCells;
+		GroupVisCapture* visCapture;
+
+		// the cells the current solve is confined to (the whole grid
+		// unless the group is solved in a window) and its extra sources
+		Window window;
+		const SeedList* seeds;
+
+		// the members of the group(s) being solved
+		const std::set<unsigned int>* objectIDs;
+
+		// early termination: whether the current solve may stop
+		// before its candidates run out, how many of its target-
+		// cells are not settled yet and which cells it settled
+		bool earlyExit;
+		unsigned int numTargetCells;
+		std::vector<unsigned int> settledCells;
+
+		// the number of cells the current solve has settled and (for
+		// lazy velocity-fields) the order in which it settled them,
+		// only valid for the cells it settled
+		unsigned int numSettledCells;
+		std::vector<unsigned int> settleOrders;
+
+		// heuristic ordering: whether the current solve uses it, the
+		// lower bounds on the cost of a step and on the cost per unit
+		// of static discomfort, the bounding box of the members' cells,
+		// the [min, max] landmark distance over the members' cells per
+		// landmark and the key (potential plus bound) of every candidate
+		bool heuristic;
+		float heuristicHopCost;
+		float heuristicDiscomfortCost;
+		Window memberWindow;
+		std::vector<float> landmarkBounds;
+		std::vector<float> candidateKeys;
+
+		// exact (heap) potentials, used to measure the untidy queue's error
+		std::vector<float> exactPotentials;
+
+		// FSM scratch rows (one entry per column): the potential and
+		// edge cost of the cheaper vertical neighbor of every cell
+		std::vector<float> sweepPotentialsY;
+		std::vector<float> sweepCostsY;
+
+		// staggered updates: the group whose FMM solve is paused in
+		// this workspace (NO_GROUP if none), the groups to start once
+		// it has finished, how many of those were started and which
+		// groups were finished during the last frame
+		unsigned int solveGroupID;
+		std::vector<GroupUpdate> scheduledUpdates;
+		unsigned int numStartedUpdates;
+		std::vector<unsigned int> finishedGroupIDs;
+
+		// used by SolveGroupPotentialField() to
+		// validate potential-field construction
+		unsigned int numInfinitePotentialCases;
+		unsigned int numIllegalDirectionCases;
+
+		#if (FMM_TRACE_TOUCHED_BYTES == 1)
+		// the (64-byte) cache-lines the current solve has accessed
+		// (the queue itself is not traced)
+		void TraceTouch(const void* p, unsigned int size) {
+			const size_t line0 = (reinterpret_cast<size_t>(p)           ) >> 6;
+			const size_t line1 = (reinterpret_cast<size_t>(p) + size - 1) >> 6;
+
+			for (size_t line = line0; line <= line1; line++) {
+				tracedLines.insert(line);
+			}
+		}
+
+		std::set<size_t> tracedLines;
+		#endif
+	};
+
+	std::vector<Workspace> mWorkspaces;
+	WorkerPool* mWorkerPool;
+
+	// the velocity-field of each group (per edge), read
+	// by UpdateSimObjectLocations during every sim-frame
+	std::map<unsigned int, std::vector<EdgeVelocity> > mGroupEdgeVelocities;
+
+	// the potential-field of each group (infinite for unreached
+	// cells), stored whenever one of its solves has finished
+	std::map<unsigned int, std::vector<float> > mGroupPotentials;
+
+	// the captures by group, created and evicted (before the
+	// next solve phase) according to the requests made by the
+	// accessors since the previous one
+	std::map<unsigned int, GroupVisCapture> mGroupVisCaptures;
+	std::map<unsigned int, unsigned int> mVisCaptureRequests;
+	unsigned int mNumVisCaptureRequests;
+
+	// the cells settled by the last early-terminated solve of
+	// each group, whose velocities a later solve that stops at
+	// a different point has to clear (with lazy velocity-fields,
+	// the cells whose velocities the last solve derived)
+	std::map<unsigned int, std::vector<unsigned int> > mGroupSettledCells;
+
+	// staggered-mode bookkeeping of one group
+	struct GroupSchedule {
+		GroupSchedule(): age(0), solved(false), stale(true) {}
+
+		unsigned int age; // frames since its last solve finished (or since it was added)
+		bool solved;      // false until its first solve has finished
+		bool stale;       // true if the global fields changed after its last solve started
 	};
-	Buffer mGridStates[2];
 
-	unsigned int mCurrBufferIdx;
-	unsigned int mPrevBufferIdx;
+	std::map<unsigned int, GroupSchedule> mGroupSchedules;
 
-	std::map<unsigned int, Buffer> mGroupGridStates;
+	friend struct GroupSolveJob;
+	friend struct StaggeredSolveJob;
+	friend struct SplatJob;
+	friend struct AvgVelocityJob;
 
 
 	// grid-space directions corresponding to NSEW
@@ -239,15 +743,80 @@ private:
 	// world-space directions corresponding to NSEW
 	vec3f mDirVectors[NUM_DIRS];
 
-	vec3f GetInterpolatedVelocity(const std::vector<Cell::Edge>&, const Cell*, const vec3f&, const vec3f&) const;
+	// the W and E edges of cell <x, y> are vertical edges number
+	// y * (numCellsX + 1) + x (+ 1), the N and S edges are stored
+	// after all vertical ones as (y (+ 1)) * numCellsX + x
+	unsigned int GetEdgeIndex(unsigned int x, unsigned int y, unsigned int dir) const {
+		switch (dir) {
+			case DIR_N: { return (((numCellsX + 1) * numCellsZ) + ((y    ) * numCellsX) + x); } break;
+			case DIR_S: { return (((numCellsX + 1) * numCellsZ) + ((y + 1) * numCellsX) + x); } break;
+			case DIR_E: { return ((y * (numCellsX + 1)) + x + 1); } break;
+			case DIR_W: { return ((y * (numCellsX + 1)) + x    ); } break;
+		}
+
+		return 0;
+	}
+
+	void GetCellEdgeIndices(unsigned int, unsigned int*) const;
+
+	Window GetFullWindow() const { return Window(0, 0, numCellsX - 1, numCellsZ - 1); }
 
-	void ComputeCellSpeed(unsigned int, unsigned int, std::vector<Cell>&, std::vector<Cell::Edge>&);
-	void ComputeCellCost(unsigned int, unsigned int, std::vector<Cell>&, std::vector<Cell::Edge>&);
-	void ComputeCellSpeedAndCost(unsigned int, unsigned int, std::vector<Cell>&, std::vector<Cell::Edge>&);
-	void ComputeCellSpeedAndCostMERGED(unsigned int, Cell*, std::vector<Cell>&, std::vector<Cell::Edge>&);
-	void ComputeSpeedAndCost(unsigned int);
+	void BuildDiscSpans(int);
+	const int* GetDiscSpans(int radius) const { return &mDiscSpans[radius * radius]; }
+
+	void AddObjectsToBand(SplatBand&, const std::vector<ObjectData>&, const std::vector<unsigned int>&);
+	void AddDensity(SplatBand&, const vec3f&, const vec3f&, float, float);
+	void AddDiscomfort(SplatBand&, const vec3f&, const vec3f&, float, unsigned int, float, unsigned int);
+	void AddGlobalDynamicCellData(SplatBand&, unsigned int, int, int, const vec3f&, unsigned int);
+	void AddDensitySpan(SplatBand&, unsigned int, int, int, float, const vec3f&);
+	void AddDiscToStamp(SplatBand&, int, int, int);
+	void FlushDiscomfortStamp(SplatBand&, const vec3f&, unsigned int);
+	void MarkTouchedCell(SplatBand& band, unsigned int idx) {
+		if (mTouchedCellFlags[idx] == 0) {
+			mTouchedCellFlags[idx] = 1;
+			band.touchedCells.push_back(idx);
+		}
+	}
 
-	void UpdateCandidates(unsigned int, const Cell*);
+	void ComputeAvgVelocity(unsigned int, unsigned int);
+
+	vec3f GetNormalisedPotentialGradient(const Buffer&, unsigned int) const;
+	vec3f GetInterpolatedVelocity(const std::vector<EdgeVelocity>&, unsigned int, const vec3f&, const vec3f&) const;
+
+	void ComputeCellSpeed(Workspace&, unsigned int, Buffer&);
+	void ComputeCellCost(Workspace&, unsigned int, Buffer&);
+	void ComputeCellSpeedAndCost(Workspace&, unsigned int, Buffer&, bool);
+	void SetStaticSpeedCostFields(std::vector<GroupUpdate>&);
+	void SetGroupOutputArrays(std::vector<GroupUpdate>&);
+	const StaticSpeedCostField* GetStaticSpeedCostField(const std::set<unsigned int>&);
+	void ComputeCellSpeedAndCostMERGED(Workspace&, unsigned int, Buffer&);
+	void ComputeSpeedAndCost(Workspace&);
+
+	void SetGroupWorkspace(Workspace&, const GroupUpdate&);
+	void UpdateGroupPotentialField(Workspace&, GroupUpdate&);
+	void RunScheduledSolves(Workspace&);
+	void SolveGroupPotentialField(Workspace&, const std::set<unsigned int>&, unsigned int);
+	void BeginGroupPotentialField(Workspace&, const std::set<unsigned int>&, unsigned int);
+	void AddSourceCell(Workspace&, unsigned int, float);
+	bool ContinueGroupPotentialField(Workspace&, unsigned int);
+	void AbortGroupPotentialField(Workspace&);
+	void StoreGroupFields(Workspace&);
+	void MarkTargetCells(Workspace&);
+	void ComputeLandmarkDistances();
+	void SetHeuristicBounds(Workspace&);
+	float GetHeuristicBound(const Workspace&, unsigned int) const;
+	void ClearUnsettledVelocities(Workspace&);
+	void StoreMemberVelocities(Workspace&);
+	const GroupVisCapture* GetGroupVisCapture(unsigned int);
+	void UpdateGroupVisCaptures();
+	void UpdateCandidates(Workspace&, unsigned int);
+	void SolveGroupPotentialFieldFSM(Workspace&, const std::set<unsigned int>&);
+	unsigned int SweepRow(Workspace&, unsigned int, bool);
+	void ComputeCellPotentialDeltas(Buffer&, unsigned int);
+	void PushCandidate(Workspace&, unsigned int);
+	void PopCandidate(Workspace&);
+	unsigned int TopCandidate(Workspace&);
+	bool HaveCandidates(const Workspace&) const;
 	float Potential2D(const float, const float, const float, const float) const;
 	float Potential1D(const float, const float) const;
 };
@@ -1,8 +1,11 @@
 #include <iostream>
 #include <cstdio>
+#include <limits>
+#include <algorithm>
 
 #include "./CCPathModule.hpp"
 #include "../../Math/vec3.hpp"
+#include "../../Math/Trig.hpp"
 #include "../../Ext/ICallOutHandler.hpp"
 #include "../../Sim/SimObjectDef.hpp"
 #include "../../Sim/SimObjectState.hpp"
@@ -11,6 +14,10 @@
 #define CCPATHMODULE_PROFILE                      0
 #define GRID_UNIT_TEST                            0
 #define GRID_DOWNSCALE_FACTOR                     8
+#define GRID_FINE_DOWNSCALE_FACTOR                0
+#define GRID_FINE_WINDOW_MARGIN                   8
+#define GRID_FINE_WINDOW_MAX_SIZE               128
+#define GROUP_SHARED_FIELDS                       1
 #define SIMOBJECT_FORCE_INPLACE_TURNS             1
 #define SIMOBJECT_MIN_DISTANCE_ENFORCEMENT        1
 #define SIMOBJECT_PREDICTIVE_DISCOMFORT_FRAMES  150
@@ -120,41 +127,21 @@ void CCPathModule::OnEvent(const IEvent* e) {
 				coh->SetSimObjectPhysicsUpdates(objectID, false);
 
 				#if (SIMOBJECT_FORCE_INPLACE_TURNS == 1)
-				// force speed to 0 so that UpdateSimObjectLocation
+				// force speed to 0 so that UpdateSimObjectLocations
 				// can near-instantly change this object's direction
 				// whenever it receives a move order
 				coh->SetSimObjectRawSpeed(objectID, 0.0f);
 				#endif
 			}
 
-			mGrid.AddGroup(groupID);
+			AddGroupField(groupID);
 		} break;
 
 		case EVENT_SIMOBJECT_COLLISION: {
 			#if (SIMOBJECT_MIN_DISTANCE_ENFORCEMENT == 1)
 			const SimObjectCollisionEvent* ee = dynamic_cast<const SimObjectCollisionEvent*>(e);
 
-			const unsigned int colliderID = ee->GetColliderID();
-			const unsigned int collideeID = ee->GetCollideeID();
-
-			const vec3f& colliderPos = coh->GetSimObjectPosition(colliderID);
-			const vec3f& collideePos = coh->GetSimObjectPosition(collideeID);
-
-			const float colliderRadius = coh->GetSimObjectModelRadius(colliderID);
-			const float collideeRadius = coh->GetSimObjectModelRadius(collideeID);
-
-			const vec3f separationVec = colliderPos - collideePos;
-			const float separationMin = (colliderRadius + collideeRadius) * (colliderRadius + collideeRadius);
-
-			// enforce minimum distance between objects
-			if ((separationVec.sqLen3D() - separationMin) < 0.0f) {
-				const float dst = (separationVec.len3D());
-				const vec3f dir = (separationVec / dst);
-				const vec3f dif = (dir * (((colliderRadius + collideeRadius) - dst) * 0.5f));
-
-				coh->SetSimObjectRawPosition(colliderID, colliderPos + dif);
-				coh->SetSimObjectRawPosition(collideeID, collideePos - dif);
-			}
+			EnforceMinimumDistances(ee);
 			#endif
 		} break;
 
@@ -169,6 +156,10 @@ void CCPathModule::Init() {
 	printf("[CCPathModule::Init]\n");
 	printf("\tGRID_UNIT_TEST:                         %d\n", GRID_UNIT_TEST);
 	printf("\tGRID_DOWNSCALE_FACTOR:                  %d\n", GRID_DOWNSCALE_FACTOR);
+	printf("\tGRID_FINE_DOWNSCALE_FACTOR:             %d\n", GRID_FINE_DOWNSCALE_FACTOR);
+	printf("\tGRID_FINE_WINDOW_MARGIN:                %d\n", GRID_FINE_WINDOW_MARGIN);
+	printf("\tGRID_FINE_WINDOW_MAX_SIZE:              %d\n", GRID_FINE_WINDOW_MAX_SIZE);
+	printf("\tGROUP_SHARED_FIELDS:                    %d\n", GROUP_SHARED_FIELDS);
 	printf("\n");
 	printf("\tSIMOBJECT_FORCE_INPLACE_TURNS:          %d\n", SIMOBJECT_FORCE_INPLACE_TURNS);
 	printf("\tSIMOBJECT_MIN_DISTANCE_ENFORCEMENT:     %d\n", SIMOBJECT_MIN_DISTANCE_ENFORCEMENT);
@@ -183,6 +174,26 @@ void CCPathModule::Init() {
 	//     (alternative conversion schemes are allowed however)
 	mGrid.Init(GRID_DOWNSCALE_FACTOR, coh);
 
+	#if (GRID_FINE_DOWNSCALE_FACTOR > 0)
+	// every coarse cell must consist of a whole number of fine cells
+	PFFG_ASSERT((GRID_DOWNSCALE_FACTOR % GRID_FINE_DOWNSCALE_FACTOR) == 0);
+	mFineGrid.Init(GRID_FINE_DOWNSCALE_FACTOR, coh);
+	#endif
+
+	// the defs are loaded before the objects that use them
+	mAdvectionLimits.resize(coh->GetNumSimObjectDefs());
+
+	for (unsigned int defID = 0; defID < mAdvectionLimits.size(); defID++) {
+		const SimObjectDef* def = coh->GetRawSimObjectDef(defID);
+		CCGrid::AdvectionLimits& limits = mAdvectionLimits[defID];
+
+		limits.maxForwardSpeed      = def->GetMaxForwardSpeed();
+		limits.maxAccelerationRate  = def->GetMaxAccelerationRate();
+		limits.maxDeccelerationRate = def->GetMaxDeccelerationRate();
+		limits.maxTurningRateCos    = cosf(DEG2RAD(def->GetMaxTurningRate()));
+		limits.maxTurningRateSin    = sinf(DEG2RAD(def->GetMaxTurningRate()));
+	}
+
 	static const DataTypeInfo scalarData = DATATYPEINFO_CACHED; cachedScalarData = scalarData;
 	static const DataTypeInfo vectorData = DATATYPEINFO_CACHED; cachedVectorData = vectorData;
 }
@@ -214,8 +225,15 @@ void CCPathModule::Update() {
 void CCPathModule::Kill() {
 	printf("[CCPathModule::Kill]\n");
 
+	for (FieldMapIt it = mFields.begin(); it != mFields.end(); ++it) {
+		mGrid.DelGroup(it->first);
+
+		#if (GRID_FINE_DOWNSCALE_FACTOR > 0)
+		mFineGrid.DelGroup(it->first);
+		#endif
+	}
 	for (GroupMapIt it = mGroups.begin(); it != mGroups.end(); ++it) {
-		mGrid.DelGroup(it->first); delete it->second;
+		delete it->second;
 	}
 	for (ObjectMapIt it = mObjects.begin(); it != mObjects.end(); ++it) {
 		delete it->second;
@@ -223,7 +241,11 @@ void CCPathModule::Kill() {
 
 	mGroups.clear();
 	mObjects.clear();
+	mFields.clear();
+	mGroupFieldIDs.clear();
+	mAdvectionLimits.clear();
 	mGrid.Kill();
+	mFineGrid.Kill();
 }
 
 
@@ -241,10 +263,11 @@ void CCPathModule::UpdateGrid(bool isUpdateFrame) {
 			const unsigned int X = mGrid.GetGridWidth(); // numCellsX
 			const unsigned int Z = mGrid.GetGridHeight(); // numCellsZ
 
+			std::vector<CCGrid::ObjectData> testObjects;
+
 			for (unsigned int x = (X >> 2); x < (X - (X >> 2)); x++) {
 				for (unsigned int z = (Z >> 2); z < (Z - (Z >> 2)); z++) {
-					const CCGrid::Cell* c = mGrid.GetCell(z * X + x);
-					const vec3f& cp = mGrid.GetCellMidPos(c);
+					const vec3f& cp = mGrid.GetCellMidPos(z * X + x);
 
 					// expected behavior: in all areas where rho >= rho_max, the speed-field
 					// should contain the clamped flow=max(0, dot(avgSpeed, dirVector[NSEW]))
@@ -269,101 +292,164 @@ void CCPathModule::UpdateGrid(bool isUpdateFrame) {
 					//
 					// note: rho will be clamped to rho_max by ComputeAvgVelocity()
 
+					CCGrid::ObjectData obj;
+					obj.pos = cp;
+					obj.minRadius = (mGrid.GetSquareSize() >> 1);
+					obj.maxRadius = (mGrid.GetSquareSize() >> 1);
+					obj.numDiscomfortSteps = 1;
+
 					/*
+					obj.vel = NVECf;
+					obj.addDensity = true;
+
 					for (unsigned int n = 0; n < 10; n++) {
-						mGrid.AddDensity(cp, NVECf, (mGrid.GetSquareSize() >> 1), (mGrid.GetSquareSize() >> 1));
+						testObjects.push_back(obj);
 					}
+
+					obj.addDensity = false;
 					*/
 
 					// add to the mobile-discomfort field
-					mGrid.AddDiscomfort(cp, ( XVECf + ZVECf), (mGrid.GetSquareSize() >> 1), 1, 0.0f); // DIR_E + DIR_S
-					mGrid.AddDiscomfort(cp, (-XVECf + ZVECf), (mGrid.GetSquareSize() >> 1), 1, 0.0f); // DIR_W + DIR_S
+					obj.addDiscomfort = true;
+					obj.vel = ( XVECf + ZVECf); testObjects.push_back(obj); // DIR_E + DIR_S
+					obj.vel = (-XVECf + ZVECf); testObjects.push_back(obj); // DIR_W + DIR_S
 
-					// mGrid.AddDiscomfort(cp, ( XVECf - ZVECf), (mGrid.GetSquareSize() >> 1), 1, 0.0f); // DIR_E + DIR_N
-					// mGrid.AddDiscomfort(cp, (-XVECf - ZVECf), (mGrid.GetSquareSize() >> 1), 1, 0.0f); // DIR_W + DIR_N
+					// obj.vel = ( XVECf - ZVECf); testObjects.push_back(obj); // DIR_E + DIR_N
+					// obj.vel = (-XVECf - ZVECf); testObjects.push_back(obj); // DIR_W + DIR_N
 				}
 			}
+
+			mGrid.AddObjects(testObjects);
 		}
 		#endif
 
-		// convert the crowd into a density field (rho)
-		for (ObjectMapIt it = mObjects.begin(); it != mObjects.end(); ++it) {
-			const unsigned int objID = (it->first);
-			const SimObjectDef* objDef = (it->second)->GetDef();
-			const vec3f& objPos = coh->GetSimObjectPosition(objID);
-			const vec3f objVel =
-				coh->GetSimObjectDirection(objID) *
-				coh->GetSimObjectSpeed(objID);
-			const float minObjRad = coh->GetSimObjectModelRadius(objID);
-			const float maxObjRad = objDef->GetObjectRadius();
-
-			// sanity-check: the influence range of any sim-object should
-			// always be larger than the range at which minimum distance
-			// enforcement becomes active (which checks the model radius)
-			// regardless of grid resolution
-			PFFG_ASSERT(maxObjRad >= minObjRad);
-
-			// NOTE:
-			//   if objVel is a zero-vector, then avgVel will not change
-			//   therefore the flow speed can stay zero in a region, so
-			//   that *only* the topological speed determines the speed
-			//   field there
-			mGrid.AddDensity(objPos, objVel, minObjRad, maxObjRad);
-
-			#if (SIMOBJECT_PREDICTIVE_DISCOMFORT_FRAMES > 0)
-			// NOTE:
-			//   combine this with AddDensity?
-			//
-			//   adding discomfort in front of every unit just results
-			//   in more self-obstructions, unless the discomfort-field
-			//   is per-group and discomfort for a unit in group <g> is
-			//   only registered on the fields of the groups != <g> (but
-			//   then units within the same group would lack foresight)
-			//
-			//   the amount of lookahead should depend on the object's
-			//   maximum speed and radius (wrt. the cell-size) instead
-			//   of a fixed value
-			//
-			//   for faster units, SIMOBJECT_PREDICTIVE_DISCOMFORT_FRAMES
-			//   must be larger (and the grid update interval shorter) for
-			//   proper vortex and lane formation
-			const unsigned int ns = SIMOBJECT_PREDICTIVE_DISCOMFORT_FRAMES;
-			const float ss = mGrid.GetSquareSize() / objDef->GetMaxForwardSpeed();
+		AddObjectsToGrid(mGrid);
 
-			mGrid.AddDiscomfort(objPos, objVel, minObjRad, maxObjRad, ns, ss);
-			#endif
-		}
+		#if (GRID_FINE_DOWNSCALE_FACTOR > 0)
+		mFineGrid.Reset();
+		AddObjectsToGrid(mFineGrid);
+		#endif
+	}
+}
+
+void CCPathModule::AddObjectsToGrid(CCGrid& grid) {
+	std::vector<CCGrid::ObjectData>& objects = mGridObjects;
 
-		// now that we know the cumulative density per cell,
-		// we can compute the average velocity field (v-bar)
-		mGrid.ComputeAvgVelocity();
+	objects.clear();
+	objects.reserve(mObjects.size());
+
+	// convert the crowd into a density field (rho)
+	for (ObjectMapIt it = mObjects.begin(); it != mObjects.end(); ++it) {
+		const unsigned int objID = (it->first);
+		const SimObjectDef* objDef = (it->second)->GetDef();
+		const vec3f& objPos = coh->GetSimObjectPosition(objID);
+		const vec3f objVel =
+			coh->GetSimObjectDirection(objID) *
+			coh->GetSimObjectSpeed(objID);
+		const float minObjRad = coh->GetSimObjectModelRadius(objID);
+		const float maxObjRad = objDef->GetObjectRadius();
+
+		// sanity-check: the influence range of any sim-object should
+		// always be larger than the range at which minimum distance
+		// enforcement becomes active (which checks the model radius)
+		// regardless of grid resolution
+		PFFG_ASSERT(maxObjRad >= minObjRad);
+
+		CCGrid::ObjectData obj;
+		obj.pos = objPos;
+		obj.vel = objVel;
+		obj.minRadius = minObjRad;
+		obj.maxRadius = maxObjRad;
+
+		// NOTE:
+		//   if objVel is a zero-vector, then avgVel will not change
+		//   therefore the flow speed can stay zero in a region, so
+		//   that *only* the topological speed determines the speed
+		//   field there
+		obj.addDensity = true;
+
+		#if (SIMOBJECT_PREDICTIVE_DISCOMFORT_FRAMES > 0)
+		// NOTE:
+		//   combine this with AddDensity?
+		//
+		//   adding discomfort in front of every unit just results
+		//   in more self-obstructions, unless the discomfort-field
+		//   is per-group and discomfort for a unit in group <g> is
+		//   only registered on the fields of the groups != <g> (but
+		//   then units within the same group would lack foresight)
+		//
+		//   the amount of lookahead should depend on the object's
+		//   maximum speed and radius (wrt. the cell-size) instead
+		//   of a fixed value
+		//
+		//   for faster units, SIMOBJECT_PREDICTIVE_DISCOMFORT_FRAMES
+		//   must be larger (and the grid update interval shorter) for
+		//   proper vortex and lane formation
+		const unsigned int ns = SIMOBJECT_PREDICTIVE_DISCOMFORT_FRAMES;
+		const float ss = grid.GetSquareSize() / objDef->GetMaxForwardSpeed();
+
+		obj.numDiscomfortSteps = ns;
+		obj.discomfortStepSize = ss;
+		obj.addDiscomfort = true;
+		#endif
+
+		objects.push_back(obj);
 	}
+
+	grid.AddObjects(objects);
+
+	// now that we know the cumulative density per cell,
+	// we can compute the average velocity field (v-bar)
+	grid.ComputeAvgVelocity();
 }
 
 void CCPathModule::UpdateGroups(bool isUpdateFrame) {
 	List idleGroups;
 	ListIt idleGroupsIt;
 
+	// in staggered mode the grid decides which groups are solved
+	// (if any) on every frame, otherwise all of them are solved on
+	// each update frame
+	const bool isStaggered = (mGrid.GetUpdateMode() == CCGrid::UPDATE_MODE_STAGGERED);
+
+	if (isUpdateFrame || isStaggered) {
+		// for each active group, first construct the speed- and
+		// unit-cost field (f and C); second, calculate the potential-
+		// and gradient-fields (phi and delta-phi)
+		//
+		// the fields do not depend on the positions of the objects,
+		// so all groups are solved (in parallel) before any of them
+		// is moved
+		//
+		// NOTE: discomfort regarding this group can be computed here
+		std::vector<CCGrid::GroupUpdate> groupUpdates;
+		groupUpdates.reserve(mGroups.size());
+
+		// one update per (possibly shared) field
+		for (FieldMapIt it = mFields.begin(); it != mFields.end(); ++it) {
+			groupUpdates.push_back(CCGrid::GroupUpdate(it->first, &it->second.goalIDs, &it->second.objectIDs));
+		}
+
+		if (isStaggered) {
+			mGrid.UpdateGroupPotentialFieldsStaggered(groupUpdates, isUpdateFrame);
+		} else {
+			mGrid.UpdateGroupPotentialFields(groupUpdates);
+		}
+
+		#if (GRID_FINE_DOWNSCALE_FACTOR > 0)
+		if (isUpdateFrame) {
+			UpdateFineFields();
+		}
+		#endif
+	}
+
 	for (GroupMapIt it = mGroups.begin(); it != mGroups.end(); ++it) {
 		const MGroup*      group         = it->second;
 		const unsigned int groupID       = it->first;
 
-		const Set& groupGoalIDs = group->GetGoals();
 		const Set& groupObjectIDs = group->GetObjectIDs();
 
-		if (isUpdateFrame) {
-			// for each active group <groupID>, first construct the speed- and
-			// unit-cost field (f and C); second, calculate the potential- and
-			// gradient-fields (phi and delta-phi)
-			//
-			// NOTE: discomfort regarding this group can be computed here
-			// NOTE: it might be possible to compute the speed- and cost-
-			//       fields in the UpdateGroupPotentialField as cells are
-			//       picked from the UNKNOWN set, saving N iterations
-			mGrid.UpdateGroupPotentialField(groupID, groupGoalIDs, groupObjectIDs);
-		}
-
-		if (UpdateObjects(groupObjectIDs, groupGoalIDs)) {
+		if (UpdateObjects(GetGroupFieldID(groupID), groupObjectIDs)) {
 			// all units have arrived, mark the group for deletion
 			idleGroups.push_back(groupID);
 		}
@@ -374,15 +460,134 @@ void CCPathModule::UpdateGroups(bool isUpdateFrame) {
 	}
 }
 
-bool CCPathModule::UpdateObjects(const Set& groupObjectIDs, const Set& groupGoalIDs) {
+// solves the fine-level field of every (possibly shared) field,
+// but only inside a window around the members of its groups; if
+// the goals do not lie in that window, its borders are seeded with
+// the coarse potentials (which are known everywhere) so that the
+// fine field leads towards them
+//
+// NOTE:
+//    the cost of a fine solve depends on the spread of the group
+//    rather than on the size of the map; groups spread out over
+//    more than GRID_FINE_WINDOW_MAX_SIZE fine cells only use their
+//    coarse field
+void CCPathModule::UpdateFineFields() {
+	const unsigned int X = mFineGrid.GetGridWidth();
+	const unsigned int Z = mFineGrid.GetGridHeight();
+
+	// potentials are expressed in cells of the grid they belong to
+	const float potentialScale = float(mGrid.GetSquareSize()) / float(mFineGrid.GetSquareSize());
+
+	std::vector<CCGrid::GroupUpdate> groupUpdates;
+	std::vector<Set> windowGoalIDs(mFields.size());
+	std::vector<CCGrid::SeedList> windowSeeds(mFields.size());
+
+	groupUpdates.reserve(mFields.size());
+
+	unsigned int n = 0;
+
+	for (FieldMapIt it = mFields.begin(); it != mFields.end(); ++it, ++n) {
+		MField& field = it->second;
+
+		Set& goalIDs = windowGoalIDs[n];
+		CCGrid::SeedList& seeds = windowSeeds[n];
+
+		field.hasFineField = false;
+
+		if (field.objectIDs.empty()) {
+			continue;
+		}
+
+		unsigned int x0 = X - 1, x1 = 0;
+		unsigned int z0 = Z - 1, z1 = 0;
+
+		for (SetIt oit = field.objectIDs.begin(); oit != field.objectIDs.end(); ++oit) {
+			const unsigned int cellIdx = mFineGrid.GetCellIndex1D(coh->GetSimObjectPosition(*oit));
+
+			x0 = std::min(x0, cellIdx % X); x1 = std::max(x1, cellIdx % X);
+			z0 = std::min(z0, cellIdx / X); z1 = std::max(z1, cellIdx / X);
+		}
+
+		x0 = (x0 > GRID_FINE_WINDOW_MARGIN)? (x0 - GRID_FINE_WINDOW_MARGIN): 0;
+		z0 = (z0 > GRID_FINE_WINDOW_MARGIN)? (z0 - GRID_FINE_WINDOW_MARGIN): 0;
+		x1 = std::min(x1 + GRID_FINE_WINDOW_MARGIN, X - 1);
+		z1 = std::min(z1 + GRID_FINE_WINDOW_MARGIN, Z - 1);
+
+		if ((x1 - x0 + 1) > GRID_FINE_WINDOW_MAX_SIZE || (z1 - z0 + 1) > GRID_FINE_WINDOW_MAX_SIZE) {
+			continue;
+		}
+
+		field.fineWindow = CCGrid::Window(x0, z0, x1, z1);
+
+		for (SetIt git = field.fineGoalIDs.begin(); git != field.fineGoalIDs.end(); ++git) {
+			if (field.fineWindow.Contains((*git) % X, (*git) / X)) {
+				goalIDs.insert(*git);
+			}
+		}
+
+		if (goalIDs.size() < field.fineGoalIDs.size()) {
+			for (unsigned int z = z0; z <= z1; z++) {
+				for (unsigned int x = x0; x <= x1; x++) {
+					// borders that coincide with those of the map are not seeded
+					const bool borderX = ((x == x0 && x0 > 0) || (x == x1 && x1 < (X - 1)));
+					const bool borderZ = ((z == z0 && z0 > 0) || (z == z1 && z1 < (Z - 1)));
+
+					if (!borderX && !borderZ) {
+						continue;
+					}
+
+					const unsigned int cellIdx = z * X + x;
+					const float potential = mGrid.GetGroupPotential(it->first, mFineGrid.GetCellMidPos(cellIdx));
+
+					if (goalIDs.find(cellIdx) != goalIDs.end()) { continue; }
+					if (potential == std::numeric_limits<float>::infinity()) { continue; }
+
+					seeds.push_back(std::make_pair(cellIdx, potential * potentialScale));
+				}
+			}
+		}
+
+		if (goalIDs.empty() && seeds.empty()) {
+			// coarse field not solved yet (staggered mode)
+			continue;
+		}
+
+		groupUpdates.push_back(CCGrid::GroupUpdate(it->first, &goalIDs, &field.objectIDs));
+		groupUpdates.back().window = &field.fineWindow;
+		groupUpdates.back().seeds = &seeds;
+
+		field.hasFineField = true;
+	}
+
+	mFineGrid.UpdateGroupPotentialFields(groupUpdates);
+}
+
+bool CCPathModule::UpdateObjects(unsigned int fieldID, const Set& groupObjectIDs) {
 	unsigned int numArrivedObjects = 0;
 
-	// finally, update the locations of objects in this group ("advection")
-	// (the complexity of this is O(M * K) with M the number of units and K
-	// the number of goals)
+	// an object has arrived once it is within one square of the center
+	// of a goal-cell, and every such cell is adjacent to (or equal to)
+	// the cell containing the object; the group's goals are shared by
+	// its field, so only those of the 3x3 cells around each object have
+	// to be tested (making this O(M) with M the number of units)
+	const std::vector<bool>& goalCellMask = mFields[fieldID].goalCellMask;
+
+	const int gridSizeX = mGrid.GetGridWidth();
+	const int gridSizeZ = mGrid.GetGridHeight();
+	const float arrivalDistSq = mGrid.GetSquareSize() * mGrid.GetSquareSize();
+
+	CCGrid::AdvectionArrays& coarseObjects = mGridAdvections;
+	CCGrid::AdvectionArrays& fineObjects = mFineGridAdvections;
+
+	coarseObjects.Clear();
+	fineObjects.Clear();
+
+	// gather the states of the objects in this group that
+	// are still moving, split by the grid whose field they
+	// follow (objects inside the window of their fine field
+	// follow that, all others use the coarse field)
 	for (SetIt goit = groupObjectIDs.begin(); goit != groupObjectIDs.end(); ++goit) {
 		const unsigned int objectID = *goit;
-		const unsigned int objectCellID = mGrid.GetCellIndex1D(coh->GetSimObjectPosition(objectID));
 		const MObject* object = mObjects[objectID];
 
 		if (object->HasArrived()) {
@@ -390,36 +595,150 @@ bool CCPathModule::UpdateObjects(const Set& groupObjectIDs, const Set& groupGoal
 			continue;
 		}
 
-		mGrid.UpdateSimObjectLocation(object->GetGroupID(), objectID, objectCellID);
+		CCGrid* objectGrid = &mGrid;
+		CCGrid::AdvectionArrays* objects = &coarseObjects;
+
+		const vec3f& objectPos = coh->GetSimObjectPosition(objectID);
+
+		#if (GRID_FINE_DOWNSCALE_FACTOR > 0)
+		if (InFineWindow(fieldID, mFineGrid.GetCellIndex1D(objectPos))) {
+			objectGrid = &mFineGrid;
+			objects = &fineObjects;
+		}
+		#endif
+
+		objects->Push(
+			objectID,
+			objectGrid->GetCellIndex1D(objectPos),
+			objectPos,
+			coh->GetSimObjectDirection(objectID),
+			coh->GetSimObjectSpeed(objectID),
+			mAdvectionLimits[(object->GetDef())->GetID()]
+		);
+	}
+
+	// finally, update the locations of objects in this group ("advection")
+	mGrid.UpdateSimObjectLocations(fieldID, coarseObjects);
+	#if (GRID_FINE_DOWNSCALE_FACTOR > 0)
+	mFineGrid.UpdateSimObjectLocations(fieldID, fineObjects);
+	#endif
+
+	for (unsigned int n = 0; n < (coarseObjects.GetSize() + fineObjects.GetSize()); n++) {
+		const bool isCoarse = (n < coarseObjects.GetSize());
+		const CCGrid::AdvectionArrays& objects = isCoarse? coarseObjects: fineObjects;
+		const unsigned int i = isCoarse? n: (n - coarseObjects.GetSize());
+		const unsigned int objectID = objects.objectIDs[i];
+
+		if (objects.moved[i] != 0) {
+			coh->SetSimObjectRawPhysicalState(objectID, objects.wantedPositions[i], objects.wantedDirections[i], objects.wantedSpeeds[i]);
+		}
 
 		const vec3f& objectPos = coh->GetSimObjectPosition(objectID);
 		const vec3f& objectDir = coh->GetSimObjectDirection(objectID);
 
-		for (SetIt ggit = groupGoalIDs.begin(); ggit != groupGoalIDs.end(); ++ggit) {
-			const CCGrid::Cell* goalCell = mGrid.GetCell(*ggit);
-			const vec3f& goalPos = mGrid.GetCellMidPos(goalCell);
+		const vec3i& objectCell = mGrid.GetCellIndex2D(objectPos);
 
-			if ((objectPos - goalPos).sqLen2D() < (mGrid.GetSquareSize() * mGrid.GetSquareSize())) {
-				mObjects[objectID]->SetArrived(true);
+		bool arrived = false;
 
-				WantedPhysicalState wps = coh->GetSimObjectWantedPhysicalState(objectID, true);
+		for (int z = std::max(objectCell.z - 1, 0); z <= std::min(objectCell.z + 1, gridSizeZ - 1) && !arrived; z++) {
+			for (int x = std::max(objectCell.x - 1, 0); x <= std::min(objectCell.x + 1, gridSizeX - 1) && !arrived; x++) {
+				const unsigned int cellIdx = z * gridSizeX + x;
 
-				// just come to a halt if close to some goal cell
-				// (by letting the engine stop the unit's movement)
-				wps.wantedPos   = objectPos;
-				wps.wantedDir   = objectDir;
-				wps.wantedSpeed = 0.0f;
+				if (!goalCellMask[cellIdx]) {
+					continue;
+				}
 
-				coh->PushSimObjectWantedPhysicalState(objectID, wps, false, true);
-				coh->SetSimObjectPhysicsUpdates(objectID, true);
-				break;
+				arrived = ((objectPos - mGrid.GetCellMidPos(cellIdx)).sqLen2D() < arrivalDistSq);
 			}
 		}
+
+		if (arrived) {
+			mObjects[objectID]->SetArrived(true);
+
+			WantedPhysicalState wps = coh->GetSimObjectWantedPhysicalState(objectID, true);
+
+			// just come to a halt if close to some goal cell
+			// (by letting the engine stop the unit's movement)
+			wps.wantedPos   = objectPos;
+			wps.wantedDir   = objectDir;
+			wps.wantedSpeed = 0.0f;
+
+			coh->PushSimObjectWantedPhysicalState(objectID, wps, false, true);
+			coh->SetSimObjectPhysicsUpdates(objectID, true);
+		}
 	}
 
 	return (numArrivedObjects >= groupObjectIDs.size());
 }
 
+// push apart all overlapping pairs of one frame; the positions
+// and radii of the involved objects are gathered into packed
+// arrays once, the pairs are relaxed in order over those (so
+// each pair sees the corrections of the pairs before it) and
+// only the objects that actually moved are written back
+void CCPathModule::EnforceMinimumDistances(const SimObjectCollisionEvent* e) {
+	const unsigned int numCollisions = e->GetNumCollisions();
+
+	if (mCollisionSlots.size() < coh->GetMaxSimObjects()) {
+		mCollisionSlots.resize(coh->GetMaxSimObjects(), -1);
+	}
+
+	mCollisionObjectIDs.clear();
+	mCollisionPositions.clear();
+	mCollisionRadii.clear();
+	mCollisionIndices.resize(numCollisions * 2);
+
+	for (unsigned int n = 0; n < (numCollisions * 2); n++) {
+		const unsigned int objectID = ((n & 1) == 0)? e->GetColliderID(n >> 1): e->GetCollideeID(n >> 1);
+
+		if (mCollisionSlots[objectID] == -1) {
+			mCollisionSlots[objectID] = mCollisionObjectIDs.size();
+			mCollisionObjectIDs.push_back(objectID);
+			mCollisionPositions.push_back(coh->GetSimObjectPosition(objectID));
+			mCollisionRadii.push_back(coh->GetSimObjectModelRadius(objectID));
+		}
+
+		mCollisionIndices[n] = mCollisionSlots[objectID];
+	}
+
+	mCollisionMoved.assign(mCollisionObjectIDs.size(), 0);
+
+	for (unsigned int n = 0; n < numCollisions; n++) {
+		const unsigned int colliderIdx = mCollisionIndices[n * 2 + 0];
+		const unsigned int collideeIdx = mCollisionIndices[n * 2 + 1];
+
+		vec3f& colliderPos = mCollisionPositions[colliderIdx];
+		vec3f& collideePos = mCollisionPositions[collideeIdx];
+
+		const float radiusSum = mCollisionRadii[colliderIdx] + mCollisionRadii[collideeIdx];
+
+		const vec3f separationVec = colliderPos - collideePos;
+		const float separationMin = radiusSum * radiusSum;
+
+		if ((separationVec.sqLen3D() - separationMin) < 0.0f) {
+			const float dst = (separationVec.len3D());
+			const vec3f dir = (separationVec / dst);
+			const vec3f dif = (dir * ((radiusSum - dst) * 0.5f));
+
+			colliderPos += dif;
+			collideePos -= dif;
+
+			mCollisionMoved[colliderIdx] = 1;
+			mCollisionMoved[collideeIdx] = 1;
+		}
+	}
+
+	for (unsigned int n = 0; n < mCollisionObjectIDs.size(); n++) {
+		const unsigned int objectID = mCollisionObjectIDs[n];
+
+		if (mCollisionMoved[n] != 0) {
+			coh->SetSimObjectRawPosition(objectID, mCollisionPositions[n]);
+		}
+
+		mCollisionSlots[objectID] = -1;
+	}
+}
+
 
 
 bool CCPathModule::DelObjectFromGroup(unsigned int objectID) {
@@ -436,9 +755,14 @@ bool CCPathModule::DelObjectFromGroup(unsigned int objectID) {
 		group = (git->second);
 		group->DelObject(objectID);
 
+		MField& field = mFields[GetGroupFieldID(groupID)];
+
+		field.objectIDs.erase(objectID);
+		SetFieldLimits(field, field.objectIDs);
+
 		if (group->IsEmpty()) {
 			// old group is now empty, delete it
-			mGrid.DelGroup(groupID);
+			DelGroupField(groupID);
 			mGroups.erase(groupID);
 			delete group;
 		}
@@ -476,12 +800,126 @@ bool CCPathModule::DelGroup(unsigned int groupID) {
 		mObjects[*git]->SetGroupID(-1);
 	}
 
+	DelGroupField(groupID);
 	mGroups.erase(groupID);
-	mGrid.DelGroup(groupID);
 	delete group;
 	return true;
 }
 
+// gives a new group the fields of an existing group with
+// equal goals and limits, or registers a new set with the
+// grid if there is none
+void CCPathModule::AddGroupField(unsigned int groupID) {
+	const MGroup* group = mGroups[groupID];
+	const Set& groupObjectIDs = group->GetObjectIDs();
+
+	MField newField;
+	newField.goalIDs = group->GetGoals();
+
+	SetFieldLimits(newField, groupObjectIDs);
+
+	unsigned int fieldID = groupID;
+
+	#if (GROUP_SHARED_FIELDS == 1)
+	for (FieldMapIt it = mFields.begin(); it != mFields.end(); ++it) {
+		if ((it->second).IsCompatible(newField)) {
+			fieldID = it->first; break;
+		}
+	}
+	#endif
+
+	if (fieldID == groupID) {
+		#if (GRID_FINE_DOWNSCALE_FACTOR > 0)
+		for (SetIt it = newField.goalIDs.begin(); it != newField.goalIDs.end(); ++it) {
+			newField.fineGoalIDs.insert(mFineGrid.GetCellIndex1D(mGrid.GetCellMidPos(*it)));
+		}
+
+		mFineGrid.AddGroup(fieldID);
+		#endif
+
+		newField.goalCellMask.resize(mGrid.GetGridWidth() * mGrid.GetGridHeight(), false);
+
+		for (SetIt it = newField.goalIDs.begin(); it != newField.goalIDs.end(); ++it) {
+			newField.goalCellMask[*it] = true;
+		}
+
+		mFields[fieldID] = newField;
+		mGrid.AddGroup(fieldID);
+	}
+
+	MField& field = mFields[fieldID];
+	field.objectIDs.insert(groupObjectIDs.begin(), groupObjectIDs.end());
+	field.numGroups += 1;
+
+	mGroupFieldIDs[groupID] = fieldID;
+}
+
+// releases a (deleted) group's reference to its fields
+void CCPathModule::DelGroupField(unsigned int groupID) {
+	const unsigned int fieldID = GetGroupFieldID(groupID);
+	const Set& groupObjectIDs = mGroups[groupID]->GetObjectIDs();
+
+	MField& field = mFields[fieldID];
+
+	for (SetIt it = groupObjectIDs.begin(); it != groupObjectIDs.end(); ++it) {
+		field.objectIDs.erase(*it);
+	}
+
+	SetFieldLimits(field, field.objectIDs);
+	mGroupFieldIDs.erase(groupID);
+
+	if ((--field.numGroups) == 0) {
+		#if (GRID_FINE_DOWNSCALE_FACTOR > 0)
+		mFineGrid.DelGroup(fieldID);
+		#endif
+
+		mGrid.DelGroup(fieldID);
+		mFields.erase(fieldID);
+	}
+}
+
+// derives the limits of <field> from <objectIDs>, the same
+// way CCGrid derives them from the members of a group
+void CCPathModule::SetFieldLimits(MField& field, const Set& objectIDs) {
+	field.minSlope  =  std::numeric_limits<float>::max();
+	field.maxSlope  = -std::numeric_limits<float>::max();
+	field.maxSpeed  = -std::numeric_limits<float>::max();
+	field.maxRadius = -std::numeric_limits<float>::max();
+
+	for (SetIt it = objectIDs.begin(); it != objectIDs.end(); ++it) {
+		const SimObjectDef* def = mObjects[*it]->GetDef();
+
+		field.minSlope  = std::min(field.minSlope,  def->GetMinSlopeAngleCosine());
+		field.maxSlope  = std::max(field.maxSlope,  def->GetMaxSlopeAngleCosine());
+		field.maxSpeed  = std::max(field.maxSpeed,  def->GetMaxForwardSpeed());
+		field.maxRadius = std::max(field.maxRadius, def->GetObjectRadius());
+	}
+}
+
+unsigned int CCPathModule::GetGroupFieldID(unsigned int groupID) const {
+	std::map<unsigned int, unsigned int>::const_iterator it = mGroupFieldIDs.find(groupID);
+
+	PFFG_ASSERT(it != mGroupFieldIDs.end());
+	return (it->second);
+}
+
+// true if fine cell <cellIdx> lies inside the window in which the
+// fine field <fieldID> was solved, at least two cells away from its
+// (seeded) borders
+bool CCPathModule::InFineWindow(unsigned int fieldID, unsigned int cellIdx) const {
+	const std::map<unsigned int, MField>::const_iterator it = mFields.find(fieldID);
+
+	if (it == mFields.end() || !(it->second).hasFineField) {
+		return false;
+	}
+
+	const CCGrid::Window& w = (it->second).fineWindow;
+	const unsigned int x = cellIdx % mFineGrid.GetGridWidth();
+	const unsigned int z = cellIdx / mFineGrid.GetGridWidth();
+
+	return ((x >= w.x0 + 2) && (x + 2 <= w.x1) && (z >= w.z0 + 2) && (z + 2 <= w.z1));
+}
+
 
 
 
@@ -490,21 +928,27 @@ bool CCPathModule::DelGroup(unsigned int groupID) {
 bool CCPathModule::GetScalarDataTypeInfo(DataTypeInfo* i) const {
 	bool ret = true;
 
+	// HACK: we don't want to change the interface (the per-group
+	// visualisation data is assembled by the grid on request)
+	CCPathModule* m = const_cast<CCPathModule*>(this);
+
 	if (!i->cached) {
+		// groups sharing a field also share its visualisation data
+		const std::map<unsigned int, unsigned int>::const_iterator fit = mGroupFieldIDs.find(i->group);
+		const unsigned int fieldID = (fit != mGroupFieldIDs.end())? fit->second: i->group;
+
 		i->sizex = mGrid.GetGridWidth();
 		i->sizey = mGrid.GetGridHeight();
 
 		switch (i->type) {
 			case CCGrid::DATATYPE_DENSITY:    { i->fdata = mGrid.GetDensityVisDataArray();            i->stride =                1; i->global = true;  i->name =    "DENSITY"; } break;
 			case CCGrid::DATATYPE_HEIGHT:     { i->fdata = mGrid.GetHeightVisDataArray();             i->stride =                1; i->global = true;  i->name =     "HEIGHT"; } break;
-			case CCGrid::DATATYPE_SPEED:      { i->fdata = mGrid.GetSpeedVisDataArray(i->group);      i->stride = CCGrid::NUM_DIRS; i->global = false; i->name =      "SPEED"; } break;
-			case CCGrid::DATATYPE_COST:       { i->fdata = mGrid.GetCostVisDataArray(i->group);       i->stride = CCGrid::NUM_DIRS; i->global = false; i->name =       "COST"; } break;
-			case CCGrid::DATATYPE_POTENTIAL:  { i->fdata = mGrid.GetPotentialVisDataArray(i->group);  i->stride =                1; i->global = false; i->name =  "POTENTIAL"; } break;
+			case CCGrid::DATATYPE_SPEED:      { i->fdata = m->mGrid.GetSpeedVisDataArray(fieldID);       i->stride = CCGrid::NUM_DIRS; i->global = false; i->name =      "SPEED"; } break;
+			case CCGrid::DATATYPE_COST:       { i->fdata = m->mGrid.GetCostVisDataArray(fieldID);        i->stride = CCGrid::NUM_DIRS; i->global = false; i->name =       "COST"; } break;
+			case CCGrid::DATATYPE_POTENTIAL:  { i->fdata = m->mGrid.GetPotentialVisDataArray(fieldID);   i->stride =                1; i->global = false; i->name =  "POTENTIAL"; } break;
 			default: { ret = false; } break;
 		}
 
-		// HACK: we don't want to change the interface
-		CCPathModule* m = const_cast<CCPathModule*>(this);
 		m->cachedScalarData = *i;
 		m->cachedScalarData.cached = true;
 	} else {
@@ -517,7 +961,12 @@ bool CCPathModule::GetScalarDataTypeInfo(DataTypeInfo* i) const {
 bool CCPathModule::GetVectorDataTypeInfo(DataTypeInfo* i) const {
 	bool ret = true;
 
+	CCPathModule* m = const_cast<CCPathModule*>(this);
+
 	if (!i->cached) {
+		const std::map<unsigned int, unsigned int>::const_iterator fit = mGroupFieldIDs.find(i->group);
+		const unsigned int fieldID = (fit != mGroupFieldIDs.end())? fit->second: i->group;
+
 		i->sizex = mGrid.GetGridWidth();
 		i->sizey = mGrid.GetGridHeight();
 
@@ -525,12 +974,11 @@ bool CCPathModule::GetVectorDataTypeInfo(DataTypeInfo* i) const {
 			case CCGrid::DATATYPE_DISCOMFORT:      { i->vdata = mGrid.GetDiscomfortVisDataArray();             i->stride =                1; i->global = true;  i->name =      "DISCOMFORT"; } break;
 			case CCGrid::DATATYPE_HEIGHT_DELTA:    { i->vdata = mGrid.GetHeightDeltaVisDataArray();            i->stride = CCGrid::NUM_DIRS; i->global = true;  i->name =    "HEIGHT_DELTA"; } break;
 			case CCGrid::DATATYPE_VELOCITY_AVG:    { i->vdata = mGrid.GetVelocityAvgVisDataArray();            i->stride =                1; i->global = true;  i->name =    "VELOCITY_AVG"; } break;
-			case CCGrid::DATATYPE_VELOCITY:        { i->vdata = mGrid.GetVelocityVisDataArray(i->group);       i->stride = CCGrid::NUM_DIRS; i->global = false; i->name =        "VELOCITY"; } break;
-			case CCGrid::DATATYPE_POTENTIAL_DELTA: { i->vdata = mGrid.GetPotentialDeltaVisDataArray(i->group); i->stride = CCGrid::NUM_DIRS; i->global = false; i->name = "POTENTIAL_DELTA"; } break;
+			case CCGrid::DATATYPE_VELOCITY:        { i->vdata = m->mGrid.GetVelocityVisDataArray(fieldID);        i->stride = CCGrid::NUM_DIRS; i->global = false; i->name =        "VELOCITY"; } break;
+			case CCGrid::DATATYPE_POTENTIAL_DELTA: { i->vdata = m->mGrid.GetPotentialDeltaVisDataArray(fieldID);  i->stride = CCGrid::NUM_DIRS; i->global = false; i->name = "POTENTIAL_DELTA"; } break;
 			default: { ret = false; } break;
 		}
 
-		CCPathModule* m = const_cast<CCPathModule*>(this);
 		m->cachedVectorData = *i;
 		m->cachedVectorData.cached = true;
 	} else {
@@ -37,18 +37,95 @@ private:
 	typedef std::list<unsigned int> List;
 	typedef std::list<unsigned int>::const_iterator ListIt;
 
+	// groups with the same goal-cells and the same speed- and
+	// slope-limits (all that a group's fields depend on besides
+	// the global grid state) share one set of fields, which the
+	// grid knows under the ID of the group that created it and
+	// which lives until the last group using it is deleted
+	struct MField {
+		MField(): minSlope(0.0f), maxSlope(0.0f), maxSpeed(0.0f), maxRadius(0.0f), numGroups(0), hasFineField(false) {}
+
+		bool IsCompatible(const MField& f) const {
+			return
+				(goalIDs == f.goalIDs) &&
+				(minSlope == f.minSlope) && (maxSlope == f.maxSlope) &&
+				(maxSpeed == f.maxSpeed) && (maxRadius == f.maxRadius);
+		}
+
+		Set goalIDs;
+		Set objectIDs; // members of all groups using this field
+
+		// <goalIDs> as one flag per (coarse) cell, for the arrival test
+		std::vector<bool> goalCellMask;
+
+		// the limits of <objectIDs> (kept up to date as members
+		// leave, since the grid solves for the current members)
+		float minSlope;
+		float maxSlope;
+		float maxSpeed;
+		float maxRadius;
+
+		unsigned int numGroups;
+
+		// fine-level goal-cells and the window in which the
+		// fine field was last solved (if it was, see UpdateFineFields)
+		Set fineGoalIDs;
+		CCGrid::Window fineWindow;
+		bool hasFineField;
+	};
+
+	typedef std::map<unsigned int, MField> FieldMap;
+	typedef std::map<unsigned int, MField>::iterator FieldMapIt;
+
 	void UpdateGrid(bool);
 	void UpdateGroups(bool);
-	bool UpdateObjects(const Set&, const Set&);
+	void UpdateFineFields();
+	bool UpdateObjects(unsigned int, const Set&);
+	void EnforceMinimumDistances(const SimObjectCollisionEvent*);
+
+	void AddObjectsToGrid(CCGrid&);
+	bool InFineWindow(unsigned int, unsigned int) const;
 
 	void AddObjectToGroup(unsigned int, unsigned int);
 	bool DelObjectFromGroup(unsigned int);
 	bool DelGroup(unsigned int);
 
-	// each group is updated sequentially, so we only
-	// require one grid in which the per-group fields
-	// are recycled
+	void AddGroupField(unsigned int);
+	void DelGroupField(unsigned int);
+	void SetFieldLimits(MField&, const Set&);
+	unsigned int GetGroupFieldID(unsigned int) const;
+
+	// the grid owns one workspace per solver thread in
+	// which the per-group fields are recycled; only the
+	// resulting velocity-fields are kept for each field
+	//
+	// the fine grid (if GRID_FINE_DOWNSCALE_FACTOR > 0)
+	// covers the same map at a higher resolution, but is
+	// only solved in windows around the groups
 	CCGrid mGrid;
+	CCGrid mFineGrid;
+
+	// per-frame splat input of AddObjectsToGrid()
+	std::vector<CCGrid::ObjectData> mGridObjects;
+
+	// per-group advection input and output of UpdateObjects(),
+	// and the advection limits of every def (indexed by def-ID)
+	CCGrid::AdvectionArrays mGridAdvections;
+	CCGrid::AdvectionArrays mFineGridAdvections;
+	std::vector<CCGrid::AdvectionLimits> mAdvectionLimits;
+
+	// per-frame collision-pair state of EnforceMinimumDistances():
+	// the packed slot of each object-ID (-1 if not involved), the
+	// slot-indices of every pair and the per-slot object-data
+	std::vector<int> mCollisionSlots;
+	std::vector<unsigned int> mCollisionIndices;
+	std::vector<unsigned int> mCollisionObjectIDs;
+	std::vector<vec3f> mCollisionPositions;
+	std::vector<float> mCollisionRadii;
+	std::vector<unsigned char> mCollisionMoved;
+
+	FieldMap mFields;
+	std::map<unsigned int, unsigned int> mGroupFieldIDs;
 
 	DataTypeInfo cachedScalarData;
 	DataTypeInfo cachedVectorData;
@@ -68,26 +68,28 @@ void DummyPathModule::OnEvent(const IEvent* e) {
 		case EVENT_SIMOBJECT_COLLISION: {
 			const SimObjectCollisionEvent* ee = dynamic_cast<const SimObjectCollisionEvent*>(e);
 
-			const unsigned int colliderID = ee->GetColliderID();
-			const unsigned int collideeID = ee->GetCollideeID();
+			for (unsigned int n = 0; n < ee->GetNumCollisions(); n++) {
+				const unsigned int colliderID = ee->GetColliderID(n);
+				const unsigned int collideeID = ee->GetCollideeID(n);
 
-			const vec3f& colliderPos = coh->GetSimObjectPosition(colliderID);
-			const vec3f& collideePos = coh->GetSimObjectPosition(collideeID);
+				const vec3f& colliderPos = coh->GetSimObjectPosition(colliderID);
+				const vec3f& collideePos = coh->GetSimObjectPosition(collideeID);
 
-			const float colliderRadius = coh->GetSimObjectModelRadius(colliderID);
-			const float collideeRadius = coh->GetSimObjectModelRadius(collideeID);
+				const float colliderRadius = coh->GetSimObjectModelRadius(colliderID);
+				const float collideeRadius = coh->GetSimObjectModelRadius(collideeID);
 
-			const vec3f separationVec = colliderPos - collideePos;
-			const float separationMin = (colliderRadius + collideeRadius) * (colliderRadius + collideeRadius);
+				const vec3f separationVec = colliderPos - collideePos;
+				const float separationMin = (colliderRadius + collideeRadius) * (colliderRadius + collideeRadius);
 
-			// enforce minimum distance between objects
-			if ((separationVec.sqLen3D() - separationMin) < 0.0f) {
-				const float dst = (separationVec.len3D());
-				const vec3f dir = (separationVec / dst);
-				const vec3f dif = (dir * (((colliderRadius + collideeRadius) - dst) * 0.5f));
+				// enforce minimum distance between objects
+				if ((separationVec.sqLen3D() - separationMin) < 0.0f) {
+					const float dst = (separationVec.len3D());
+					const vec3f dir = (separationVec / dst);
+					const vec3f dif = (dir * (((colliderRadius + collideeRadius) - dst) * 0.5f));
 
-				coh->SetSimObjectRawPosition(colliderID, colliderPos + dif);
-				coh->SetSimObjectRawPosition(collideeID, collideePos - dif);
+					coh->SetSimObjectRawPosition(colliderID, colliderPos + dif);
+					coh->SetSimObjectRawPosition(collideeID, collideePos - dif);
+				}
 			}
 		} break;
 
@@ -281,7 +281,7 @@ void CScene::DrawModels(Camera* eye, bool inShadowPass) {
 			const vec3f offsetPos = vec3f(0.0f, obj->GetModelRadius(), 0.0f);
 			const vec3f objRenderPos =
 				objMat.GetPos() +
-				(objMat.GetZDir() * obj->GetPhysicalState().speed * simFrameDeltaTickRatio) +
+				(objMat.GetZDir() * obj->GetSpeed() * simFrameDeltaTickRatio) +
 				offsetPos;
 			const mat44f objRenderMat(objRenderPos, objMat.GetXDir(), objMat.GetYDir(), objMat.GetZDir());
 			const vec4f& objCol = teamColors[obj->GetTeamID() % teamColors.size()];
@@ -1,25 +1,66 @@
 #include "./SimObject.hpp"
 #include "./SimObjectDef.hpp"
-#include "./SimThread.hpp"
-
-#define SIMOBJECT_TRACE_FRAME_COUNT    150
-#define SIMOBJECT_TRACE_FRAME_INTERVAL   5
-
-void SimObject::Update() {
-	PhysicalState p = physicalState;
 
+void SimObject::UpdatePrevPhysicalStates() {
 	#if (SIMOBJECT_TRACE_FRAME_COUNT > 0)
-	if ((sThread->GetFrame() % SIMOBJECT_TRACE_FRAME_INTERVAL) == 0) {
-		prevPhysicalStates.push_front(p);
+	prevPhysicalStates.push_front(GetPhysicalState());
 
-		if (prevPhysicalStates.size() >= (SIMOBJECT_TRACE_FRAME_COUNT / SIMOBJECT_TRACE_FRAME_INTERVAL)) {
-			prevPhysicalStates.pop_back();
-		}
+	if (prevPhysicalStates.size() >= (SIMOBJECT_TRACE_FRAME_COUNT / SIMOBJECT_TRACE_FRAME_INTERVAL)) {
+		prevPhysicalStates.pop_back();
 	}
 	#endif
+}
+
+
+
+void SimObject::UpdateMat() {
+	const vec3f& ydir = physicalStates->upDirs[objectID];
+	const vec3f& zdir = physicalStates->forwardDirs[objectID];
+
+	mat = mat44f(GetPos(), (zdir.cross(ydir)).inorm3D(), ydir, zdir);
+}
+
+void SimObject::SetPos(const vec3f& pos) {
+	physicalStates->moved[objectID] |= (pos != GetPos());
+	physicalStates->positions[objectID] = pos;
+
+	mat.SetPos(pos);
+}
+
+void SimObject::SetDirs(const vec3f& fdir, const vec3f& udir) {
+	physicalStates->SetObjectDirs(objectID, fdir, udir);
+
+	UpdateMat();
+}
+
+void SimObject::SetSpeed(float speed) {
+	physicalStates->speeds[objectID] = speed;
+}
+
+void SimObject::SetPhysicsUpdates(bool b) {
+	physicalStates->enabled[objectID] = b;
+}
+
+PhysicalState SimObject::GetPhysicalState() const {
+	PhysicalState state;
+
+	state.mat = GetMat();
+	state.speed = GetSpeed();
+	state.enabled = (physicalStates->enabled[objectID] != 0);
+	state.moved = HasMoved();
+	return state;
+}
+
+void SimObject::SetPhysicalState(const PhysicalState& state) {
+	SetPos(state.mat.GetPos());
 
-	p.Update(this);
-	this->SetPhysicalState(p);
+	// no re-orthonormalization, states are restored as-is
+	physicalStates->forwardDirs[objectID] = state.mat.GetZDir();
+	physicalStates->upDirs[objectID] = state.mat.GetYDir();
+	physicalStates->speeds[objectID] = state.speed;
+	physicalStates->enabled[objectID] = state.enabled;
+
+	UpdateMat();
 }
 
 
@@ -50,6 +91,8 @@ void SimObject::PushWantedPhysicalState(const WantedPhysicalState& wps, bool que
 	} else {
 		wantedPhysicalStates.push_back(wps);
 	}
+
+	UpdateWantedPhysicalState();
 }
 
 // remove a wanted state from the front or back of this object's queue
@@ -66,5 +109,15 @@ bool SimObject::PopWantedPhysicalStates(unsigned int numStates, bool front) {
 		}
 	}
 
+	UpdateWantedPhysicalState();
 	return true;
 }
+
+// copy the first state in the queue to the physical-state arrays
+void SimObject::UpdateWantedPhysicalState() {
+	const WantedPhysicalState& wps = GetWantedPhysicalState(true);
+
+	physicalStates->wantedDirs[objectID] = wps.wantedDir;
+	physicalStates->wantedSpeeds[objectID] = wps.wantedSpeed;
+	physicalStates->hasWantedState[objectID] = !wantedPhysicalStates.empty();
+}
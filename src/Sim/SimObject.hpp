@@ -5,25 +5,35 @@
 
 #include "./SimObjectState.hpp"
 
+// every SIMOBJECT_TRACE_FRAME_INTERVAL frames, each object
+// keeps a snapshot of its physical state (for rendering)
+// until it is SIMOBJECT_TRACE_FRAME_COUNT frames old
+#define SIMOBJECT_TRACE_FRAME_COUNT    150
+#define SIMOBJECT_TRACE_FRAME_INTERVAL   5
+
 struct LocalModel;
 class SimObjectDef;
 class SimObject {
 public:
-	SimObject(SimObjectDef* d, unsigned int oid, unsigned int tid): def(d), objectID(oid), teamID(tid) {
+	SimObject(SimObjectDef* d, unsigned int oid, unsigned int tid, PhysicalStateArrays* s): def(d), objectID(oid), teamID(tid), physicalStates(s) {
 		// NOTE:
 		//    this is set by rendering code when it receives the
 		//    SimObjectCreatedEvent, so simulation logic will not
 		//    see the proper value via GetModelRadius() until the
 		//    next sim-frame
 		mdlRadius = 0.0f;
+
+		physicalStates->InitObject(objectID, def);
+		UpdateMat();
 	}
 
 	virtual ~SimObject() {
 		def = NULL;
 		mdl = NULL;
+		physicalStates = NULL;
 	}
 
-	virtual void Update();
+	void UpdatePrevPhysicalStates();
 
 	const SimObjectDef* GetDef() const { return def; }
 	unsigned int GetID() const { return objectID; }
@@ -35,14 +45,25 @@ public:
 	float GetModelRadius() const { return mdlRadius; }
 	void SetModelRadius(float f) { mdlRadius = f; }
 
-	const mat44f& GetMat() const { return physicalState.mat; }
-	void SetMat(const mat44f& m) { physicalState.mat = m; }
-	const vec3f& GetPos() const { return (physicalState.mat).GetPos(); } // wrapper
-	bool HasMoved() const { return physicalState.moved; }
+	// the physical state lives in the SimObjectHandler's arrays
+	// (the matrix is derived from it on the sim-thread, by the
+	// setters below and by the handler after every integration,
+	// so other threads only ever read it)
+	void UpdateMat();
+	const mat44f& GetMat() const { return mat; }
+	const vec3f& GetPos() const { return physicalStates->positions[objectID]; }
+	const vec3f& GetDir() const { return physicalStates->forwardDirs[objectID]; }
+	float GetSpeed() const { return physicalStates->speeds[objectID]; }
+	bool HasMoved() const { return (physicalStates->moved[objectID] != 0); }
+
+	void SetPos(const vec3f&);
+	void SetDirs(const vec3f&, const vec3f&);
+	void SetSpeed(float);
+	void SetPhysicsUpdates(bool);
 
 	// get or set this object's current physical state
-	const PhysicalState& GetPhysicalState() const { return physicalState; }
-	void SetPhysicalState(const PhysicalState& s) { physicalState = s; }
+	PhysicalState GetPhysicalState() const;
+	void SetPhysicalState(const PhysicalState&);
 
 	const WantedPhysicalState& GetWantedPhysicalState(bool) const;
 	void PushWantedPhysicalState(const WantedPhysicalState&, bool, bool);
@@ -52,6 +73,8 @@ public:
 	const std::list<PhysicalState>& GetPrevPhysicalStates() const { return prevPhysicalStates; }
 
 private:
+	void UpdateWantedPhysicalState();
+
 	const SimObjectDef* def;
 
 	const unsigned int objectID;
@@ -60,7 +83,9 @@ private:
 	float mdlRadius;
 
 	LocalModel* mdl;
-	PhysicalState physicalState;
+	PhysicalStateArrays* physicalStates;
+
+	mat44f mat;
 
 	std::list<WantedPhysicalState> wantedPhysicalStates;
 	std::list<PhysicalState> prevPhysicalStates;
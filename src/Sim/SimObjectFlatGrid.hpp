@@ -0,0 +1,221 @@
+#ifndef PFFG_OBJECT_FLATGRID_HDR
+#define PFFG_OBJECT_FLATGRID_HDR
+
+#include <list>
+#include <vector>
+#include <algorithm>
+
+#include "../Math/vec3fwd.hpp"
+#include "../Math/vec3.hpp"
+#include "../System/Debugger.hpp"
+
+// alternative to SimObjectGrid that is not updated incrementally
+// but rebuilt from scratch (by a counting sort over the cells) in
+// one pass over all objects, so the contents of every cell are a
+// contiguous range of one array and moving objects cost no list-
+// or map-node (de)allocations
+//
+// like SimObjectGrid, an object is stored in every cell overlapped
+// by its bounding cube; within a cell, objects keep the order they
+// were passed to Rebuild() in
+template<typename T> class SimObjectFlatGrid {
+public:
+	static SimObjectFlatGrid<T>* GetInstance(const vec3i& size, const vec3f& gmins, const vec3f& gmaxs) {
+		static SimObjectFlatGrid<T>* grid = NULL;
+		static unsigned int depth = 0;
+
+		if (grid == NULL) {
+			PFFG_ASSERT(depth == 0);
+
+			depth += 1;
+			grid = new SimObjectFlatGrid<T>(size, gmins, gmaxs);
+			depth -= 1;
+		}
+
+		return grid;
+	}
+
+	static void FreeInstance(SimObjectFlatGrid<T>* grid) {
+		delete grid;
+	}
+
+
+
+	SimObjectFlatGrid<T>(const vec3i& size, const vec3f& gmins, const vec3f& gmaxs): gsize(size), mins(gmins), maxs(gmaxs) {
+		PFFG_ASSERT(gsize.x > 0);
+		PFFG_ASSERT(gsize.y > 0);
+		PFFG_ASSERT(gsize.z > 0);
+
+		csize.x = (maxs.x - mins.x) / gsize.x;
+		csize.y = (maxs.y - mins.y) / gsize.y;
+		csize.z = (maxs.z - mins.z) / gsize.z;
+
+		cellStarts.resize(gsize.x * gsize.y * gsize.z + 1, 0);
+	}
+	~SimObjectFlatGrid() {
+		cellStarts.clear();
+		cellObjects.clear();
+		nonEmptyCells.clear();
+	}
+
+	// indices of all currently non-empty cells, in ascending order
+	const std::vector<unsigned int>& GetNonEmptyCells() const { return nonEmptyCells; }
+
+	// the objects in the cell with (1D) index <idx>
+	const T* GetCellObjects(unsigned int idx) const { return ((GetNumCellObjects(idx) == 0)? NULL: &cellObjects[cellStarts[idx]]); }
+	unsigned int GetNumCellObjects(unsigned int idx) const { return (cellStarts[idx + 1] - cellStarts[idx]); }
+
+	// get all objects in the CUBE of cells within <radii> of <pos>
+	void GetObjects(const vec3f& pos, const vec3f& radii, std::list<T>& objects) const {
+		const vec3i& cellIdx = GetCellIdx(pos, true);
+		const vec3f& cellSize = GetCellSize();
+		const vec3i numCells((radii.x / cellSize.x) + 1, (radii.y / cellSize.y) + 1, (radii.z / cellSize.z) + 1);
+
+		for (int x = cellIdx.x - numCells.x; x <= cellIdx.x + numCells.x; x++) {
+			for (int y = cellIdx.y - numCells.y; y <= cellIdx.y + numCells.y; y++) {
+				for (int z = cellIdx.z - numCells.z; z <= cellIdx.z + numCells.z; z++) {
+					const vec3i idx(x, y, z);
+
+					if (!IdxInBounds(idx)) {
+						continue;
+					}
+
+					const unsigned int idx1D = GetCellIdx1D(idx);
+					const T* cellObjs = GetCellObjects(idx1D);
+
+					for (unsigned int n = 0; n < GetNumCellObjects(idx1D); n++) {
+						objects.push_back(cellObjs[n]);
+					}
+				}
+			}
+		}
+	}
+
+
+
+	// sort <objects> into the cells overlapped by each
+	// of them, replacing the previous contents of the
+	// grid (objects are not referenced otherwise, so
+	// removed objects only have to be left out)
+	void Rebuild(const std::vector<T>& objects) {
+		objectCellRanges.resize(objects.size() * 2);
+
+		std::fill(cellStarts.begin(), cellStarts.end(), 0);
+
+		// first pass: count the objects per cell (shifted by
+		// one so the prefix-sum yields the start of each cell)
+		for (unsigned int i = 0; i < objects.size(); i++) {
+			const vec3f& objPos = objects[i]->GetPos();
+			const float objRad = objects[i]->GetModelRadius();
+
+			const vec3f minPos(objPos.x - objRad, objPos.y - objRad, objPos.z - objRad);
+			const vec3f maxPos(objPos.x + objRad, objPos.y + objRad, objPos.z + objRad);
+
+			const vec3i minIdx = GetCellIdx(minPos, !PosInBounds(minPos));
+			const vec3i maxIdx = GetCellIdx(maxPos, !PosInBounds(maxPos));
+
+			objectCellRanges[i * 2 + 0] = minIdx;
+			objectCellRanges[i * 2 + 1] = maxIdx;
+
+			for (int x = minIdx.x; x <= maxIdx.x; x++) {
+				for (int y = minIdx.y; y <= maxIdx.y; y++) {
+					for (int z = minIdx.z; z <= maxIdx.z; z++) {
+						cellStarts[GetCellIdx1D(vec3i(x, y, z)) + 1] += 1;
+					}
+				}
+			}
+		}
+
+		nonEmptyCells.clear();
+
+		for (unsigned int idx = 0; idx < (cellStarts.size() - 1); idx++) {
+			if (cellStarts[idx + 1] != 0) {
+				nonEmptyCells.push_back(idx);
+			}
+
+			cellStarts[idx + 1] += cellStarts[idx];
+		}
+
+		// second pass: scatter the objects into their cells
+		// (<cellEnds> is the next free slot of each cell)
+		cellEnds.assign(cellStarts.begin(), cellStarts.end() - 1);
+		cellObjects.resize(cellStarts.back());
+
+		for (unsigned int i = 0; i < objects.size(); i++) {
+			const vec3i& minIdx = objectCellRanges[i * 2 + 0];
+			const vec3i& maxIdx = objectCellRanges[i * 2 + 1];
+
+			for (int x = minIdx.x; x <= maxIdx.x; x++) {
+				for (int y = minIdx.y; y <= maxIdx.y; y++) {
+					for (int z = minIdx.z; z <= maxIdx.z; z++) {
+						cellObjects[cellEnds[GetCellIdx1D(vec3i(x, y, z))]++] = objects[i];
+					}
+				}
+			}
+		}
+	}
+
+
+
+	bool IdxInBounds(const vec3i& idx) const {
+		return
+			(idx.x >= 0 && idx.x < gsize.x) &&
+			(idx.y >= 0 && idx.y < gsize.y) &&
+			(idx.z >= 0 && idx.z < gsize.z);
+	}
+	bool PosInBounds(const vec3f& pos) const {
+		return (IdxInBounds(GetCellIdx(pos, false)));
+	}
+
+	// return the index of the cell that
+	// contains spatial position <pos>
+	// (optionally clamped, see SimObjectGrid)
+	vec3i GetCellIdx(const vec3f& pos, bool clamp = false) const {
+		vec3i idx;
+			idx.x = int(((pos.x - mins.x) / (maxs.x - mins.x)) * gsize.x);
+			idx.y = int(((pos.y - mins.y) / (maxs.y - mins.y)) * gsize.y);
+			idx.z = int(((pos.z - mins.z) / (maxs.z - mins.z)) * gsize.z);
+
+		if (clamp) {
+			idx.x = std::max(0, std::min(gsize.x - 1, idx.x));
+			idx.y = std::max(0, std::min(gsize.y - 1, idx.y));
+			idx.z = std::max(0, std::min(gsize.z - 1, idx.z));
+		}
+
+		return idx;
+	}
+
+	// uses indexing scheme z * (W * H) + y * (W) + x
+	// note: assumes index-vector is in-bounds
+	unsigned int GetCellIdx1D(const vec3i& idx) const {
+		return (idx.z * (gsize.x * gsize.y) + idx.y * (gsize.x) + idx.x);
+	}
+
+
+	const vec3i& GetGridSize() const { return gsize; }
+	const vec3f& GetCellSize() const { return csize; }
+
+private:
+	// the objects of cell <i> are stored in the range
+	// [cellStarts[i], cellStarts[i + 1]) of cellObjects
+	std::vector<unsigned int> cellStarts;
+	std::vector<unsigned int> cellEnds;
+	std::vector<T> cellObjects;
+	std::vector<unsigned int> nonEmptyCells;
+
+	// the minimum and maximum overlapped cell of every
+	// object passed to Rebuild() (kept between the two
+	// passes so they need not be computed twice)
+	std::vector<vec3i> objectCellRanges;
+
+	// number of cells along each dimension
+	vec3i gsize;
+	// spatial size per dimension of each cell
+	vec3f csize;
+
+	// spatial extends of the grid
+	vec3f mins;
+	vec3f maxs;
+};
+
+#endif
@@ -159,10 +159,11 @@ public:
 			if (cell.IsEmpty()) {
 				nonEmptyCells.erase(cell.GetListIt());
 			}
-
-			objCells.erase(it->first);
 		}
 
+		// note: erasing inside the loop would invalidate <it>
+		objCells.clear();
+
 		/*
 		const vec3f& pos = object->GetPos();
 		const vec3i& idx = GetCellIdx(pos, !PosInBounds(pos));
@@ -1,8 +1,11 @@
+#include <algorithm>
+
 #include "./SimObjectHandler.hpp"
 #include "./SimObject.hpp"
 #include "./SimObjectDef.hpp"
 #include "./SimObjectDefHandler.hpp"
 #include "./SimObjectGrid.hpp"
+#include "./SimObjectFlatGrid.hpp"
 #include "./SimThread.hpp"
 #include "../Map/Ground.hpp"
 #include "../Map/ReadMap.hpp"
@@ -11,6 +14,7 @@
 #include "../System/IEvent.hpp"
 #include "../System/EventHandler.hpp"
 #include "../System/Debugger.hpp"
+#include "../System/WorkerPool.hpp"
 
 SimObjectHandler* SimObjectHandler::GetInstance() {
 	static SimObjectHandler* soh = NULL;
@@ -38,7 +42,15 @@ SimObjectHandler::SimObjectHandler() {
 	const LuaTable* objectsTable = rootTable->GetTblVal("objects");
 
 	simObjects.resize(unsigned(objectsTable->GetFltVal("maxObjects", 10000)), NULL);
+	physicalStates.Resize(simObjects.size());
+
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	simObjectGridObjects.reserve(simObjects.size());
+	#else
 	simObjectGridCells.resize(simObjects.size());
+	#endif
+
+	collisionBands.resize(simObjects.size(), std::make_pair(1, 0));
 
 	for (unsigned int i = 0; i < simObjects.size(); i++) {
 		simObjectFreeIDs.insert(i);
@@ -52,7 +64,15 @@ SimObjectHandler::SimObjectHandler() {
 	const vec3f  objectGridMins = vec3f(                                0.0f, -1e6f,                                 0.0f);
 	const vec3f  objectGridMaxs = vec3f(readMap->mapx * readMap->SQUARE_SIZE,  1e6f, readMap->mapy * readMap->SQUARE_SIZE);
 
-	mSimObjectGrid = SimObjectGrid<const SimObject*>::GetInstance(numObjectGridCells, objectGridMins, objectGridMaxs);
+	mSimObjectGrid = ObjectGrid::GetInstance(numObjectGridCells, objectGridMins, objectGridMaxs);
+
+	unsigned int numUpdateThreads = objectsTable->GetFltVal("numUpdateThreads", 1);
+
+	if (numUpdateThreads == 0) {
+		numUpdateThreads = WorkerPool::GetNumHardwareThreads();
+	}
+
+	mWorkerPool = new WorkerPool(numUpdateThreads);
 }
 
 void SimObjectHandler::AddObjects() {
@@ -74,42 +94,112 @@ void SimObjectHandler::AddObjects() {
 			AddObject(def->GetID(), teamID, pos, dir, true);
 		}
 	}
+
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	RebuildSimObjectGrid();
+	#endif
 }
 
 SimObjectHandler::~SimObjectHandler() {
 	simObjectFreeIDs.clear();
 	simObjectUsedIDs.clear();
 	simObjects.clear();
+
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	simObjectGridObjects.clear();
+	#else
 	simObjectGridCells.clear();
+	#endif
 
 	mSimObjectDefHandler->DelDefs();
 	SimObjectDefHandler::FreeInstance(mSimObjectDefHandler);
 
-	SimObjectGrid<const SimObject*>::FreeInstance(mSimObjectGrid);
+	ObjectGrid::FreeInstance(mSimObjectGrid);
+
+	delete mWorkerPool;
+	mWorkerPool = NULL;
 }
 
 void SimObjectHandler::DelObjects() {
 	while (!simObjectUsedIDs.empty()) {
 		DelObject(simObjects[ *(simObjectUsedIDs.begin()) ], true);
 	}
+
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	RebuildSimObjectGrid();
+	#endif
 }
 
+struct IntegrateJob: public IWorkerJob {
+	IntegrateJob(PhysicalStateArrays* s, unsigned int m, unsigned int n): states(s), numObjectIDs(m), numItems(n) {}
+
+	void Execute(unsigned int itemIdx, unsigned int) {
+		states->Integrate((numObjectIDs * itemIdx) / numItems, (numObjectIDs * (itemIdx + 1)) / numItems);
+	}
+
+	PhysicalStateArrays* states;
+
+	unsigned int numObjectIDs;
+	unsigned int numItems;
+};
+
+// every object is integrated independently (in parallel if the
+// pool has more than one worker), after which all changes to the
+// object-grid, the collision-checks and any events they cause are
+// made on this thread in object-ID order, so the outcome does not
+// depend on the number of threads
+//
+// the flat grid is rebuilt here at the end of every frame, and by
+// AddObject and DelObject whenever they are called between frames
+// (eg. for sim-commands), so queries never see freed or miss new
+// objects and GetSimObjectGrid never has to modify it
 void SimObjectHandler::Update(unsigned int frame) {
-	for (std::set<unsigned int>::const_iterator it = simObjectUsedIDs.begin(); it != simObjectUsedIDs.end(); ++it) {
-		SimObject* o = simObjects[*it];
+	#if (SIMOBJECT_TRACE_FRAME_COUNT > 0)
+	if ((frame % SIMOBJECT_TRACE_FRAME_INTERVAL) == 0) {
+		for (std::set<unsigned int>::const_iterator it = simObjectUsedIDs.begin(); it != simObjectUsedIDs.end(); ++it) {
+			simObjects[*it]->UpdatePrevPhysicalStates();
+		}
+	}
+	#endif
+
+	if (!simObjectUsedIDs.empty()) {
+		// free slots below the highest used ID are skipped by Integrate
+		IntegrateJob job(&physicalStates, *(simObjectUsedIDs.rbegin()) + 1, mWorkerPool->GetNumWorkers());
+
+		mWorkerPool->Run(&job, job.numItems);
+	}
 
-		const unsigned int objectID = o->GetID();
-		const bool objectMoved = o->HasMoved();
+	// matrices of the objects that Integrate may have changed
+	for (std::set<unsigned int>::const_iterator it = simObjectUsedIDs.begin(); it != simObjectUsedIDs.end(); ++it) {
+		if ((physicalStates.enabled[*it] & physicalStates.hasWantedState[*it]) == 0) {
+			continue;
+		}
 
-		o->Update();
+		simObjects[*it]->UpdateMat();
+	}
 
-		if (objectMoved) {
-			mSimObjectGrid->DelObject(o, simObjectGridCells[objectID] );
-			mSimObjectGrid->AddObject(o, simObjectGridCells[objectID] );
+	// objects moved by Integrate or by call-outs since the last update
+	for (std::set<unsigned int>::const_iterator it = simObjectUsedIDs.begin(); it != simObjectUsedIDs.end(); ++it) {
+		if (physicalStates.moved[*it] == 0) {
+			continue;
 		}
+
+		physicalStates.moved[*it] = 0;
+
+		#if (SIMOBJECT_FLAT_GRID == 0)
+		const SimObject* o = simObjects[*it];
+
+		mSimObjectGrid->DelObject(o, simObjectGridCells[o->GetID()] );
+		mSimObjectGrid->AddObject(o, simObjectGridCells[o->GetID()] );
+		#endif
 	}
 
 	CheckSimObjectCollisions(frame);
+
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	// moved, added and deleted objects are re-sorted all at once
+	RebuildSimObjectGrid();
+	#endif
 }
 
 
@@ -118,15 +208,14 @@ void SimObjectHandler::AddObject(unsigned int defID, unsigned int teamID, const
 	if (!simObjectFreeIDs.empty()) {
 		vec3f gpos = pos;
 			gpos.y = ground->GetHeight(pos.x, pos.z);
-		mat44f mat = mat44f(gpos, NVECf, NVECf, dir);
-			mat.SetYDirXZ(ground->GetSmoothNormal(gpos.x, gpos.z));
-		WantedPhysicalState wps;
-			wps.wantedPos = mat.GetPos();
-			wps.wantedDir = mat.GetZDir();
 
 		SimObjectDef* sod = mSimObjectDefHandler->GetDef(defID);
-		SimObject* so = new SimObject(sod, *(simObjectFreeIDs.begin()), teamID);
-			so->SetMat(mat);
+		SimObject* so = new SimObject(sod, *(simObjectFreeIDs.begin()), teamID, &physicalStates);
+			so->SetPos(gpos);
+			so->SetDirs(dir, ground->GetSmoothNormal(gpos.x, gpos.z));
+		WantedPhysicalState wps;
+			wps.wantedPos = so->GetPos();
+			wps.wantedDir = so->GetDir();
 			so->PushWantedPhysicalState(wps, false, false);
 
 		AddObject(so, inConstructor);
@@ -147,7 +236,14 @@ void SimObjectHandler::AddObject(SimObject* o, bool inConstructor) {
 	simObjectUsedIDs.insert(o->GetID());
 	simObjectFreeIDs.erase(o->GetID());
 
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	// AddObjects rebuilds the grid once for all initial objects
+	if (!inConstructor) {
+		RebuildSimObjectGrid();
+	}
+	#else
 	mSimObjectGrid->AddObject(o, simObjectGridCells[o->GetID()] );
+	#endif
 
 	SimObjectCreatedEvent e(((inConstructor)? 0: sThread->GetFrame()), o->GetID());
 	eventHandler->NotifyReceivers(&e);
@@ -160,8 +256,22 @@ void SimObjectHandler::DelObject(SimObject* o, bool inDestructor) {
 	simObjectUsedIDs.erase(o->GetID());
 	simObjectFreeIDs.insert(o->GetID());
 
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	// DelObjects rebuilds the grid once after all objects are gone
+	if (!inDestructor) {
+		RebuildSimObjectGrid();
+	}
+	#else
 	mSimObjectGrid->DelObject( o, simObjectGridCells[o->GetID()] );
 	simObjectGridCells[o->GetID()].clear();
+	#endif
+
+	// the object must not be found by any query once it is freed
+	PFFG_ASSERT(inDestructor || GetClosestSimObject(o->GetPos(), 1.0f) != o);
+
+	// drops the object's collision entries on the next check
+	collisionBands[o->GetID()] = std::make_pair(1, 0);
+	physicalStates.FreeObject(o->GetID());
 
 	SimObjectDestroyedEvent e(((inDestructor)? -1: sThread->GetFrame()), o->GetID());
 	eventHandler->NotifyReceivers(&e);
@@ -172,12 +282,24 @@ void SimObjectHandler::DelObject(SimObject* o, bool inDestructor) {
 
 
 
+#if (SIMOBJECT_FLAT_GRID == 1)
+void SimObjectHandler::RebuildSimObjectGrid() {
+	simObjectGridObjects.clear();
+
+	for (std::set<unsigned int>::const_iterator it = simObjectUsedIDs.begin(); it != simObjectUsedIDs.end(); ++it) {
+		simObjectGridObjects.push_back(simObjects[*it]);
+	}
+
+	mSimObjectGrid->Rebuild(simObjectGridObjects);
+}
+#endif
+
 // get the single closest object within <radius> of <pos>
 const SimObject* SimObjectHandler::GetClosestSimObject(const vec3f& pos, float radius) const {
 	const SimObject* closestObject = NULL;
 
 	std::list<const SimObject*> objects;
-	mSimObjectGrid->GetObjects(pos, vec3f(radius, 0.0f, radius), objects);
+	GetSimObjectGrid()->GetObjects(pos, vec3f(radius, 0.0f, radius), objects);
 
 	for (std::list<const SimObject*>::const_iterator it = objects.begin(); it != objects.end(); ++it) {
 		const vec3f& objPos = (*it)->GetPos();
@@ -197,59 +319,170 @@ const SimObject* SimObjectHandler::GetClosestSimObject(const vec3f& pos, float r
 
 
 
+// sort-and-sweep along the x-axis, per band of grid-rows along the
+// z-axis (sweeping the whole map at once would test every object
+// against all others in its x-slice): each object is entered into
+// the bands its z-extent overlaps, all entries are sorted by band
+// and then by the lower bound of their x-extent, and every entry
+// is tested only against those that follow it in the same band up
+// to the first one starting beyond its upper x-bound
+//
+// two objects can share more than one band, so a pair is reported
+// only in the band containing the lower z-bound of their overlap
+//
+// objects move little between frames, so the entries are kept in
+// their last order and re-sorted incrementally (which is close to
+// linear); the entries that have to be added are sorted separately
+// and merged in
 unsigned int SimObjectHandler::CheckSimObjectCollisions(unsigned int frame) {
-	typedef const SimObject* Obj;
-	typedef SimObjectGrid<Obj>::GridCell ObjCell;
-
-	unsigned int numCollisions = 0;
+	const float bandSize = mSimObjectGrid->GetCellSize().z;
+	const int numBands = mSimObjectGrid->GetGridSize().z;
 
-	const std::list<ObjCell*>& cells = mSimObjectGrid->GetNonEmptyCells();
+	unsigned int numEntries = 0;
 
-	for (std::list<ObjCell*>::const_iterator cit = cells.begin(); cit != cells.end(); ++cit) {
-		const ObjCell* cell = *cit;
-		const std::list<Obj> objects = cell->GetObjects();
+	// refresh the entries of the last frame (in their old order),
+	// dropping those of deleted objects and of bands that objects
+	// no longer overlap
+	for (unsigned int i = 0; i < collisionSortKeys.size(); i++) {
+		const CollisionSortKey& key = collisionSortKeys[i];
 
-		if (objects.size() == 1) {
+		if (key.band < collisionBands[key.objectID].first || key.band > collisionBands[key.objectID].second) {
 			continue;
 		}
 
-		std::list<Obj>::const_iterator colliderIt = objects.begin();
-		std::list<Obj>::const_iterator collideeIt;
+		const SimObject* o = simObjects[key.objectID];
 
-		const SimObject* collider = NULL;
-		const SimObject* collidee = NULL;
+		const vec3f& pos = o->GetPos();
+		const float rad = o->GetModelRadius();
 
-		float colliderRadius = 0.0f;
-		float collideeRadius = 0.0f;
+		const int minBand = std::max(0, std::min(numBands - 1, int((pos.z - rad) / bandSize)));
+		const int maxBand = std::max(0, std::min(numBands - 1, int((pos.z + rad) / bandSize)));
 
-		float dstSq = 0.0f; // squared distance between positions
-		float radSq = 0.0f; // squared radius of both spheres
+		if (key.band < minBand || key.band > maxBand) {
+			continue;
+		}
 
-		// within each cell, check only the unique pairs
-		for (; colliderIt != objects.end(); ++colliderIt) {
-			collideeIt = colliderIt; ++collideeIt;
+		collisionSortKeys[numEntries++] = CollisionSortKey(key.band, pos.x - rad, key.objectID);
+	}
 
-			collider = *colliderIt;
-			colliderRadius = collider->GetModelRadius();
+	collisionSortKeys.resize(numEntries);
+	collisionAddedKeys.clear();
 
-			for (; collideeIt != objects.end(); ++collideeIt) {
-				collidee = *collideeIt;
-				collideeRadius = collidee->GetModelRadius();
+	// add the entries of new objects and newly overlapped bands
+	for (std::set<unsigned int>::const_iterator it = simObjectUsedIDs.begin(); it != simObjectUsedIDs.end(); ++it) {
+		const SimObject* o = simObjects[*it];
 
-				dstSq = (collider->GetPos() - collidee->GetPos()).sqLen3D();
-				radSq = (colliderRadius + collideeRadius) * (colliderRadius + collideeRadius);
+		const vec3f& pos = o->GetPos();
+		const float rad = o->GetModelRadius();
 
-				if (dstSq < radSq) {
-					numCollisions += 1;
+		const std::pair<int, int>& prevBands = collisionBands[*it];
+		const std::pair<int, int>  currBands = std::make_pair(
+			std::max(0, std::min(numBands - 1, int((pos.z - rad) / bandSize))),
+			std::max(0, std::min(numBands - 1, int((pos.z + rad) / bandSize)))
+		);
 
-					SimObjectCollisionEvent e(frame, collider->GetID(), collidee->GetID());
-					eventHandler->NotifyReceivers(&e);
-				}
+		for (int band = currBands.first; band <= currBands.second; band++) {
+			if (band >= prevBands.first && band <= prevBands.second) {
+				continue;
 			}
+
+			collisionAddedKeys.push_back(CollisionSortKey(band, pos.x - rad, *it));
+		}
+
+		collisionBands[*it] = currBands;
+	}
+
+	// insertion-sort the refreshed entries
+	for (unsigned int i = 1; i < numEntries; i++) {
+		const CollisionSortKey key = collisionSortKeys[i];
+
+		unsigned int j = i;
+
+		for (; j > 0 && key < collisionSortKeys[j - 1]; j--) {
+			collisionSortKeys[j] = collisionSortKeys[j - 1];
+		}
+
+		collisionSortKeys[j] = key;
+	}
+
+	std::sort(collisionAddedKeys.begin(), collisionAddedKeys.end());
+
+	// merge the added entries in (from the back)
+	collisionSortKeys.resize(numEntries + collisionAddedKeys.size());
+
+	for (int i = numEntries - 1, j = collisionAddedKeys.size() - 1, k = collisionSortKeys.size() - 1; j >= 0; k--) {
+		if (i >= 0 && collisionAddedKeys[j] < collisionSortKeys[i]) {
+			collisionSortKeys[k] = collisionSortKeys[i--];
+		} else {
+			collisionSortKeys[k] = collisionAddedKeys[j--];
+		}
+	}
+
+	numEntries = collisionSortKeys.size();
+
+	// pack the positions and radii in sweep-order
+	collisionPosX.resize(numEntries);
+	collisionPosY.resize(numEntries);
+	collisionPosZ.resize(numEntries);
+	collisionRadii.resize(numEntries);
+
+	for (unsigned int i = 0; i < numEntries; i++) {
+		const SimObject* o = simObjects[collisionSortKeys[i].objectID];
+
+		collisionPosX[i] = o->GetPos().x;
+		collisionPosY[i] = o->GetPos().y;
+		collisionPosZ[i] = o->GetPos().z;
+		collisionRadii[i] = o->GetModelRadius();
+	}
+
+	unsigned int numPairs = 0;
+
+	for (unsigned int i = 0; i < numEntries; i++) {
+		const int band = collisionSortKeys[i].band;
+		const float maxX = collisionPosX[i] + collisionRadii[i];
+		const float minZ = collisionPosZ[i] - collisionRadii[i];
+
+		unsigned int j = i + 1;
+
+		while (j < numEntries && collisionSortKeys[j].band == band && collisionSortKeys[j].minX <= maxX) {
+			j++;
+		}
+
+		// every candidate might collide, so reserve room for
+		// all of them and let the (branch-free) sphere test
+		// only advance the pair count for actual collisions
+		if (collisionPairs.size() < (numPairs + (j - i - 1))) {
+			collisionPairs.resize((numPairs + (j - i - 1)) * 2);
 		}
+
+		for (unsigned int k = i + 1; k < j; k++) {
+			const float dx = collisionPosX[k] - collisionPosX[i];
+			const float dy = collisionPosY[k] - collisionPosY[i];
+			const float dz = collisionPosZ[k] - collisionPosZ[i];
+			const float rs = collisionRadii[k] + collisionRadii[i];
+
+			const int pairBand = std::max(0, std::min(numBands - 1, int(std::max(minZ, collisionPosZ[k] - collisionRadii[k]) / bandSize)));
+
+			collisionPairs[numPairs] = std::make_pair(i, k);
+			numPairs += (((dx * dx + dy * dy + dz * dz) < (rs * rs)) & (pairBand == band));
+		}
+	}
+
+	collisionObjectIDs.resize(numPairs);
+
+	for (unsigned int n = 0; n < numPairs; n++) {
+		const unsigned int objectIDa = collisionSortKeys[collisionPairs[n].first].objectID;
+		const unsigned int objectIDb = collisionSortKeys[collisionPairs[n].second].objectID;
+
+		collisionObjectIDs[n] = std::make_pair(std::min(objectIDa, objectIDb), std::max(objectIDa, objectIDb));
+	}
+
+	if (numPairs > 0) {
+		SimObjectCollisionEvent e(frame, &collisionObjectIDs);
+		eventHandler->NotifyReceivers(&e);
 	}
 
-	return numCollisions;
+	return numPairs;
 }
 
 void SimObjectHandler::PredictSimObjectCollisions(unsigned int numFrames) {
@@ -6,14 +6,29 @@
 #include <list>
 #include <vector>
 
+#include "./SimObjectState.hpp"
 #include "../Math/vec3fwd.hpp"
 
+// whether objects are kept in a grid that is rebuilt once per
+// frame into one flat array (SimObjectFlatGrid) rather than in
+// one that is updated per moved object (SimObjectGrid)
+// (see TestSimObjectGrids.cpp for a comparison of the two)
+#define SIMOBJECT_FLAT_GRID 1
+
 class SimObject;
 class SimObjectDefHandler;
+class WorkerPool;
 template<typename T> class SimObjectGrid;
+template<typename T> class SimObjectFlatGrid;
 
 class SimObjectHandler {
 public:
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	typedef SimObjectFlatGrid<const SimObject*> ObjectGrid;
+	#else
+	typedef SimObjectGrid<const SimObject*> ObjectGrid;
+	#endif
+
 	SimObjectHandler();
 	~SimObjectHandler();
 
@@ -35,7 +50,7 @@ public:
 	bool IsValidSimObjectID(unsigned int id) const { return ((id < GetMaxSimObjects()) && (simObjects[id] != NULL)); }
 
 	SimObject* GetSimObject(unsigned int id) const { return simObjects[id]; }
-	SimObjectGrid<const SimObject*>* GetSimObjectGrid() const { return mSimObjectGrid; }
+	ObjectGrid* GetSimObjectGrid() const { return mSimObjectGrid; }
 
 	const SimObject* GetClosestSimObject(const vec3f&, float) const;
 
@@ -46,16 +61,67 @@ private:
 	unsigned int CheckSimObjectCollisions(unsigned int);
 	void PredictSimObjectCollisions(unsigned int);
 
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	void RebuildSimObjectGrid();
+	#endif
+
 	std::vector<SimObject*> simObjects;
+
+	// the physical state of every object (indexed by ID)
+	PhysicalStateArrays physicalStates;
+
+	#if (SIMOBJECT_FLAT_GRID == 1)
+	// the objects the grid was last rebuilt from (at the end of
+	// Update and on every AddObject or DelObject between frames)
+	std::vector<const SimObject*> simObjectGridObjects;
+	#else
 	// for each object, keep track of the cells it occupies
 	// objectID: {cell index ==> cell object-list iterator}
 	std::vector<  std::map<unsigned int, std::list<const SimObject*>::iterator>  > simObjectGridCells;
+	#endif
 
 	std::set<unsigned int> simObjectFreeIDs;
 	std::set<unsigned int> simObjectUsedIDs;
 
+	struct CollisionSortKey {
+		CollisionSortKey(): band(0), minX(0.0f), objectID(0) {}
+		CollisionSortKey(int b, float x, unsigned int id): band(b), minX(x), objectID(id) {}
+
+		bool operator < (const CollisionSortKey& k) const {
+			if (band != k.band) { return (band < k.band); }
+			if (minX != k.minX) { return (minX < k.minX); }
+			return (objectID < k.objectID);
+		}
+
+		int band;
+		float minX;
+		unsigned int objectID;
+	};
+
+	// buffers of CheckSimObjectCollisions, kept to reuse their
+	// memory: the sort-key of every {band, object} entry in
+	// sweep-order, the packed positions and radii in the same
+	// order, the colliding pairs (as indices into these) and
+	// the same pairs as object-IDs (sent in one event)
+	//
+	// the entries are also kept between frames, along with the
+	// range of bands each object has entries for (empty for new
+	// objects) so that only the differences have to be applied
+	std::vector<CollisionSortKey> collisionSortKeys;
+	std::vector<CollisionSortKey> collisionAddedKeys;
+	std::vector< std::pair<int, int> > collisionBands;
+	std::vector<float> collisionPosX;
+	std::vector<float> collisionPosY;
+	std::vector<float> collisionPosZ;
+	std::vector<float> collisionRadii;
+	std::vector< std::pair<unsigned int, unsigned int> > collisionPairs;
+	std::vector< std::pair<unsigned int, unsigned int> > collisionObjectIDs;
+
 	SimObjectDefHandler* mSimObjectDefHandler;
-	SimObjectGrid<const SimObject*>* mSimObjectGrid;
+	ObjectGrid* mSimObjectGrid;
+
+	// integrates the physical states, see Update()
+	WorkerPool* mWorkerPool;
 };
 
 #define simObjectHandler (SimObjectHandler::GetInstance())
@@ -1,109 +1,205 @@
+#include <cmath>
+#include <algorithm>
+
 #include "./SimObjectState.hpp"
-#include "./SimObject.hpp"
 #include "./SimObjectDef.hpp"
 #include "../Math/Trig.hpp"
 #include "../Map/Ground.hpp"
 
-void PhysicalState::Update(const SimObject* owner) {
-	if (!enabled || (owner->GetWantedPhysicalStates()).empty()) {
-		return;
-	}
+// turns smaller than this are not made at all
+static const float MIN_TURNING_ANGLE_COS = cosf(DEG2RAD(1.0f));
+
+void PhysicalStateArrays::Resize(unsigned int numObjects) {
+	positions.resize(numObjects);
+	forwardDirs.resize(numObjects);
+	upDirs.resize(numObjects);
+	speeds.resize(numObjects, 0.0f);
+
+	wantedDirs.resize(numObjects);
+	wantedSpeeds.resize(numObjects, 0.0f);
+
+	maxForwardSpeeds.resize(numObjects, 0.0f);
+	maxAccelerationRates.resize(numObjects, 0.0f);
+	maxDeccelerationRates.resize(numObjects, 0.0f);
+	maxTurningRateCos.resize(numObjects, 1.0f);
+	maxTurningRateSin.resize(numObjects, 0.0f);
+
+	enabled.resize(numObjects, 0);
+	hasWantedState.resize(numObjects, 0);
+	moved.resize(numObjects, 0);
+
+	slopes.resize(numObjects, 0.0f);
+}
+
+void PhysicalStateArrays::InitObject(unsigned int objectID, const SimObjectDef* def) {
+	positions[objectID] = NVECf;
+	forwardDirs[objectID] = ZVECf;
+	upDirs[objectID] = YVECf;
+	speeds[objectID] = 0.0f;
+
+	wantedDirs[objectID] = ZVECf;
+	wantedSpeeds[objectID] = 0.0f;
+
+	maxForwardSpeeds[objectID] = def->GetMaxForwardSpeed();
+	maxAccelerationRates[objectID] = def->GetMaxAccelerationRate();
+	maxDeccelerationRates[objectID] = def->GetMaxDeccelerationRate();
+	maxTurningRateCos[objectID] = cosf(DEG2RAD(def->GetMaxTurningRate()));
+	maxTurningRateSin[objectID] = sinf(DEG2RAD(def->GetMaxTurningRate()));
+
+	enabled[objectID] = 1;
+	hasWantedState[objectID] = 0;
+	moved[objectID] = 0;
+}
+
+void PhysicalStateArrays::FreeObject(unsigned int objectID) {
+	// excludes the object's slot from Integrate
+	enabled[objectID] = 0;
+	hasWantedState[objectID] = 0;
+	moved[objectID] = 0;
+}
+
+// set an object's forward and up axes, making the forward
+// axis orthogonal to the up axis (see mat44::SetYDirXZ)
+void PhysicalStateArrays::SetObjectDirs(unsigned int objectID, const vec3f& fdir, const vec3f& udir) {
+	const vec3f ydir = udir;
+	const vec3f xdir = ((fdir.cross(ydir)).inorm3D());
+	const vec3f zdir = ((ydir.cross(xdir)).inorm3D());
 
-	const SimObjectDef* def = owner->GetDef();
-	const WantedPhysicalState& wps = owner->GetWantedPhysicalState(true);
-	const vec3f& wantedDir = wps.wantedDir;
-
-	vec3f currentPos = mat.GetPos();
-	vec3f forwardDir = mat.GetZDir();
-		forwardDir.y = 0.0f;
-		forwardDir.inorm2D();
-
-	// figure out whether to turn left or right to match wantedDir
-	//
-	// the WORLD-space coordinate system is inverted along the Z-axis
-	// (ie. has its origin in the top-left corner) with respect to the
-	// mathematical definition (where the origin lies bottom-left); the
-	// OBJECT-space coordinate system is inverted along the X-axis with
-	// respect to the world-space coordinate system
-	//
-	// therefore, to get the proper angles wrt. the mathematical x-axis
-	// that atan2 uses we need to flip the sign of both forwardDir.x AND
-	// forwardDir.z
-	//
-	if (def->GetMaxTurningRate() != 0.0f) {
-		float forwardGlobalAngleRad = atan2f(-forwardDir.z, -forwardDir.x);
-		float wantedGlobalAngleRad = atan2f(-wantedDir.z, -wantedDir.x);
-		float deltaGlobalAngleRad = 0.0f;
-
-		if (forwardGlobalAngleRad < 0.0f) { forwardGlobalAngleRad += (M_PI * 2.0f); }
-		if (wantedGlobalAngleRad < 0.0f) { wantedGlobalAngleRad += (M_PI * 2.0f); }
-
-		deltaGlobalAngleRad = (forwardGlobalAngleRad - wantedGlobalAngleRad);
-
-		// take the shorter of the two possible turns
-		// (positive angle means a right turn and vv)
-		if (deltaGlobalAngleRad >  M_PI) { deltaGlobalAngleRad = -((M_PI * 2.0f) - deltaGlobalAngleRad); }
-		if (deltaGlobalAngleRad < -M_PI) { deltaGlobalAngleRad =  ((M_PI * 2.0f) + deltaGlobalAngleRad); }
-
-		const bool  instaTurn = (std::fabs(deltaGlobalAngleRad) <= DEG2RAD(def->GetMaxTurningRate()));
-		const float turnAngle = instaTurn? deltaGlobalAngleRad: DEG2RAD(def->GetMaxTurningRate());
-
-		if (std::fabs(turnAngle) > DEG2RAD(1.0f)) {
-			mat.RotateY(turnAngle * ((deltaGlobalAngleRad > 0.0f)? 1.0f: -1.0f));
+	forwardDirs[objectID] = zdir;
+	upDirs[objectID] = ydir;
+}
+
+
+
+// advance every object in the slot-range [minObjectID, maxObjectID)
+// that has physics updates enabled and some wanted state by one frame
+// (objects only touch their own slots, so disjoint ranges can be run
+// concurrently, see SimObjectHandler::Update)
+//
+// the terrain is sampled in separate passes before and after the one
+// that turns and accelerates the objects, which thereby involves no
+// calls and no trigonometry
+void PhysicalStateArrays::Integrate(unsigned int minObjectID, unsigned int maxObjectID) {
+	for (unsigned int i = minObjectID; i < maxObjectID; i++) {
+		if ((enabled[i] & hasWantedState[i]) == 0) {
+			continue;
 		}
-	}
 
-	{
-		// slope lies in [0=horizontal, 1=vertical],
-		// so we have no information about the sign
-		const float zdiry = (mat.GetZDir()).y;
-		const float slope = ground->GetSlope(currentPos.x, currentPos.z);
-
-		// slow down on positive slopes, speed up on negative slopes
-		//    positive slope and forward  motion ==> slow down to lower  positive speed
-		//    positive slope and backward motion ==> speed up  to higher negative speed
-		//    negative slope and forward  motion ==> speed up  to higher positive speed
-		//    negative slope and backward motion ==> slow down to lower  negative speed
-		const bool forwardMotion = (speed >  0.05f);
-		const bool bckwardMotion = (speed < -0.05f);
-		const bool positiveSlope = (zdiry >  0.05f);
-		const bool negativeSlope = (zdiry < -0.05f);
-
-		const bool allowSlopeAcc =
-			(forwardMotion && negativeSlope && (speed < def->GetMaxForwardSpeed() * 1.75f)) ||
-			(bckwardMotion && positiveSlope && (speed < def->GetMaxForwardSpeed() * 1.75f));
-		const bool allowSlopeDec =
-			(forwardMotion && positiveSlope && (speed > def->GetMaxForwardSpeed() * 0.25f)) ||
-			(bckwardMotion && negativeSlope && (speed > def->GetMaxForwardSpeed() * 0.25f));
-
-		if (allowSlopeAcc) { speed += (speed * slope * (forwardMotion?  1.0f: -1.0f)); }
-		if (allowSlopeDec) { speed -= (speed * slope * (bckwardMotion? -1.0f:  1.0f)); }
+		slopes[i] = ground->GetSlope(positions[i].x, positions[i].z);
 	}
 
-	if (wps.wantedSpeed >= 0.0f) {
-		if (speed <= wps.wantedSpeed) {
-			// accelerate (at maximum acceleration-rate) to match wantedSpeed
-			speed += def->GetMaxAccelerationRate();
-			speed = std::min(speed, wps.wantedSpeed);
-		} else {
-			// deccelerate (at maximum decceleration-rate) to match wantedSpeed
-			speed -= def->GetMaxDeccelerationRate();
-			speed = std::max(speed, 0.0f);
+	for (unsigned int i = minObjectID; i < maxObjectID; i++) {
+		if ((enabled[i] & hasWantedState[i]) == 0) {
+			continue;
+		}
+
+		      vec3f& zdir = forwardDirs[i];
+		const vec3f& ydir = upDirs[i];
+		const vec3f& wdir = wantedDirs[i];
+
+		{
+			// cosine and sine of the angle between the horizontal
+			// forward and wanted directions; the sine is positive
+			// when turning right would be the shorter way, which
+			// is the positive rotation about the object's y-axis
+			//
+			// (the WORLD-space coordinate system is inverted along
+			// the Z-axis with respect to the mathematical one, and
+			// OBJECT-space is inverted along the X-axis with respect
+			// to world-space, so this is the sign of the 2D cross-
+			// product of wdir and zdir rather than of zdir and wdir)
+			const float sqLenProduct = (zdir.x * zdir.x + zdir.z * zdir.z) * (wdir.x * wdir.x + wdir.z * wdir.z);
+			const float invLenProduct = (sqLenProduct > 0.0f)? (1.0f / sqrtf(sqLenProduct)): 0.0f;
+
+			const float turnAngleCos = (sqLenProduct > 0.0f)? ((zdir.x * wdir.x + zdir.z * wdir.z) * invLenProduct): 1.0f;
+			const float turnAngleSin = (wdir.x * zdir.z - wdir.z * zdir.x) * invLenProduct;
+
+			// turn by no more than the maximum turning-rate, and
+			// only if the resulting turn exceeds one degree
+			if (turnAngleCos < MIN_TURNING_ANGLE_COS && maxTurningRateCos[i] < MIN_TURNING_ANGLE_COS) {
+				const bool  instaTurn = (turnAngleCos >= maxTurningRateCos[i]);
+				const float rotAngleCos = instaTurn? turnAngleCos: maxTurningRateCos[i];
+				const float rotAngleSin = instaTurn? turnAngleSin: ((turnAngleSin >= 0.0f)? maxTurningRateSin[i]: -maxTurningRateSin[i]);
+
+				// rotate the forward axis toward the side-axis
+				// (the same rotation as mat44::RotateY)
+				const vec3f xdir = zdir.cross(ydir);
+
+				zdir = (zdir * rotAngleCos) - (xdir * rotAngleSin);
+			}
+		}
+
+		float& speed = speeds[i];
+
+		{
+			// slope lies in [0=horizontal, 1=vertical],
+			// so we have no information about the sign
+			const float zdiry = zdir.y;
+			const float slope = slopes[i];
+			const float maxSpeed = maxForwardSpeeds[i];
+
+			// slow down on positive slopes, speed up on negative slopes
+			//    positive slope and forward  motion ==> slow down to lower  positive speed
+			//    positive slope and backward motion ==> speed up  to higher negative speed
+			//    negative slope and forward  motion ==> speed up  to higher positive speed
+			//    negative slope and backward motion ==> slow down to lower  negative speed
+			const bool forwardMotion = (speed >  0.05f);
+			const bool bckwardMotion = (speed < -0.05f);
+			const bool positiveSlope = (zdiry >  0.05f);
+			const bool negativeSlope = (zdiry < -0.05f);
+
+			const bool allowSlopeAcc =
+				(forwardMotion && negativeSlope && (speed < maxSpeed * 1.75f)) ||
+				(bckwardMotion && positiveSlope && (speed < maxSpeed * 1.75f));
+			const bool allowSlopeDec =
+				(forwardMotion && positiveSlope && (speed > maxSpeed * 0.25f)) ||
+				(bckwardMotion && negativeSlope && (speed > maxSpeed * 0.25f));
+
+			if (allowSlopeAcc) { speed += (speed * slope * (forwardMotion?  1.0f: -1.0f)); }
+			if (allowSlopeDec) { speed -= (speed * slope * (bckwardMotion? -1.0f:  1.0f)); }
 		}
-	} else {
-		if (speed >= wps.wantedSpeed) {
-			speed -= def->GetMaxAccelerationRate();
-			speed = std::max(speed, wps.wantedSpeed);
-		} else {
-			speed += def->GetMaxDeccelerationRate();
-			speed = std::min(speed, 0.0f);
+
+		{
+			const float wantedSpeed = wantedSpeeds[i];
+
+			if (wantedSpeed >= 0.0f) {
+				if (speed <= wantedSpeed) {
+					// accelerate (at maximum acceleration-rate) to match wantedSpeed
+					speed = std::min(speed + maxAccelerationRates[i], wantedSpeed);
+				} else {
+					// deccelerate (at maximum decceleration-rate) to match wantedSpeed
+					speed = std::max(speed - maxDeccelerationRates[i], 0.0f);
+				}
+			} else {
+				if (speed >= wantedSpeed) {
+					speed = std::max(speed - maxAccelerationRates[i], wantedSpeed);
+				} else {
+					speed = std::min(speed + maxDeccelerationRates[i], 0.0f);
+				}
+			}
 		}
 	}
 
-	// note: no gravity, since we only simulate earth-bound objects
-	vec3f pos = mat.GetPos() + (mat.GetZDir() * speed);
-		pos.y = ground->GetHeight(pos.x, pos.z);
+	for (unsigned int i = minObjectID; i < maxObjectID; i++) {
+		if ((enabled[i] & hasWantedState[i]) == 0) {
+			continue;
+		}
+
+		// note: no gravity, since we only simulate earth-bound objects
+		const vec3f oldPos = positions[i];
+		      vec3f newPos = oldPos + (forwardDirs[i] * speeds[i]);
 
-	mat.SetPos(pos);
-	mat.SetYDirXZ(ground->GetSmoothNormal(pos.x, pos.z));
+		newPos.y = ground->GetHeight(newPos.x, newPos.z);
+
+		positions[i] = newPos;
+		moved[i] |= (newPos != oldPos);
+
+		// adjust to the local terrain-slope
+		const vec3f ydir = ground->GetSmoothNormal(newPos.x, newPos.z);
+		const vec3f xdir = (((forwardDirs[i]).cross(ydir)).inorm3D());
+		const vec3f zdir = ((ydir.cross(xdir)).inorm3D());
+
+		forwardDirs[i] = zdir;
+		upDirs[i] = ydir;
+	}
 }
@@ -1,12 +1,17 @@
 #ifndef PFFG_SIMOBJECTSTATE_HDR
 #define PFFG_SIMOBJECTSTATE_HDR
 
+#include <vector>
+
 #include "../Math/mat44fwd.hpp"
 #include "../Math/mat44.hpp"
 #include "../Math/vec3fwd.hpp"
 #include "../Math/vec3.hpp"
 
-class SimObject;
+class SimObjectDef;
+
+// snapshot of one object's physical state (the live state of
+// all objects is kept in PhysicalStateArrays, see below)
 struct PhysicalState {
 	PhysicalState(): enabled(true), moved(false) {
 		speed = 0.0f;
@@ -41,8 +46,6 @@ struct PhysicalState {
 		return *this;
 	}
 
-	void Update(const SimObject*);
-
 	// world-space transform matrix
 	mat44f mat;
 
@@ -67,4 +70,51 @@ struct WantedPhysicalState {
 	float wantedSpeed;
 };
 
+// physical state of all sim-objects, in one packed array per
+// attribute indexed by object-ID (the arrays are sized once to
+// the maximum number of objects, so their elements never move)
+// such that the per-frame integration is a single pass over all
+// objects instead of one call per object
+//
+// an object's orientation is kept as its forward (object-space
+// z) and up (y) axes, which are orthonormal; the side-axis and
+// the full transform matrix are derived from them by the owning
+// SimObject (see SimObject::UpdateMat)
+struct PhysicalStateArrays {
+	void Resize(unsigned int);
+	void InitObject(unsigned int, const SimObjectDef*);
+	void FreeObject(unsigned int);
+	void SetObjectDirs(unsigned int, const vec3f&, const vec3f&);
+
+	void Integrate(unsigned int, unsigned int);
+
+	std::vector<vec3f> positions;
+	std::vector<vec3f> forwardDirs;
+	std::vector<vec3f> upDirs;
+	std::vector<float> speeds;
+
+	// the first state in each object's wanted-state queue
+	std::vector<vec3f> wantedDirs;
+	std::vector<float> wantedSpeeds;
+
+	// copies of each object's def-limits; the turning-rate
+	// is stored as the cosine and sine of its angle so that
+	// turning needs no trigonometry
+	std::vector<float> maxForwardSpeeds;
+	std::vector<float> maxAccelerationRates;
+	std::vector<float> maxDeccelerationRates;
+	std::vector<float> maxTurningRateCos;
+	std::vector<float> maxTurningRateSin;
+
+	// whether physics updates are enabled for each object, whether
+	// its wanted-state queue is non-empty, and whether its position
+	// has changed since the SimObjectHandler last looked
+	std::vector<unsigned char> enabled;
+	std::vector<unsigned char> hasWantedState;
+	std::vector<unsigned char> moved;
+
+	// terrain-slope under each object (scratch space of Integrate)
+	std::vector<float> slopes;
+};
+
 #endif
@@ -0,0 +1,149 @@
+#include <cstdlib>
+#include <map>
+#include <list>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "./SimObjectGrid.hpp"
+#include "./SimObjectFlatGrid.hpp"
+
+// stand-in for SimObject, which cannot exist without a def
+struct TestSimObject {
+	const vec3f& GetPos() const { return pos; }
+	float GetModelRadius() const { return radius; }
+
+	vec3f pos;
+	float radius;
+};
+
+static float GetRandFloat(float min, float max) {
+	return (min + (max - min) * (random() / float(RAND_MAX)));
+}
+
+// moves every object of a synthetic crowd on each frame and
+// then re-grids all of them (list-grid: a delete and re-add
+// per object, flat-grid: a single rebuild), followed by some
+// GetObjects queries at random positions; the mean time per
+// frame each grid needs for both steps is printed
+static void BenchmarkSimObjectGrids(const vec3i& gsize, const vec3f& gmins, const vec3f& gmaxs) {
+	typedef const TestSimObject* Obj;
+	typedef boost::posix_time::ptime Time;
+
+	static const unsigned int NUM_OBJECTS[] = {1000, 10000, 100000};
+	static const unsigned int NUM_QUERIES = 1000;
+	static const unsigned int NUM_FRAMES = 10;
+
+	const vec3f csize((gmaxs.x - gmins.x) / gsize.x, 0.0f, (gmaxs.z - gmins.z) / gsize.z);
+
+	for (unsigned int n = 0; n < (sizeof(NUM_OBJECTS) / sizeof(NUM_OBJECTS[0])); n++) {
+		std::vector<TestSimObject> objects(NUM_OBJECTS[n]);
+		std::vector<Obj> objectPtrs(NUM_OBJECTS[n]);
+		std::vector< std::map<unsigned int, std::list<Obj>::iterator> > objectCells(NUM_OBJECTS[n]);
+		std::vector<vec3f> queryPositions(NUM_QUERIES);
+
+		SimObjectGrid<Obj> listGrid(gsize, gmins, gmaxs);
+		SimObjectFlatGrid<Obj> flatGrid(gsize, gmins, gmaxs);
+
+		srandom(n);
+
+		for (unsigned int i = 0; i < objects.size(); i++) {
+			objects[i].pos.x = GetRandFloat(gmins.x, gmaxs.x);
+			objects[i].pos.z = GetRandFloat(gmins.z, gmaxs.z);
+			objects[i].radius = GetRandFloat(csize.x * 0.05f, csize.x * 0.25f);
+			objectPtrs[i] = &objects[i];
+
+			listGrid.AddObject(objectPtrs[i], objectCells[i]);
+		}
+
+		flatGrid.Rebuild(objectPtrs);
+
+		// times (in microseconds) and query results per grid
+		unsigned int listGridTimes[2] = {0, 0}, listGridObjects = 0;
+		unsigned int flatGridTimes[2] = {0, 0}, flatGridObjects = 0;
+
+		for (unsigned int frame = 0; frame < NUM_FRAMES; frame++) {
+			for (unsigned int i = 0; i < objects.size(); i++) {
+				objects[i].pos.x = std::max(gmins.x, std::min(gmaxs.x, objects[i].pos.x + GetRandFloat(-1.0f, 1.0f) * csize.x * 0.1f));
+				objects[i].pos.z = std::max(gmins.z, std::min(gmaxs.z, objects[i].pos.z + GetRandFloat(-1.0f, 1.0f) * csize.z * 0.1f));
+			}
+			for (unsigned int i = 0; i < NUM_QUERIES; i++) {
+				queryPositions[i].x = GetRandFloat(gmins.x, gmaxs.x);
+				queryPositions[i].z = GetRandFloat(gmins.z, gmaxs.z);
+			}
+
+			{
+				const Time t0 = boost::posix_time::microsec_clock::universal_time();
+
+				for (unsigned int i = 0; i < objects.size(); i++) {
+					listGrid.DelObject(objectPtrs[i], objectCells[i]);
+					listGrid.AddObject(objectPtrs[i], objectCells[i]);
+				}
+
+				const Time t1 = boost::posix_time::microsec_clock::universal_time();
+
+				for (unsigned int i = 0; i < NUM_QUERIES; i++) {
+					std::list<Obj> queryObjects;
+					listGrid.GetObjects(queryPositions[i], NVECf, queryObjects);
+					listGridObjects += queryObjects.size();
+				}
+
+				const Time t2 = boost::posix_time::microsec_clock::universal_time();
+
+				listGridTimes[0] += (t1 - t0).total_microseconds();
+				listGridTimes[1] += (t2 - t1).total_microseconds();
+			}
+			{
+				const Time t0 = boost::posix_time::microsec_clock::universal_time();
+
+				flatGrid.Rebuild(objectPtrs);
+
+				const Time t1 = boost::posix_time::microsec_clock::universal_time();
+
+				for (unsigned int i = 0; i < NUM_QUERIES; i++) {
+					std::list<Obj> queryObjects;
+					flatGrid.GetObjects(queryPositions[i], NVECf, queryObjects);
+					flatGridObjects += queryObjects.size();
+				}
+
+				const Time t2 = boost::posix_time::microsec_clock::universal_time();
+
+				flatGridTimes[0] += (t1 - t0).total_microseconds();
+				flatGridTimes[1] += (t2 - t1).total_microseconds();
+			}
+		}
+
+		std::cout << "number of objects: " << NUM_OBJECTS[n] << std::endl;
+		std::cout << "\tlist-grid update and query time per frame: " << (listGridTimes[0] / NUM_FRAMES) << "us, " << (listGridTimes[1] / NUM_FRAMES) << "us" << std::endl;
+		std::cout << "\tflat-grid update and query time per frame: " << (flatGridTimes[0] / NUM_FRAMES) << "us, " << (flatGridTimes[1] / NUM_FRAMES) << "us" << std::endl;
+
+		// both grids must have returned the same objects
+		if (listGridObjects != flatGridObjects) {
+			std::cout << "\tquery results differ: " << listGridObjects << " vs. " << flatGridObjects << std::endl;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc == 1 || argc == 5) {
+		// ex. "64 64 4096 4096" (the default grid, see params.lua,
+		// on a map of 4096 by 4096 world-space units)
+		const int numCellsX = (argc == 5)? atoi(argv[1]):   64;
+		const int numCellsZ = (argc == 5)? atoi(argv[2]):   64;
+		const float mapSizeX = (argc == 5)? atof(argv[3]): 4096.0f;
+		const float mapSizeZ = (argc == 5)? atof(argv[4]): 4096.0f;
+
+		// vertical dimension of the grid covers all y-values
+		// (the same as that of SimObjectHandler's grid)
+		const vec3i gsize(numCellsX, 1, numCellsZ);
+		const vec3f gmins(    0.0f, -1e6f,     0.0f);
+		const vec3f gmaxs(mapSizeX,  1e6f, mapSizeZ);
+
+		BenchmarkSimObjectGrids(gsize, gmins, gmaxs);
+	} else {
+		std::cout << "usage: " << argv[0] << " [numCellsX numCellsZ mapSizeX mapSizeZ]" << std::endl;
+	}
+
+	return 0;
+}
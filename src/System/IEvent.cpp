@@ -28,6 +28,6 @@ std::string SimObjectMoveOrderEvent::str() const {
 }
 
 std::string SimObjectCollisionEvent::str() const {
-	snprintf(s, 511, "[frame=%u][event=SimObjectCollisionEvent][colliderID=%u, collideeID=%u]", frame, colliderID, collideeID);
+	snprintf(s, 511, "[frame=%u][event=SimObjectCollisionEvent][numCollisions=%u]", frame, GetNumCollisions());
 	return std::string(s);
 }
@@ -2,6 +2,8 @@
 #define PFFG_IEVENT_HDR
 
 #include <list>
+#include <vector>
+#include <utility>
 
 #include "../Math/vec3fwd.hpp"
 #include "../Math/vec3.hpp"
@@ -91,21 +93,28 @@ private:
 
 
 
+// all collisions detected during one frame, delivered as a
+// single event so receivers can resolve them in one pass
 struct SimObjectCollisionEvent: public IEvent {
 public:
-	SimObjectCollisionEvent(unsigned int f, unsigned int a0, unsigned int a1): IEvent(EVENT_SIMOBJECT_COLLISION, f) {
-		colliderID = a0;
-		collideeID = a1;
+	typedef std::vector< std::pair<unsigned int, unsigned int> > PairVec;
+
+	SimObjectCollisionEvent(unsigned int f, const PairVec* pairs): IEvent(EVENT_SIMOBJECT_COLLISION, f) {
+		collisions = pairs;
 	}
 
-	unsigned int GetColliderID() const { return colliderID; }
-	unsigned int GetCollideeID() const { return collideeID; }
+	unsigned int GetNumCollisions() const { return collisions->size(); }
+	unsigned int GetColliderID(unsigned int n) const { return (*collisions)[n].first; }
+	unsigned int GetCollideeID(unsigned int n) const { return (*collisions)[n].second; }
 
 	std::string str() const;
 
 private:
-	unsigned int colliderID;
-	unsigned int collideeID;
+	// {collider, collidee} object-ID pairs (collider < collidee,
+	// in detection order); owned by the sender and only valid
+	// while the event is being processed
+	// NOTE: transferred across DLL boundary, so not ABI-safe
+	const PairVec* collisions;
 };
 
 #endif
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "./WorkerPool.hpp"
+
+WorkerPool::WorkerPool(unsigned int numWorkers):
+	mNumWorkers(std::max(numWorkers, 1U)),
+	mJob(NULL),
+	mJobNumber(0),
+	mNumItems(0),
+	mNextItem(0),
+	mNumBusyWorkers(0),
+	mQuit(false) {
+
+	mMutex    = new boost::mutex();
+	mJobCond  = new boost::condition_variable();
+	mDoneCond = new boost::condition_variable();
+
+	// worker 0 is the thread that calls Run()
+	for (unsigned int n = 1; n < mNumWorkers; n++) {
+		mThreads.push_back(new boost::thread(boost::bind(&WorkerPool::WorkerLoop, this, n)));
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		boost::mutex::scoped_lock lock(*mMutex);
+		mQuit = true;
+	}
+
+	mJobCond->notify_all();
+
+	for (unsigned int n = 0; n < mThreads.size(); n++) {
+		mThreads[n]->join();
+		delete mThreads[n];
+	}
+
+	mThreads.clear();
+
+	delete mDoneCond;
+	delete mJobCond;
+	delete mMutex;
+}
+
+unsigned int WorkerPool::GetNumHardwareThreads() {
+	return std::max(boost::thread::hardware_concurrency(), 1U);
+}
+
+
+
+void WorkerPool::Run(IWorkerJob* job, unsigned int numItems) {
+	if (numItems == 0) {
+		return;
+	}
+
+	if (mThreads.empty() || numItems == 1) {
+		// nothing to distribute
+		for (unsigned int n = 0; n < numItems; n++) {
+			job->Execute(n, 0);
+		}
+
+		return;
+	}
+
+	{
+		boost::mutex::scoped_lock lock(*mMutex);
+
+		mJob = job;
+		mJobNumber += 1;
+		mNumItems = numItems;
+		mNextItem = 0;
+		mNumBusyWorkers = mThreads.size();
+	}
+
+	mJobCond->notify_all();
+
+	ExecuteItems(0);
+
+	{
+		// wait for the items claimed by the other workers
+		boost::mutex::scoped_lock lock(*mMutex);
+
+		while (mNumBusyWorkers > 0) {
+			mDoneCond->wait(lock);
+		}
+
+		mJob = NULL;
+	}
+}
+
+void WorkerPool::WorkerLoop(unsigned int workerIdx) {
+	unsigned int lastJobNumber = 0;
+
+	while (true) {
+		{
+			boost::mutex::scoped_lock lock(*mMutex);
+
+			while (!mQuit && mJobNumber == lastJobNumber) {
+				mJobCond->wait(lock);
+			}
+
+			if (mQuit) {
+				return;
+			}
+
+			lastJobNumber = mJobNumber;
+		}
+
+		ExecuteItems(workerIdx);
+
+		{
+			boost::mutex::scoped_lock lock(*mMutex);
+
+			if ((--mNumBusyWorkers) == 0) {
+				mDoneCond->notify_one();
+			}
+		}
+	}
+}
+
+void WorkerPool::ExecuteItems(unsigned int workerIdx) {
+	while (true) {
+		IWorkerJob* job = NULL;
+		unsigned int itemIdx = 0;
+
+		{
+			boost::mutex::scoped_lock lock(*mMutex);
+
+			if (mNextItem >= mNumItems) {
+				return;
+			}
+
+			job = mJob;
+			itemIdx = mNextItem++;
+		}
+
+		job->Execute(itemIdx, workerIdx);
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef PFFG_WORKERPOOL_HDR
+#define PFFG_WORKERPOOL_HDR
+
+#include <vector>
+
+namespace boost {
+	class thread;
+	class mutex;
+	class condition_variable;
+};
+
+// a job consists of <n> independent items; every item is
+// executed exactly once, by whichever worker claims it
+// first (so any per-worker state an item uses must not
+// influence its result if the outcome has to be the same
+// for every number of workers)
+struct IWorkerJob {
+	virtual ~IWorkerJob() {}
+	virtual void Execute(unsigned int itemIdx, unsigned int workerIdx) = 0;
+};
+
+// fixed-size pool of threads that execute the items of
+// one job at a time; the calling thread participates as
+// worker 0, so a pool of size 1 spawns no threads at all
+class WorkerPool {
+public:
+	WorkerPool(unsigned int numWorkers);
+	~WorkerPool();
+
+	// blocks until every item of <job> has been executed
+	void Run(IWorkerJob* job, unsigned int numItems);
+
+	unsigned int GetNumWorkers() const { return mNumWorkers; }
+
+	// number of hardware threads, or 1 if unknown
+	static unsigned int GetNumHardwareThreads();
+
+private:
+	void WorkerLoop(unsigned int workerIdx);
+	void ExecuteItems(unsigned int workerIdx);
+
+	unsigned int mNumWorkers;
+
+	std::vector<boost::thread*> mThreads;
+
+	boost::mutex* mMutex;
+	boost::condition_variable* mJobCond;
+	boost::condition_variable* mDoneCond;
+
+	// guarded by mMutex
+	IWorkerJob* mJob;
+	unsigned int mJobNumber;
+	unsigned int mNumItems;
+	unsigned int mNextItem;
+	unsigned int mNumBusyWorkers;
+	bool mQuit;
+};
+
+#endif
@@ -14,6 +14,7 @@
 #include "../Sim/SimCommands.hpp"
 #include "../Sim/SimObjectHandler.hpp"
 #include "../Sim/SimObjectGrid.hpp"
+#include "../Sim/SimObjectFlatGrid.hpp"
 #include "../Sim/SimObject.hpp"
 #include "../System/Client.hpp"
 #include "../System/NetMessages.hpp"
@@ -136,10 +137,10 @@ void ui::SimObjectSelectorWidget::FillSelection() {
 		if (selectionSquareSize2D.y >= -5 && selectionSquareSize2D.y <= 5) { ClearSelection(); return; }
 
 		// all four rays must have intersected the ground
-		SimObjectGrid<const SimObject*>* grid = simObjectHandler->GetSimObjectGrid();
+		SimObjectHandler::ObjectGrid* grid = simObjectHandler->GetSimObjectGrid();
 
-		const vec3i& minsIdx = grid->GetCellIdx(selectionBounds3D[0], true);
-		const vec3i& maxsIdx = grid->GetCellIdx(selectionBounds3D[1], true);
+		const vec3f selectionMidPos3D = (selectionBounds3D[0] + selectionBounds3D[1]) * 0.5f;
+		const vec3f selectionExtents3D = (selectionBounds3D[1] - selectionBounds3D[0]) * 0.5f;
 
 		const vec3f avgSelectionCoor3D =
 			(selectionCoors3D[0] * 0.25f) +
@@ -147,29 +148,25 @@ void ui::SimObjectSelectorWidget::FillSelection() {
 			(selectionCoors3D[2] * 0.25f) +
 			(selectionCoors3D[3] * 0.25f);
 
-		// visit the grid-cells within the bounding-box
-		for (int i = minsIdx.x; i <= maxsIdx.x; i++) {
-			for (int j = minsIdx.z; j <= maxsIdx.z; j++) {
-				const SimObjectGrid<const SimObject*>::GridCell& cell = grid->GetCell(vec3i(i, 0, j));
-				const std::list<const SimObject*> objects = cell.GetObjects();
+		// visit the grid-cells around the bounding-box
+		std::list<const SimObject*> objects;
+		grid->GetObjects(selectionMidPos3D, vec3f(selectionExtents3D.x, 0.0f, selectionExtents3D.z), objects);
 
-				for (std::list<const SimObject*>::const_iterator it = objects.begin(); it != objects.end(); ++it) {
-					const vec3f& pos = (*it)->GetPos();
+		for (std::list<const SimObject*>::const_iterator it = objects.begin(); it != objects.end(); ++it) {
+			const vec3f& pos = (*it)->GetPos();
 
-					// assumes the quad is convex
-					if (geom::PointInTriangle(selectionCoors3D[0], selectionCoors3D[1], avgSelectionCoor3D, pos)) {
-						selectedObjectIDs.insert((*it)->GetID()); continue;
-					}
-					if (geom::PointInTriangle(selectionCoors3D[1], selectionCoors3D[2], avgSelectionCoor3D, pos)) {
-						selectedObjectIDs.insert((*it)->GetID()); continue;
-					}
-					if (geom::PointInTriangle(selectionCoors3D[2], selectionCoors3D[3], avgSelectionCoor3D, pos)) {
-						selectedObjectIDs.insert((*it)->GetID()); continue;
-					}
-					if (geom::PointInTriangle(selectionCoors3D[3], selectionCoors3D[0], avgSelectionCoor3D, pos)) {
-						selectedObjectIDs.insert((*it)->GetID()); continue;
-					}
-				}
+			// assumes the quad is convex
+			if (geom::PointInTriangle(selectionCoors3D[0], selectionCoors3D[1], avgSelectionCoor3D, pos)) {
+				selectedObjectIDs.insert((*it)->GetID()); continue;
+			}
+			if (geom::PointInTriangle(selectionCoors3D[1], selectionCoors3D[2], avgSelectionCoor3D, pos)) {
+				selectedObjectIDs.insert((*it)->GetID()); continue;
+			}
+			if (geom::PointInTriangle(selectionCoors3D[2], selectionCoors3D[3], avgSelectionCoor3D, pos)) {
+				selectedObjectIDs.insert((*it)->GetID()); continue;
+			}
+			if (geom::PointInTriangle(selectionCoors3D[3], selectionCoors3D[0], avgSelectionCoor3D, pos)) {
+				selectedObjectIDs.insert((*it)->GetID()); continue;
 			}
 		}
 	}